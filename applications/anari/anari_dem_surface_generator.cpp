@@ -154,7 +154,9 @@ struct SamplerHelper
         }
     }
 
-    // Central Rows:
+    // Central Rows, read at once rather than sample by sample:
+    vector<float> blockHeights(static_cast<size_t>(rBlockSize.x) * rActualBlockSize.y);
+    helper.rBlock.copyRows(0U, rActualBlockSize.y, blockHeights);
     for (uint32_t y = 0U; y < rActualBlockSize.y; y++)
     {
         // Left Edge:
@@ -164,9 +166,10 @@ struct SamplerHelper
         }
 
         // Centre of Row:
+        const auto pBlockHeightsRow = blockHeights.data() + static_cast<size_t>(rBlockSize.x) * y;
         for (uint32_t x = 0U; x < rActualBlockSize.x; x++)
         {
-            const auto height = helper.rBlock.at(x, y);
+            const auto height = pBlockHeightsRow[x];
             *(pVertexData++) = height >= 0.0F ? glm::vec3{x, height, y} : NaNVec;
         }
 
@@ -3,8 +3,11 @@
 #include <gdal_priv.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <functional>
 #include <memory>
+#include <span>
+#include <stdexcept>
 
 namespace im3e {
 
@@ -26,6 +29,17 @@ public:
     auto at(uint32_t x, uint32_t y) const -> T { return m_pData.get()[m_blockSize.x * y + x]; }
     auto at(const glm::u32vec2& rPos) const -> T { return m_pData.get()[m_blockSize.x * rPos.y + rPos.x]; }
 
+    /// @brief Copy consecutive rows of the block into the given destination, with getBlockSize().x values per row.
+    void copyRows(uint32_t firstRow, uint32_t rowCount, std::span<T> dst) const
+    {
+        const auto valueCount = static_cast<size_t>(m_blockSize.x) * rowCount;
+        if (firstRow + rowCount > m_blockSize.y || dst.size() < valueCount)
+        {
+            throw std::out_of_range("Cannot copy rows outside of DEM block or into a too small destination");
+        }
+        std::copy_n(m_pData.get() + static_cast<size_t>(m_blockSize.x) * firstRow, valueCount, dst.data());
+    }
+
     auto getBlockPos() const -> const glm::u32vec2& { return m_blockPos; }
     auto getActualBlockSize() const -> const glm::u32vec2& { return m_actualBlockSize; }
     auto getBlockSize() const -> const glm::u32vec2& { return m_blockSize; }
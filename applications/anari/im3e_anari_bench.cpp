@@ -0,0 +1,346 @@
+#include <im3e/anari/anari.h>
+#include <im3e/devices/devices.h>
+#include <im3e/geo/geo.h>
+#include <im3e/utils/core/throw_utils.h>
+#include <im3e/utils/loggers.h>
+#include <im3e/utils/stats.h>
+
+#include <fmt/format.h>
+#include <fmt/std.h>
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace im3e;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+constexpr auto AnLibName = "helide";
+constexpr VkExtent2D FrameSize{.width = 1280U, .height = 720U};
+constexpr uint32_t FrameInFlightCount = 2U;
+
+// Frames rendered before the camera path starts, so that the first tiles of the height map are loaded:
+constexpr uint32_t WarmUpFrameCount = 30U;
+
+// A rendered frame may take several executions of the pipeline to complete, give up on frames that never complete:
+constexpr auto FrameTimeout = 60s;
+
+/// @brief Part of the camera path, replaying the same camera input for a number of frames.
+struct CameraPathSegment
+{
+    string_view name;
+    uint32_t frameCount;
+    glm::vec2 clipOffset{};
+    optional<IGuiEventListener::MouseButton> mouseButton{};
+    float scrollSteps{};
+};
+
+// Orbit around, zoom in, pan then zoom out the initial view of the height map, ending still to measure the frames of
+// an idle camera:
+const array<CameraPathSegment, 5U> CameraPath{
+    CameraPathSegment{
+        .name = "orbit",
+        .frameCount = 120U,
+        .clipOffset = {0.02F, -0.005F},
+        .mouseButton = IGuiEventListener::MouseButton::Left,
+    },
+    CameraPathSegment{.name = "zoomIn", .frameCount = 60U, .scrollSteps = 0.25F},
+    CameraPathSegment{
+        .name = "pan",
+        .frameCount = 120U,
+        .clipOffset = {0.01F, 0.01F},
+        .mouseButton = IGuiEventListener::MouseButton::Middle,
+    },
+    CameraPathSegment{.name = "zoomOut", .frameCount = 60U, .scrollSteps = -0.25F},
+    CameraPathSegment{.name = "still", .frameCount = 30U},
+};
+
+void applyCameraInput(IGuiEventListener& rCamera, const CameraPathSegment& rSegment)
+{
+    if (rSegment.mouseButton)
+    {
+        array<bool, 3U> mouseButtonsDown{};
+        mouseButtonsDown[static_cast<size_t>(*rSegment.mouseButton)] = true;
+        rCamera.onMouseMove(rSegment.clipOffset, mouseButtonsDown);
+    }
+    if (rSegment.scrollSteps != 0.0F)
+    {
+        rCamera.onMouseWheel(rSegment.scrollSteps);
+    }
+}
+
+/// @brief Accumulates the spans of the current frame, counts the frames output by the ANARI pipeline and keeps the
+/// latest metrics.
+class FrameStatsReceiver : public IStatsReceiver
+{
+public:
+    struct SpanStats
+    {
+        uint32_t count{};
+        microseconds totalDuration{};
+    };
+
+    void onSpanAdded(Span span) override
+    {
+        lock_guard lk(m_mutex);
+        auto& rSpanStats = m_spanStats[span.path.generic_string()];
+        rSpanStats.count++;
+        rSpanStats.totalDuration += duration_cast<microseconds>(span.endTime - span.startTime);
+        if (span.path.filename() == "outputFrame")
+        {
+            m_outputFrameCount++;
+        }
+    }
+
+    void onMetricsUpdated(vector<Metric> metrics) override
+    {
+        lock_guard lk(m_mutex);
+        m_metrics = std::move(metrics);
+    }
+
+    /// @return Stats of the spans added since the last call.
+    auto takeSpanStats() -> map<string, SpanStats>
+    {
+        lock_guard lk(m_mutex);
+        return exchange(m_spanStats, {});
+    }
+
+    auto getOutputFrameCount() const -> uint32_t
+    {
+        lock_guard lk(m_mutex);
+        return m_outputFrameCount;
+    }
+
+    auto getMetrics() const -> vector<Metric>
+    {
+        lock_guard lk(m_mutex);
+        return m_metrics;
+    }
+
+private:
+    mutable mutex m_mutex;
+    map<string, SpanStats> m_spanStats;
+    uint32_t m_outputFrameCount{};
+    vector<Metric> m_metrics;
+};
+
+auto escapeJson(string_view text)
+{
+    string escapedText;
+    for (auto character : text)
+    {
+        switch (character)
+        {
+            case '"': escapedText += "\\\""; break;
+            case '\\': escapedText += "\\\\"; break;
+            case '\n': escapedText += "\\n"; break;
+            case '\t': escapedText += "\\t"; break;
+            default: escapedText += character; break;
+        }
+    }
+    return escapedText;
+}
+
+void disableDynamicResolution(IPropertyGroup& rProperties)
+{
+    // Frames are compared between releases at a fixed resolution:
+    for (auto& pProperty : rProperties.getChildren())
+    {
+        if (auto pGroup = dynamic_pointer_cast<IPropertyGroup>(pProperty))
+        {
+            disableDynamicResolution(*pGroup);
+        }
+        else if (auto pValue = dynamic_pointer_cast<IPropertyValue>(pProperty);
+                 pValue && rProperties.getName() == "Dynamic Resolution" && pValue->getName() == "Enabled")
+        {
+            pValue->setAnyValue(false);
+        }
+    }
+}
+
+void saveOutputImage(const IDevice& rDevice, IImage& rOutputImage, const filesystem::path& rFramePath)
+{
+    auto pHostVisibleImage = rDevice.getImageFactory()->createHostVisibleImage(ImageConfig{
+        .name = "BenchHostVisibleImage",
+        .vkExtent = rOutputImage.getVkExtent(),
+        .vkFormat = rOutputImage.getVkFormat(),
+        .vkUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+    });
+    {
+        auto pCommandBuffer = rDevice.getCommandQueue()->startScopedCommand("BenchSaveFrame",
+                                                                            CommandExecutionType::Sync);
+        {
+            auto pBarrierRecorder = pCommandBuffer->startScopedBarrier("prepareHostVisibleOutput");
+            pBarrierRecorder->addImageBarrier(rOutputImage, ImageBarrierConfig{
+                                                                .vkDstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                                                                .vkDstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+                                                                .vkLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                                            });
+            pBarrierRecorder->addImageBarrier(*pHostVisibleImage, ImageBarrierConfig{
+                                                                      .vkDstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                                                                      .vkDstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                                                                      .vkLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                                  });
+        }
+        VkImageCopy vkRegion{
+            .srcSubresource = rOutputImage.getVkSubresourceLayers(),
+            .dstSubresource = pHostVisibleImage->getVkSubresourceLayers(),
+            .extent = toVkExtent3D(rOutputImage.getVkExtent()),
+        };
+        rDevice.getFcts().vkCmdCopyImage(pCommandBuffer->getVkCommandBuffer(), rOutputImage.getVkImage(),
+                                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, pHostVisibleImage->getVkImage(),
+                                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1U, &vkRegion);
+    }
+    pHostVisibleImage->map()->save(rFramePath);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    auto pLogger = createTerminalLogger();
+
+    filesystem::path appRelativePath{argv[0]};
+    pLogger->info(fmt::format("Application: {}", appRelativePath.filename()));
+
+    constexpr auto MinExpectedArgc = 3U;
+    const auto usage = fmt::format("Expected Usage:\n"
+                                   "\t{} heightMapPath timingsPath [framesDirectory]\n"
+                                   "with:\n"
+                                   " - heightMapPath: path to the height map to render, as accepted by the viewer\n"
+                                   " - timingsPath: path to the JSON file receiving the stats spans of each frame\n"
+                                   " - framesDirectory: optional directory receiving each rendered frame as a PNG "
+                                   "file\n",
+                                   appRelativePath.filename());
+    throwIfFalse<invalid_argument>(argc >= MinExpectedArgc,
+                                   fmt::format("Invalid number of arguments passed to application: expected at least "
+                                               "{}, got {}.\n\n{}",
+                                               MinExpectedArgc - 1U, argc - 1U, usage));
+
+    filesystem::path heightMapPath{argv[1]};
+    throwIfFalse<invalid_argument>(filesystem::exists(heightMapPath),
+                                   fmt::format("File not found: \"{}\"", heightMapPath));
+    filesystem::path timingsPath{argv[2]};
+    optional<filesystem::path> framesDirectory;
+    if (argc > MinExpectedArgc)
+    {
+        framesDirectory = argv[3];
+        filesystem::create_directories(*framesDirectory);
+    }
+
+    // Headless device: no window nor swapchain, frames are rendered to an offscreen output image.
+    auto pDevice = createDevice(*pLogger);
+    auto pStatsReceiver = make_shared<FrameStatsReceiver>();
+    pDevice->getStatsProvider()->addReceiver(pStatsReceiver);
+
+    auto pAnEngine = createAnariEngine(*pLogger, pDevice, false, AnLibName);
+    auto pFramePipeline = pAnEngine->createFramePipeline();
+    disableDynamicResolution(*pFramePipeline->getProperties());
+
+    auto pHeightMap = loadHeightMapFromFile(*pLogger, HeightMapFileConfig{
+                                                          .path = heightMapPath,
+                                                          .readOnly = true,
+                                                          .pStatsProvider = pDevice->getStatsProvider(),
+                                                      });
+    auto pHeightField = pFramePipeline->getWorld()->addHeightField(std::move(pHeightMap));
+    auto pCamera = pFramePipeline->getCameraListener();
+
+    auto pOutputImage = pDevice->getImageFactory()->createImage(ImageConfig{
+        .name = "BenchOutputImage",
+        .vkExtent = FrameSize,
+        .vkFormat = VK_FORMAT_R8G8B8A8_UNORM,
+        .vkUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+    });
+    pFramePipeline->resize(FrameSize, FrameInFlightCount);
+
+    // Execute the pipeline until it outputs a new frame:
+    auto renderFrame = [&] {
+        const auto outputFrameCount = pStatsReceiver->getOutputFrameCount();
+        const auto timeoutTime = steady_clock::now() + FrameTimeout;
+        while (pStatsReceiver->getOutputFrameCount() == outputFrameCount)
+        {
+            throwIfFalse<runtime_error>(steady_clock::now() < timeoutTime, "Timed out waiting for ANARI frame");
+            {
+                auto pCommandBuffer = pDevice->getCommandQueue()->startScopedCommand("BenchFrame",
+                                                                                     CommandExecutionType::Sync);
+                pFramePipeline->prepareExecution(*pCommandBuffer, FrameSize, pOutputImage);
+            }
+
+            // Spans are delivered asynchronously, they are flushed so that frame stats are up to date:
+            pDevice->getStatsProvider()->flush();
+        }
+    };
+
+    pLogger->info(fmt::format("Warming up with {} frames", WarmUpFrameCount));
+    for (auto frameIndex = 0U; frameIndex < WarmUpFrameCount; frameIndex++)
+    {
+        renderFrame();
+    }
+    pStatsReceiver->takeSpanStats();
+
+    ofstream timingsFile(timingsPath, ios::trunc);
+    throwIfFalse<runtime_error>(timingsFile.is_open(), fmt::format("Failed to create file \"{}\"", timingsPath));
+    timingsFile << fmt::format("{{\n  \"heightMap\": \"{}\",\n  \"anariLibrary\": \"{}\",\n  \"frameSize\": [{}, {}],\n"
+                               "  \"frames\": [",
+                               escapeJson(heightMapPath.generic_string()), AnLibName, FrameSize.width,
+                               FrameSize.height);
+
+    uint32_t frameIndex{};
+    for (auto& rSegment : CameraPath)
+    {
+        pLogger->info(fmt::format("Rendering {} frames: {}", rSegment.frameCount, rSegment.name));
+        for (auto segmentFrameIndex = 0U; segmentFrameIndex < rSegment.frameCount; segmentFrameIndex++, frameIndex++)
+        {
+            const auto frameStartTime = steady_clock::now();
+            applyCameraInput(*pCamera, rSegment);
+            renderFrame();
+            const auto frameDuration = duration<double, milli>(steady_clock::now() - frameStartTime);
+
+            timingsFile << fmt::format("{}\n    {{\"index\": {}, \"segment\": \"{}\", \"durationMs\": {:.3f}, "
+                                       "\"spans\": {{",
+                                       frameIndex ? "," : "", frameIndex, rSegment.name, frameDuration.count());
+            bool firstSpan = true;
+            for (auto& [rSpanPath, rSpanStats] : pStatsReceiver->takeSpanStats())
+            {
+                timingsFile << fmt::format("{}\n      \"{}\": {{\"count\": {}, \"totalMs\": {:.3f}}}",
+                                           firstSpan ? "" : ",", escapeJson(rSpanPath), rSpanStats.count,
+                                           duration<double, milli>(rSpanStats.totalDuration).count());
+                firstSpan = false;
+            }
+            timingsFile << "\n    }}";
+
+            if (framesDirectory)
+            {
+                saveOutputImage(*pDevice, *pOutputImage, *framesDirectory / fmt::format("frame_{:05}.png", frameIndex));
+            }
+        }
+    }
+    timingsFile << "\n  ],\n  \"metrics\": {";
+
+    // Metrics reached at the end of the camera path, e.g. tile reads and resident tiles:
+    pDevice->getStatsProvider()->flush();
+    bool firstMetric = true;
+    for (auto& rMetric : pStatsReceiver->getMetrics())
+    {
+        timingsFile << fmt::format("{}\n    \"{}\": {}", firstMetric ? "" : ",", escapeJson(rMetric.name),
+                                   rMetric.value);
+        firstMetric = false;
+    }
+    timingsFile << "\n  }\n}\n";
+    pLogger->info(fmt::format("Wrote timings of {} frames to {}", frameIndex, timingsPath));
+
+    pDevice->getStatsProvider()->removeReceiver(pStatsReceiver);
+    return 0;
+}
@@ -9,12 +9,17 @@
 #include <im3e/utils/loggers.h>
 #include <im3e/utils/properties/properties.h>
 
+#include <im3e/utils/stats.h>
+
 #include <anari/anari.h>
 #include <fmt/format.h>
 
+#include <filesystem>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <string_view>
+#include <vector>
 
 using namespace im3e;
 using namespace std;
@@ -71,17 +76,26 @@ constexpr bool DebugEnabled = true;
 
 }  // namespace
 
-int main()
+int main(int argc, char* argv[])
 {
     auto pLogger = createTerminalLogger();
     pLogger->setLevelFilter(LogLevel::Verbose);
     pLogger->debug("ANARI App");
 
+    // Spans are recorded to a Chrome trace event file when requested with "--trace traceFilePath":
+    vector<string_view> args(argv, argv + argc);
+    const auto traceFilePath = extractTraceFilePath(args);
+
     auto pApp = createGlfwWindowApplication(*pLogger, WindowApplicationConfig{
                                                           .name = "ANARI Viewer",
                                                           .isDebugEnabled = DebugEnabled,
                                                       });
     auto pDevice = pApp->getDevice();
+    if (traceFilePath)
+    {
+        pDevice->getStatsProvider()->addReceiver(createTraceFileStatsReceiver(*traceFilePath));
+        pLogger->info(fmt::format("Tracing spans to \"{}\"", traceFilePath->generic_string()));
+    }
     auto pAnEngine = createAnariEngine(*pLogger, pDevice, DebugEnabled);
     auto pFramePipeline = pAnEngine->createFramePipeline();
 
@@ -92,6 +106,7 @@ int main()
                                             HeightMapFileConfig{
                                                 .path = "/mnt/data/dev/assets/lidar_bc/bc_092g054_xl1m_utm10_2019.tif",
                                                 .readOnly = true,
+                                                .pStatsProvider = pDevice->getStatsProvider(),
                                             });
     auto pHeightField = pWorld->addHeightField(std::move(pHeightMap));
 
@@ -101,6 +116,8 @@ int main()
     {
         auto pPropertyGroup = createPropertyGroup("Parameters", {
                                                                     pFramePipeline->createRendererProperties(),
+                                                                    pFramePipeline->getProperties(),
+                                                                    pWorld->getProperties(),
                                                                     // pPlane->getProperties(),
                                                                     pHeightField->getProperties(),
                                                                 });
@@ -1,11 +1,15 @@
 #include <im3e/geo/geo.h>
 #include <im3e/utils/core/throw_utils.h>
 #include <im3e/utils/loggers.h>
+#include <im3e/utils/stats.h>
 
 #include <fmt/format.h>
 #include <fmt/std.h>
 
 #include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
 
 using namespace im3e;
 using namespace std;
@@ -17,35 +21,82 @@ int main(int argc, char** argv)
     filesystem::path appRelativePath{argv[0]};
     pLogger->info(fmt::format("Application: {}", appRelativePath.filename()));
 
-    constexpr auto ExpectedArgc = 3U;
-    throwIfFalse<invalid_argument>(
-        argc == ExpectedArgc, fmt::format("Invalid number of arguments passed to application: expected {}, got {}.\n\n"
-                                          "Expected Usage:\n"
-                                          "\t{} action filePath\n"
-                                          "with:\n"
-                                          " - action: action to perform. Current options are:\n"
-                                          "\t- info: print information about the given file\n"
-                                          "\t- rebuild: rebuild overviews of the given file\""
-                                          " - filePath: path to the file to process\n",
-                                          ExpectedArgc - 1U, argc - 1U, appRelativePath.filename()));
-
-    const string action{argv[1]};
+    constexpr auto MinExpectedArgc = 3U;
+    const auto usage = fmt::format("Expected Usage:\n"
+                                   "\t{} action filePath [dstFilePath] [--trace traceFilePath]\n"
+                                   "with:\n"
+                                   " - action: action to perform. Current options are:\n"
+                                   "\t- info: print information about the given file\n"
+                                   "\t- rebuild: rebuild overviews of the given file\n"
+                                   "\t- convert: convert the given file to an im3e native height map ({}) written to "
+                                   "dstFilePath\n"
+                                   " - filePath: path to the file to process, or to a mosaic given as a directory of "
+                                   "GeoTIFF files or as a manifest file ({})\n"
+                                   " - dstFilePath: path to the file to write, required by the convert action\n"
+                                   " - traceFilePath: optional Chrome trace event file (.json) recording the spans of "
+                                   "the action, to open in Perfetto or chrome://tracing\n",
+                                   appRelativePath.filename(), NativeHeightMapExtension, MosaicManifestExtension);
+
+    vector<string_view> args(argv, argv + argc);
+    const auto traceFilePath = extractTraceFilePath(args);
+    throwIfFalse<invalid_argument>(args.size() >= MinExpectedArgc,
+                                   fmt::format("Invalid number of arguments passed to application: expected at least "
+                                               "{}, got {}.\n\n{}",
+                                               MinExpectedArgc - 1U, args.size() - 1U, usage));
+
+    // Spans are only recorded when traced:
+    shared_ptr<IStatsProvider> pStatsProvider;
+    if (traceFilePath)
+    {
+        pStatsProvider = createStatsProvider();
+        pStatsProvider->addReceiver(createTraceFileStatsReceiver(*traceFilePath));
+        pLogger->info(fmt::format("traceFilePath: {}", *traceFilePath));
+    }
+
+    const string action{args[1]};
     pLogger->info(fmt::format("action: {}", action));
 
-    filesystem::path filePath{argv[2]};
+    filesystem::path filePath{args[2]};
     throwIfFalse<invalid_argument>(filesystem::exists(filePath), fmt::format("File not found: \"{}\"", filePath));
     pLogger->info(fmt::format("filePath: {}", filePath));
 
     if (action == "info")
     {
         pLogger->setLevelFilter(LogLevel::Verbose);
-        auto pHeightMap = loadHeightMapFromFile(*pLogger, HeightMapFileConfig{.path = filePath, .readOnly = true});
+        auto pHeightMap = loadHeightMapFromFile(*pLogger, HeightMapFileConfig{
+                                                              .path = filePath,
+                                                              .readOnly = true,
+                                                              .pStatsProvider = pStatsProvider,
+                                                          });
     }
     else if (action == "rebuild")
     {
-        auto pHeightMap = loadHeightMapFromFile(*pLogger, HeightMapFileConfig{.path = filePath, .readOnly = false});
+        auto pHeightMap = loadHeightMapFromFile(*pLogger, HeightMapFileConfig{
+                                                              .path = filePath,
+                                                              .readOnly = false,
+                                                              .pStatsProvider = pStatsProvider,
+                                                          });
         pHeightMap->rebuildPyramid();
     }
+    else if (action == "convert")
+    {
+        throwIfFalse<invalid_argument>(args.size() == MinExpectedArgc + 1U,
+                                       fmt::format("Missing destination file for convert action.\n\n{}", usage));
+        filesystem::path dstFilePath{args[3]};
+        throwIfFalse<invalid_argument>(dstFilePath.extension() == NativeHeightMapExtension,
+                                       fmt::format("Destination file must have the {} extension: \"{}\"",
+                                                   NativeHeightMapExtension, dstFilePath));
+        pLogger->info(fmt::format("dstFilePath: {}", dstFilePath));
+
+        // Tiles are read once each: skip caching them.
+        auto pHeightMap = loadHeightMapFromFile(*pLogger, HeightMapFileConfig{
+                                                              .path = filePath,
+                                                              .readOnly = true,
+                                                              .tileCacheByteBudget = 0U,
+                                                              .pStatsProvider = pStatsProvider,
+                                                          });
+        convertToNativeHeightMap(*pLogger, *pHeightMap, dstFilePath);
+    }
     else
     {
         throw runtime_error(fmt::format("Unsupported action: {}", action));
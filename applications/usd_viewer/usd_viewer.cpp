@@ -1,14 +1,21 @@
 #include <im3e/guis/guis.h>
 #include <im3e/utils/loggers.h>
+#include <im3e/utils/stats.h>
+
+#include <fmt/format.h>
 
 #include <filesystem>
+#include <string_view>
+#include <vector>
 
 using namespace im3e;
 using namespace std;
 
-int main([[maybe_unused]] int argc, char* argv[])
+int main(int argc, char* argv[])
 {
     filesystem::path appPath{argv[0]};
+    vector<string_view> args(argv, argv + argc);
+    const auto traceFilePath = extractTraceFilePath(args);
 
     auto pLogger = createTerminalLogger();
     auto pApp = createGlfwWindowApplication(*pLogger, WindowApplicationConfig{
@@ -16,6 +23,13 @@ int main([[maybe_unused]] int argc, char* argv[])
                                                           .isDebugEnabled = true,
                                                       });
 
+    // Spans are recorded to a Chrome trace event file when requested with "--trace traceFilePath":
+    if (traceFilePath)
+    {
+        pApp->getDevice()->getStatsProvider()->addReceiver(createTraceFileStatsReceiver(*traceFilePath));
+        pLogger->info(fmt::format("Tracing spans to \"{}\"", traceFilePath->generic_string()));
+    }
+
     auto pWorkspace = createImguiWorkspace("Workspace");
     pApp->createWindow(WindowConfig{}, pWorkspace);
 
@@ -27,6 +27,9 @@ public:
 
     virtual auto addPlane(std::string_view name) -> std::shared_ptr<IAnariObject> = 0;
     virtual auto addHeightField(std::unique_ptr<IHeightMap> pHeightMap) -> std::shared_ptr<IAnariObject> = 0;
+
+    /// @brief Properties shared by all objects of the world, such as the tile memory budget of the height fields.
+    virtual auto getProperties() -> std::shared_ptr<IPropertyGroup> = 0;
 };
 
 class IAnariFramePipeline : public IFramePipeline
@@ -35,6 +38,9 @@ public:
     virtual ~IAnariFramePipeline() = default;
 
     virtual auto createRendererProperties() -> std::shared_ptr<IPropertyGroup> = 0;
+
+    /// @brief Properties of the frames rendered by the pipeline, such as dynamic resolution scaling.
+    virtual auto getProperties() -> std::shared_ptr<IPropertyGroup> = 0;
     virtual auto getCameraListener() -> std::shared_ptr<IGuiEventListener> = 0;
     virtual auto getWorld() -> std::shared_ptr<IAnariWorld> = 0;
 };
@@ -47,7 +53,8 @@ public:
     virtual auto createFramePipeline() -> std::unique_ptr<IAnariFramePipeline> = 0;
 };
 
-auto createAnariEngine(const ILogger& rLogger, std::shared_ptr<IDevice> pDevice, bool debugEnabled = false)
-    -> std::unique_ptr<IAnariEngine>;
+/// @param[in] anLibName ANARI implementation to load, e.g. "helide". The first available one is loaded if empty.
+auto createAnariEngine(const ILogger& rLogger, std::shared_ptr<IDevice> pDevice, bool debugEnabled = false,
+                       std::string_view anLibName = {}) -> std::unique_ptr<IAnariEngine>;
 
 }  // namespace im3e
\ No newline at end of file
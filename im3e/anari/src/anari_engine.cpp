@@ -51,6 +51,13 @@ auto createAnLibrary(const ILogger& rLogger, std::string_view anLibName) -> Uniq
 
 auto loadAnLibrary(const ILogger& rLogger, std::string& rAnLibName)
 {
+    if (!rAnLibName.empty())
+    {
+        auto pAnLib = createAnLibrary(rLogger, rAnLibName);
+        throwIfFalse<std::runtime_error>(pAnLib != nullptr,
+                                         fmt::format("Could not load ANARI implementation \"{}\"", rAnLibName));
+        return pAnLib;
+    }
     for (auto& rLibName : AnImplementationNames)
     {
         if (auto pAnLib = createAnLibrary(rLogger, rLibName))
@@ -65,9 +72,10 @@ auto loadAnLibrary(const ILogger& rLogger, std::string& rAnLibName)
 class AnariEngine : public IAnariEngine
 {
 public:
-    AnariEngine(const ILogger& rLogger, std::shared_ptr<IDevice> pDevice, bool debugEnabled)
+    AnariEngine(const ILogger& rLogger, std::shared_ptr<IDevice> pDevice, bool debugEnabled, std::string_view anLibName)
       : m_pLogger(rLogger.createChild("ANARI"))
       , m_pDevice(throwIfArgNull(std::move(pDevice), "ANARI Engine requires a Device"))
+      , m_anLibName(anLibName)
       , m_pAnLib(loadAnLibrary(*m_pLogger, m_anLibName))
       , m_pAnDebugLib(debugEnabled ? createAnLibrary(*m_pLogger, "debug") : nullptr)
       , m_pAnDevice(std::make_shared<AnariDevice>(*m_pLogger, m_pAnLib.get(), m_anLibName, m_pAnDebugLib.get()))
@@ -91,8 +99,8 @@ private:
 
 }  // namespace
 
-auto im3e::createAnariEngine(const ILogger& rLogger, std::shared_ptr<IDevice> pDevice, bool debugEnabled)
-    -> std::unique_ptr<IAnariEngine>
+auto im3e::createAnariEngine(const ILogger& rLogger, std::shared_ptr<IDevice> pDevice, bool debugEnabled,
+                             std::string_view anLibName) -> std::unique_ptr<IAnariEngine>
 {
-    return std::make_unique<AnariEngine>(rLogger, std::move(pDevice), debugEnabled);
+    return std::make_unique<AnariEngine>(rLogger, std::move(pDevice), debugEnabled, anLibName);
 }
\ No newline at end of file
@@ -2,12 +2,25 @@
 
 #include <im3e/utils/core/throw_utils.h>
 
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <future>
+#include <iterator>
 
 using namespace im3e;
 
 namespace {
 
+// Time after the last camera move from which the camera is considered idle and frames are rendered at full resolution:
+constexpr auto CameraIdleDelay = std::chrono::milliseconds(250);
+
+// Period over which frames are counted to publish the frame rates:
+constexpr auto FrameRatePeriod = std::chrono::seconds(1);
+
 auto createFrame(const ILogger& rLogger, ANARIDevice anDevice, ANARIRenderer anRenderer, ANARICamera anCamera,
                  ANARIWorld anWorld, const VkExtent2D& rWindowSize)
 {
@@ -30,28 +43,48 @@ auto createFrame(const ILogger& rLogger, ANARIDevice anDevice, ANARIRenderer anR
     return pFrame;
 }
 
-void copyFrame(IStatsProvider& rStatsProvider, ANARIDevice anDevice, ANARIFrame anFrame, IHostVisibleImage& dstImage)
+auto copyFrame(IStatsProvider& rStatsProvider, ANARIDevice anDevice, ANARIFrame anFrame, IHostVisibleImage& dstImage)
 {
     auto pCopyFrameSpan = rStatsProvider.startScopedSpan("copyFrame");
 
     VkExtent2D srcSize{};
     ANARIDataType type = ANARI_UNKNOWN;
-    auto* pSrcPixels = reinterpret_cast<const uint32_t*>(
+    auto* pSrcPixels = reinterpret_cast<const uint8_t*>(
         anariMapFrame(anDevice, anFrame, "channel.color", &srcSize.width, &srcSize.height, &type));
     {
+        // Rows are copied as is, bottom row first as in ANARI, the blit to the output image flips them on the GPU:
         auto pVkImageMapping = dstImage.map();
         auto* pDstPixels = pVkImageMapping->getData();
         const auto dstRowPitch = pVkImageMapping->getRowPitch();
-        for (auto row = 0U; row < srcSize.height; row++)
+        const auto srcRowPitch = static_cast<VkDeviceSize>(srcSize.width) * sizeof(uint32_t);
+        if (dstRowPitch == srcRowPitch)
+        {
+            std::memcpy(pDstPixels, pSrcPixels, srcRowPitch * srcSize.height);
+        }
+        else
         {
-            // In ANARI, images start from the bottom instead of the top:
-            auto* pSrcRow = pSrcPixels + (srcSize.height - 1U - row) * srcSize.width;
-            auto* pDstRow = reinterpret_cast<uint32_t*>(pDstPixels + row * dstRowPitch);
-            std::copy(pSrcRow, pSrcRow + srcSize.width, pDstRow);
+            for (auto row = 0U; row < srcSize.height; row++)
+            {
+                std::memcpy(pDstPixels + row * dstRowPitch, pSrcPixels + row * srcRowPitch, srcRowPitch);
+            }
         }
         // pVkImageMapping->save("anari_output.png");
     }
     anariUnmapFrame(anDevice, anFrame, "channel.color");
+    return srcSize;
+}
+
+auto getFrameRenderTime(ANARIDevice anDevice, ANARIFrame anFrame, std::chrono::steady_clock::time_point renderStartTime)
+{
+    // Devices report the time spent rendering the frame, the time elapsed since the frame started otherwise:
+    float durationInSeconds{};
+    if (anariGetProperty(anDevice, anFrame, "duration", ANARI_FLOAT32, &durationInSeconds, sizeof(durationInSeconds),
+                         ANARI_NO_WAIT))
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::duration<float>(durationInSeconds));
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - renderStartTime);
 }
 
 inline void applyImageBarriersBeforeBlit(const ICommandBuffer& rCommandBuffer, IStatsProvider& rStatsProvider,
@@ -73,32 +106,38 @@ inline void applyImageBarriersBeforeBlit(const ICommandBuffer& rCommandBuffer, I
 }
 
 inline void blitToOutputImage(const VulkanDeviceFcts& rFcts, const ICommandBuffer& rCommandBuffer,
-                              IStatsProvider& rStatsProvider, IImage& rSrcImage, IImage& rDstImage)
+                              IStatsProvider& rStatsProvider, IImage& rSrcImage, const VkExtent2D& rSrcExtent,
+                              IImage& rDstImage)
 {
     auto pBlitSpan = rStatsProvider.startScopedSpan("bitToOutput");
 
     applyImageBarriersBeforeBlit(rCommandBuffer, rStatsProvider, rSrcImage, rDstImage);
 
-    const auto vkExtent = rDstImage.getVkExtent();
-
-    const VkImageSubresourceLayers vkSubresourceLayers{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1U};
-    const VkOffset3D vkStartOffset{};
-    const VkOffset3D vkEndOffset{
-        .x = vkStartOffset.x + static_cast<int32_t>(vkExtent.width),
-        .y = vkStartOffset.y + static_cast<int32_t>(vkExtent.height),
+    const auto vkDstExtent = rDstImage.getVkExtent();
+    const VkOffset3D vkSrcSize{
+        .x = static_cast<int32_t>(rSrcExtent.width),
+        .y = static_cast<int32_t>(rSrcExtent.height),
+        .z = 1,
+    };
+    const VkOffset3D vkDstSize{
+        .x = static_cast<int32_t>(vkDstExtent.width),
+        .y = static_cast<int32_t>(vkDstExtent.height),
         .z = 1,
     };
 
+    // In ANARI, images start from the bottom instead of the top. Swapping the source rows flips the image:
+    const VkImageSubresourceLayers vkSubresourceLayers{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1U};
     VkImageBlit vkImageBlit{
         .srcSubresource = vkSubresourceLayers,
-        .srcOffsets{vkStartOffset, vkEndOffset},
+        .srcOffsets{VkOffset3D{.x = 0, .y = vkSrcSize.y, .z = 0}, VkOffset3D{.x = vkSrcSize.x, .y = 0, .z = 1}},
         .dstSubresource = vkSubresourceLayers,
-        .dstOffsets{vkStartOffset, vkEndOffset},
+        .dstOffsets{VkOffset3D{}, vkDstSize},
     };
 
+    // Frames rendered at a lower resolution are upscaled to the output image:
     rFcts.vkCmdBlitImage(rCommandBuffer.getVkCommandBuffer(), rSrcImage.getVkImage(),
                          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, rDstImage.getVkImage(),
-                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1U, &vkImageBlit, VK_FILTER_NEAREST);
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1U, &vkImageBlit, VK_FILTER_LINEAR);
 }
 
 }  // namespace
@@ -109,9 +148,13 @@ AnariFramePipeline::AnariFramePipeline(std::shared_ptr<IDevice> pDevice, std::sh
   , m_pLogger(m_pAnDevice->createLogger("ANARI Frame Pipeline"))
 
   , m_pAnRenderer(std::make_unique<AnariRenderer>(m_pAnDevice))
-  , m_pAnWorld(std::make_shared<AnariWorld>(m_pAnDevice))
+  , m_pAnWorld(std::make_shared<AnariWorld>(m_pAnDevice, m_pDevice->getStatsProvider()))
 
   , m_pCamera(std::make_shared<AnariMapCamera>(m_pAnDevice))
+  , m_pProperties(createPropertyGroup("Frame", {m_resolutionScaler.getProperties()}))
+  , m_pUiFrameRateGauge(m_pDevice->getStatsProvider()->getGauge("AnariFramePipeline.uiFrameRate"))
+  , m_pRenderFrameRateGauge(m_pDevice->getStatsProvider()->getGauge("AnariFramePipeline.renderFrameRate"))
+  , m_frameRateStartTime(std::chrono::steady_clock::now())
 {
     m_pLogger->debug("Successfully created");
 }
@@ -119,97 +162,192 @@ AnariFramePipeline::AnariFramePipeline(std::shared_ptr<IDevice> pDevice, std::sh
 void AnariFramePipeline::prepareExecution(const ICommandBuffer& rCommandBuffer, const VkExtent2D& rVkViewportSize,
                                           std::shared_ptr<IImage> pOutputImage)
 {
+    // Called at the UI rate, frames being rendered at their own pace:
     auto pStatsProvider = m_pDevice->getStatsProvider();
     auto pExecuteSpan = pStatsProvider->startScopedSpan("AnariFramePipeline.prepareExecution");
+    m_uiFrameCount++;
+    this->updateFrameRateGauges();
 
-    if (!m_pAnFrame)
+    if (m_frameSlots.empty())
     {
         m_pLogger->error("Cannot render panel, no size provided!");
         return;
     }
 
-    if (m_renderingFrame)
+    // The oldest frame is output once it completed, the display keeps showing the last rendered frame meanwhile so
+    // that slow renders do not hold the UI back:
+    auto& rFrameSlot = m_frameSlots[m_frameSlotIndex];
+    if (rFrameSlot.rendering && anariFrameReady(m_pAnDevice->getHandle(), rFrameSlot.pAnFrame.get(), ANARI_NO_WAIT))
     {
-        // Start the asynchronous update now so that the world has enough time to prepare the next frame while we wait
-        // for the current frame to complete and copy its results.
-        m_pAnWorld->updateAsync(*m_pCamera);
-
         auto pPipelineSpan = pStatsProvider->startScopedSpan("outputFrame");
+        rFrameSlot.rendering = false;
+        m_renderFrameCount++;
+        m_resolutionScaler.onFrameRendered(
+            rFrameSlot.scale,
+            getFrameRenderTime(m_pAnDevice->getHandle(), rFrameSlot.pAnFrame.get(), rFrameSlot.renderStartTime));
+
+        const auto imageIndex = this->findWritableOutputImage();
+        auto& rOutputImage = m_outputImages[imageIndex];
+        rOutputImage.vkFrameSize = copyFrame(*pStatsProvider, m_pAnDevice->getHandle(), rFrameSlot.pAnFrame.get(),
+                                             *rOutputImage.pImage);
+        m_displayedImageIndex = imageIndex;
+    }
+
+    if (m_displayedImageIndex)
+    {
+        auto& rOutputImage = m_outputImages[*m_displayedImageIndex];
+        auto& rImage = *rOutputImage.pImage;
+        blitToOutputImage(m_pDevice->getFcts(), rCommandBuffer, *pStatsProvider, rImage, rOutputImage.vkFrameSize,
+                          *pOutputImage);
         {
-            auto pFrameReadySpan = pStatsProvider->startScopedSpan("waitForFrame");
-            anariFrameReady(m_pAnDevice->getHandle(), m_pAnFrame.get(), ANARI_WAIT);
+            auto pBarrier = rCommandBuffer.startScopedBarrier("resetImageLayoutToGeneral");
+            pBarrier->addImageBarrier(rImage, ImageBarrierConfig{
+                                                  .vkDstStageMask = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+                                                  .vkDstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+                                                  .vkLayout = VK_IMAGE_LAYOUT_GENERAL,
+                                              });
         }
-        m_renderingFrame = false;
+        rOutputImage.lastBlitExecutionIndex = m_executionIndex;
+    }
+    m_executionIndex++;
 
-        if (m_currentViewportSize != rVkViewportSize)
-        {
-            auto pResizeSpan = pStatsProvider->startScopedSpan("resizeViewport");
+    if (rFrameSlot.rendering)
+    {
+        // All frame slots are still rendering:
+        return;
+    }
+    m_frameSlotIndex = (m_frameSlotIndex + 1U) % m_frameSlots.size();
 
-            const auto aspectRatio = static_cast<float>(rVkViewportSize.width) /
-                                     static_cast<float>(rVkViewportSize.height);
-            m_pCamera->setAspectRatio(aspectRatio);
+    // The camera keeps the viewport size so that the level of details of the tiles does not follow the frame size:
+    if (m_currentViewportSize != rVkViewportSize)
+    {
+        m_pCamera->setViewportSize(glm::u32vec2{rVkViewportSize.width, rVkViewportSize.height});
+        m_currentViewportSize = rVkViewportSize;
+    }
+
+    // Only update the world when a frame is about to render with it, tiles requested now are loaded in the background
+    // and uploaded when committing the next frames:
+    {
+        auto pWorldUpdateSpan = pStatsProvider->startScopedSpan("updateWorld");
+        m_pAnWorld->updateAsync(*m_pCamera);
+    }
 
-            anariSetParameter(m_pAnDevice->getHandle(), m_pAnFrame.get(), "size", ANARI_UINT32_VEC2, &rVkViewportSize);
-            anariCommitParameters(m_pAnDevice->getHandle(), m_pAnFrame.get());
+    // Render at a lower resolution while the camera moves, the output blit upscales the frame to the viewport size:
+    const auto cameraMoving = std::chrono::steady_clock::now() - m_pCamera->getLastMoveTime() < CameraIdleDelay;
+    rFrameSlot.scale = m_resolutionScaler.getScale(cameraMoving);
+    const auto vkFrameSize = AnariResolutionScaler::calculateFrameSize(rVkViewportSize, rFrameSlot.scale);
+    if (rFrameSlot.vkSize != vkFrameSize)
+    {
+        auto pResizeSpan = pStatsProvider->startScopedSpan("resizeFrame");
 
-            m_currentViewportSize = rVkViewportSize;
-        }
+        anariSetParameter(m_pAnDevice->getHandle(), rFrameSlot.pAnFrame.get(), "size", ANARI_UINT32_VEC2,
+                          &vkFrameSize);
+        anariCommitParameters(m_pAnDevice->getHandle(), rFrameSlot.pAnFrame.get());
+        rFrameSlot.vkSize = vkFrameSize;
+    }
 
-        // Perform the expensive copy before we commit changes for the next frame so that the world has enough time
-        // to update its internal state before committing.
-        copyFrame(*pStatsProvider, m_pAnDevice->getHandle(), m_pAnFrame.get(), *m_pImage);
+    // The camera, renderer and world are shared by the frame slots and the frames in flight read them while rendering.
+    // Frames rendered without any change overlap, changes are only committed once the other frames completed:
+    if (m_pCamera->hasPendingChanges() || m_pAnRenderer->hasPendingChanges() || m_pAnWorld->hasPendingChanges())
+    {
+        auto pWaitSpan = pStatsProvider->startScopedSpan("waitForFramesInFlight");
+        this->waitForFramesInFlight();
+    }
+    {
+        auto pCameraCommitSpan = pStatsProvider->startScopedSpan("commitCamera");
+        m_pCamera->commitChanges();
+    }
+    {
+        auto pRendererCommitSpan = pStatsProvider->startScopedSpan("commitRenderer");
+        m_pAnRenderer->commitChanges();
+    }
+    {
+        auto pWorldCommitSpan = pStatsProvider->startScopedSpan("commitWorld");
+        m_pAnWorld->commitChanges();
+    }
 
+    auto pRenderSpan = pStatsProvider->startScopedSpan("anariRenderFrame");
+    rFrameSlot.renderStartTime = std::chrono::steady_clock::now();
+    anariRenderFrame(m_pAnDevice->getHandle(), rFrameSlot.pAnFrame.get());
+    rFrameSlot.rendering = true;
+}
+
+void AnariFramePipeline::waitForFramesInFlight()
+{
+    for (auto& rFrameSlot : m_frameSlots)
+    {
+        if (rFrameSlot.rendering)
         {
-            auto pCameraCommitSpan = pStatsProvider->startScopedSpan("commitCamera");
-            m_pCamera->commitChanges();
-        }
-        {
-            auto pRendererCommitSpan = pStatsProvider->startScopedSpan("commitRenderer");
-            m_pAnRenderer->commitChanges();
-        }
-        {
-            auto pWorldCommitSpan = pStatsProvider->startScopedSpan("commitWorld");
-            m_pAnWorld->commitChanges();
-        }
-        blitToOutputImage(m_pDevice->getFcts(), rCommandBuffer, *pStatsProvider, *m_pImage, *pOutputImage);
-        {
-            auto pBarrier = rCommandBuffer.startScopedBarrier("resetImageLayoutToGeneral");
-            pBarrier->addImageBarrier(*m_pImage, ImageBarrierConfig{
-                                                     .vkDstStageMask = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
-                                                     .vkDstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
-                                                     .vkLayout = VK_IMAGE_LAYOUT_GENERAL,
-                                                 });
+            anariFrameReady(m_pAnDevice->getHandle(), rFrameSlot.pAnFrame.get(), ANARI_WAIT);
         }
     }
-
-    auto pRenderSpan = pStatsProvider->startScopedSpan("anariRenderFrame");
-    anariRenderFrame(m_pAnDevice->getHandle(), m_pAnFrame.get());
-    m_renderingFrame = true;
 }
 
-void AnariFramePipeline::resize(const VkExtent2D& rVkExtent, uint32_t)
+void AnariFramePipeline::updateFrameRateGauges()
 {
-    m_pAnFrame.reset();
-    m_pImage.reset();
+    const auto time = std::chrono::steady_clock::now();
+    const auto elapsedTime = std::chrono::duration<double>(time - m_frameRateStartTime);
+    if (elapsedTime < FrameRatePeriod)
+    {
+        return;
+    }
 
-    m_pAnFrame = createFrame(*m_pLogger, m_pAnDevice->getHandle(), m_pAnRenderer->getHandle(), m_pCamera->getHandle(),
-                             m_pAnWorld->getHandle(), rVkExtent);
+    m_pUiFrameRateGauge->set(std::lround(m_uiFrameCount / elapsedTime.count()));
+    m_pRenderFrameRateGauge->set(std::lround(m_renderFrameCount / elapsedTime.count()));
+    m_frameRateStartTime = time;
+    m_uiFrameCount = 0U;
+    m_renderFrameCount = 0U;
+}
 
-    m_pImage = m_pDevice->getImageFactory()->createHostVisibleImage(ImageConfig{
-        .name = "AnariPipelineImage",
-        .vkExtent = rVkExtent,
-        .vkFormat = VK_FORMAT_R8G8B8A8_UNORM,
-        .vkUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+auto AnariFramePipeline::findWritableOutputImage() const -> size_t
+{
+    // Images blitted by one of the last executions may still be read by a frame in flight:
+    auto itFind = std::ranges::find_if(m_outputImages, [this](auto& rOutputImage) {
+        return !rOutputImage.lastBlitExecutionIndex ||
+               *rOutputImage.lastBlitExecutionIndex + m_frameInFlightCount <= m_executionIndex;
     });
+    throwIfFalse<std::logic_error>(itFind != m_outputImages.end(), "No ANARI output image available for writing");
+    return static_cast<size_t>(std::distance(m_outputImages.begin(), itFind));
+}
+
+void AnariFramePipeline::resize(const VkExtent2D& rVkExtent, uint32_t frameInFlightCount)
+{
+    // Frames still rendering must complete before being released:
+    this->waitForFramesInFlight();
+    m_frameSlots.clear();
+    m_frameSlotIndex = 0U;
+    m_outputImages.clear();
+    m_displayedImageIndex.reset();
+    m_executionIndex = 0U;
+    m_frameInFlightCount = std::max(frameInFlightCount, 1U);
+
+    for (auto slotIndex = 0U; slotIndex < m_frameInFlightCount; slotIndex++)
+    {
+        m_frameSlots.emplace_back(FrameSlot{
+            .pAnFrame = createFrame(*m_pLogger, m_pAnDevice->getHandle(), m_pAnRenderer->getHandle(),
+                                    m_pCamera->getHandle(), m_pAnWorld->getHandle(), rVkExtent),
+            .vkSize = rVkExtent,
+        });
+    }
+
+    auto pCommandBuffer = m_pDevice->getCommandQueue()->startScopedCommand("AnariFramePipeline",
+                                                                           CommandExecutionType::Sync);
+    auto pBarrier = pCommandBuffer->startScopedBarrier("initializeImages");
+    for (auto imageIndex = 0U; imageIndex < m_frameInFlightCount + 1U; imageIndex++)
     {
-        auto pCommandBuffer = m_pDevice->getCommandQueue()->startScopedCommand("AnariFramePipeline",
-                                                                               CommandExecutionType::Sync);
-        auto pBarrier = pCommandBuffer->startScopedBarrier("initializeImage");
-        pBarrier->addImageBarrier(*m_pImage, ImageBarrierConfig{
-                                                 .vkDstStageMask = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
-                                                 .vkDstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
-                                                 .vkLayout = VK_IMAGE_LAYOUT_GENERAL,
-                                             });
+        auto& rOutputImage = m_outputImages.emplace_back(OutputImage{
+            .pImage = m_pDevice->getImageFactory()->createHostVisibleImage(ImageConfig{
+                .name = fmt::format("AnariPipelineImage{}", imageIndex),
+                .vkExtent = rVkExtent,
+                .vkFormat = VK_FORMAT_R8G8B8A8_UNORM,
+                .vkUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            }),
+        });
+        pBarrier->addImageBarrier(*rOutputImage.pImage, ImageBarrierConfig{
+                                                            .vkDstStageMask = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+                                                            .vkDstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+                                                            .vkLayout = VK_IMAGE_LAYOUT_GENERAL,
+                                                        });
     }
 
     m_currentViewportSize = {};
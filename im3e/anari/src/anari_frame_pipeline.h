@@ -3,16 +3,21 @@
 #include "anari_device.h"
 #include "anari_map_camera.h"
 #include "anari_renderer.h"
+#include "anari_resolution_scaler.h"
 #include "anari_world.h"
 
 #include <im3e/api/device.h>
 #include <im3e/api/frame_pipeline.h>
 #include <im3e/api/image.h>
 #include <im3e/utils/core/types.h>
+#include <im3e/utils/stats.h>
 
 #include <anari/anari.h>
 
+#include <chrono>
 #include <memory>
+#include <optional>
+#include <vector>
 
 namespace im3e {
 
@@ -27,6 +32,7 @@ public:
     void resize(const VkExtent2D& rWindowSize, uint32_t frameInFlightCount) override;
 
     auto createRendererProperties() -> std::shared_ptr<IPropertyGroup> override;
+    auto getProperties() -> std::shared_ptr<IPropertyGroup> override { return m_pProperties; }
 
     auto getCameraListener() -> std::shared_ptr<IGuiEventListener> override { return m_pCamera; }
     auto getWorld() -> std::shared_ptr<IAnariWorld> override { return m_pAnWorld; }
@@ -40,11 +46,55 @@ private:
     std::shared_ptr<AnariWorld> m_pAnWorld;
 
     std::shared_ptr<AnariMapCamera> m_pCamera;
-    UniquePtrWithDeleter<anari::api::Frame> m_pAnFrame;
-    std::unique_ptr<IHostVisibleImage> m_pImage;
+
+    AnariResolutionScaler m_resolutionScaler;
+    std::shared_ptr<IPropertyGroup> m_pProperties;
+
+    /// @return Index of an output image that none of the frames in flight is reading from.
+    auto findWritableOutputImage() const -> size_t;
+
+    /// @brief Wait for the frames still rendering to complete, they remain to be output.
+    void waitForFramesInFlight();
+
+    /// @brief Publish the UI and render frame rates once enough frames were counted to average them.
+    void updateFrameRateGauges();
+
+    // One ANARI frame per frame in flight, rendered in turn so that the next frames render while the oldest one is
+    // copied:
+    struct FrameSlot
+    {
+        UniquePtrWithDeleter<anari::api::Frame> pAnFrame;
+        VkExtent2D vkSize{};
+        float scale = 1.0F;
+        std::chrono::steady_clock::time_point renderStartTime;
+        bool rendering{};
+    };
+    std::vector<FrameSlot> m_frameSlots;
+    size_t m_frameSlotIndex{};
+
+    // Images receiving the rendered frames. The last rendered frame is blitted at every execution until a new frame is
+    // ready, one more image than frames in flight guarantees that a completed frame can be copied to an image that the
+    // frames in flight no longer read:
+    struct OutputImage
+    {
+        std::unique_ptr<IHostVisibleImage> pImage;
+        VkExtent2D vkFrameSize{};  // size of the frame copied to the image, lower than the image size when scaled
+        std::optional<uint64_t> lastBlitExecutionIndex;
+    };
+    std::vector<OutputImage> m_outputImages;
+    std::optional<size_t> m_displayedImageIndex;
+    uint64_t m_executionIndex{};
+    uint32_t m_frameInFlightCount{};
 
     VkExtent2D m_currentViewportSize{};
-    bool m_renderingFrame = false;
+
+    // Frame rates in frames per second, averaged from the executions (UI frames) and rendered frames counted since the
+    // start time:
+    std::shared_ptr<Gauge> m_pUiFrameRateGauge;
+    std::shared_ptr<Gauge> m_pRenderFrameRateGauge;
+    std::chrono::steady_clock::time_point m_frameRateStartTime;
+    uint32_t m_uiFrameCount{};
+    uint32_t m_renderFrameCount{};
 };
 
 }  // namespace im3e
\ No newline at end of file
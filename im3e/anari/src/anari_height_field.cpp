@@ -5,112 +5,298 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <chrono>
+#include <iterator>
 #include <ranges>
 
 using namespace im3e;
 
 namespace {
 
-auto initializeTiles(std::shared_ptr<AnariDevice> pAnDevice, const glm::u32vec2& rTileSize, size_t count)
+// Maximum time spent uploading loaded tiles to ANARI per frame, so that a burst of loaded tiles cannot stall the frame:
+constexpr auto TileUploadTimeBudget = std::chrono::milliseconds(4);
+
+// Tiles no longer displayed are released once unused for this long, or when more of them are kept than displayed
+// tiles (and the minimum below), so that small views do not pin the memory of tiles seen long ago:
+constexpr auto UnusedTileLifetime = std::chrono::seconds(30);
+constexpr size_t MinUnusedTileCount = 64U;
+
+auto calculateMaxTileByteSize(const glm::u32vec2& rTileSize)
 {
-    std::vector<std::unique_ptr<AnariHeightFieldTile>> pTiles(count);
-    std::ranges::generate(pTiles, [&] { return std::make_unique<AnariHeightFieldTile>(pAnDevice, rTileSize); });
-    return pTiles;
+    // Most tiles are fully valid: one vertex per sample, their triangles being shared with the other tiles.
+    return static_cast<size_t>(rTileSize.x) * rTileSize.y * sizeof(glm::vec3);
 }
 
 }  // namespace
 
 AnariHeightField::AnariHeightField(std::shared_ptr<AnariDevice> pAnDevice, AnariInstanceSet& rInstanceSet,
-                                   std::unique_ptr<IHeightMap> pHeightMap)
+                                   AnariTileMemoryBudget& rTileMemoryBudget, ThreadPool& rTileLoaderThreadPool,
+                                   IStatsProvider& rStatsProvider, std::unique_ptr<IHeightMap> pHeightMap)
   : m_pAnDevice(throwIfArgNull(std::move(pAnDevice), "ANARI Height Field requires a device"))
   , m_rInstanceSet(rInstanceSet)
+  , m_rTileMemoryBudget(rTileMemoryBudget)
   , m_pHeightMap(throwIfArgNull(std::move(pHeightMap), "ANARI Height Map requires a height map"))
   , m_pLogger(m_pAnDevice->createLogger(fmt::format("ANARI Height Field - {}", m_pHeightMap->getName())))
-  , m_pQuadTreeRoot(generateHeightMapQuadTree(*m_pHeightMap))
-
-  , m_pLodProp(std::make_shared<PropertyValue<uint32_t>>(PropertyValueConfig<uint32_t>{
-        .name = "Level of Details",
-        .description = "Determines level of details of the height field where 0 is highest details.",
-        .defaultValue = 5U,
-        .minValue = 0U,
-        .maxValue = m_pHeightMap->getLodCount() - 1U,
-        .onChange = [this](auto) { m_lodChanged = true; },
+  , m_quadTree(*m_pHeightMap)
+  , m_maxTileByteSize(calculateMaxTileByteSize(m_pHeightMap->getTileSize()))
+
+  , m_pMaxScreenSpaceErrorProp(std::make_shared<PropertyValue<float>>(PropertyValueConfig<float>{
+        .name = "Max Screen Space Error",
+        .description = "Maximum error in pixels of displayed tiles, higher values display coarser levels of details.",
+        .defaultValue = 2.0F,
+        .minValue = 0.5F,
+        .maxValue = 64.0F,
     }))
-  , m_pProperties(createPropertyGroup(m_pHeightMap->getName(), {m_pLodProp}))
+  , m_pProperties(createPropertyGroup(m_pHeightMap->getName(), {m_pMaxScreenSpaceErrorProp}))
+  , m_pVisibleTileGauge(rStatsProvider.getGauge(fmt::format("{}.visibleTiles", m_pHeightMap->getName())))
+  , m_pResidentTileGauge(rStatsProvider.getGauge(fmt::format("{}.residentTiles", m_pHeightMap->getName())))
+  , m_pPendingTileGauge(rStatsProvider.getGauge(fmt::format("{}.pendingTileRequests", m_pHeightMap->getName())))
+  , m_pTileUploadCounter(rStatsProvider.getCounter(fmt::format("{}.tileUploads", m_pHeightMap->getName())))
+  , m_gridTopologies(m_pAnDevice)
 
-  , m_pTiles(initializeTiles(m_pAnDevice, m_pHeightMap->getTileSize(), 100U))
-  , m_pAvailableTilesQueue([this] {
-      std::deque<AnariHeightFieldTile*> pAvailableTilesQueue;
-      for (auto& rpTile : m_pTiles)
-      {
-          pAvailableTilesQueue.emplace_back(rpTile.get());
-      }
-      return pAvailableTilesQueue;
-  }())
+  , m_streamer(*m_pLogger, *m_pHeightMap, rTileLoaderThreadPool)
 {
+    m_rTileMemoryBudget.addClient(*this);
 }
 
-void AnariHeightField::updateAsync([[maybe_unused]] const AnariMapCamera& rCamera)
+AnariHeightField::~AnariHeightField()
 {
+    m_rTileMemoryBudget.removeClient(*this);
+
+    m_pVisibleTiles.clear();
+    for (auto& [rpTileKey, rpTile] : m_pTiles)
+    {
+        m_rTileMemoryBudget.free(rpTile->getByteSize());
+    }
+}
+
+void AnariHeightField::updateAsync(const AnariMapCamera& rCamera)
+{
+    // Select as many tiles as the budget holds when fully valid, the budget is shared with the other height fields:
+    const auto maxTileCount = static_cast<uint32_t>(
+        std::max<size_t>(m_rTileMemoryBudget.getByteBudget() / m_maxTileByteSize, 1U));
+
     // TODO: frustum culling not fully working.
     // When zoomed out and switching between levels of details, some tiles that should be visible are not
-    auto visibleTileIDs = m_pQuadTreeRoot->findVisible(rCamera.getViewFrustum(), m_pLodProp->getValue());
-    m_pLogger->debug(fmt::format("Found {} visible tiles", visibleTileIDs.size()));
+    const auto selection = m_quadTree.selectTiles(rCamera.getViewFrustum(),
+                                                  HeightMapTileSelectionConfig{
+                                                      .viewPosition = rCamera.getPosition(),
+                                                      .projectionScale = rCamera.getProjectionScale(),
+                                                      .maxScreenSpaceError = m_pMaxScreenSpaceErrorProp->getValue(),
+                                                      .maxTileCount = maxTileCount,
+                                                      .isTileReady = [this](auto& rTileID) {
+                                                          return this->isTileReady(rTileID);
+                                                      },
+                                                  });
+    m_pLogger->debug(fmt::format("Selected {} visible tiles, {} missing", selection.tileIDs.size(),
+                                 selection.missingTileIDs.size()));
+
+    m_visibleTileIDs = std::unordered_set<TileID>(selection.tileIDs.begin(), selection.tileIDs.end());
+    m_wantedTileIDs = m_visibleTileIDs;
+    m_wantedTileIDs.insert(selection.missingTileIDs.begin(), selection.missingTileIDs.end());
+    m_streamer.cancelStaleRequests(m_wantedTileIDs);
 
-    // Removed no longer visible tiles
-    auto visibleTileIt = m_pVisibleTiles.begin();
-    while (visibleTileIt != m_pVisibleTiles.end())
+    // Remove no longer visible tiles, they become the most recently used available tiles:
+    std::erase_if(m_pVisibleTiles, [&](auto& rVisibleTile) { return !m_visibleTileIDs.contains(rVisibleTile.first); });
+
+    // Display visible tiles whose data is already loaded in an available tile instead of reloading the data:
+    for (auto& rVisibleTileID : selection.tileIDs)
     {
-        auto& rpVisibleTile = *visibleTileIt;
-        if (auto itFind = std::ranges::find(visibleTileIDs, rpVisibleTile->getTileID()); itFind != visibleTileIDs.end())
+        if (m_pVisibleTiles.contains(rVisibleTileID))
         {
-            visibleTileIDs.erase(itFind);
-            visibleTileIt++;
             continue;
         }
-        visibleTileIt = m_pVisibleTiles.erase(visibleTileIt);
+        if (auto itFind = m_tileIDToAvailableTile.find(rVisibleTileID); itFind != m_tileIDToAvailableTile.end())
+        {
+            auto pTile = itFind->second->pTile;
+            m_availableTiles.erase(itFind->second);
+            m_tileIDToAvailableTile.erase(itFind);
+            this->useAvailableTile(pTile);
+        }
     }
+    this->releaseUnusedTiles();
 
-    auto useAvailableTile = [&](AnariHeightFieldTile* pTile) {
-        m_rInstanceSet.insert(pTile->getInstance());
-        m_pVisibleTiles.emplace_back(
-            UniquePtrWithDeleter<AnariHeightFieldTile>(pTile, [this](AnariHeightFieldTile* pTile) {
-                m_rInstanceSet.remove(pTile->getInstance());
-                m_pAvailableTilesQueue.emplace_back(pTile);
-            }));
-    };
-
-    // Insert visible tiles that are not loaded yet:
-    for (auto& rVisibleTileID : visibleTileIDs)
+    // Request missing tiles, most needed first:
+    for (auto& rMissingTileID : selection.missingTileIDs)
     {
-        // See if any available tile already has the data. If so, let's reuse it instead of reloading the data:
-        if (auto itFind = std::ranges::find_if(
-                m_pAvailableTilesQueue,
-                [&](auto& rpAvailableTile) { return rpAvailableTile->getTileID() == rVisibleTileID; });
-            itFind != m_pAvailableTilesQueue.end())
+        if (m_emptyTileIDs.contains(rMissingTileID) || m_streamer.isPending(rMissingTileID))
         {
-            auto pTile = *itFind;
-            m_pAvailableTilesQueue.erase(itFind);
-            useAvailableTile(pTile);
             continue;
         }
 
-        // If we reach this point, the current tile must be loaded from any available tile or skip the tile if we no
-        // longer have any available tile:
-        if (m_pAvailableTilesQueue.empty())
+        // Do not request more tiles than we can hold, tiles that do not fit are skipped:
+        if (m_pVisibleTiles.size() + m_streamer.getPendingCount() >= maxTileCount)
         {
-            continue;
+            break;
         }
-        auto pAvailableTile = m_pAvailableTilesQueue.front();
-        if (pAvailableTile->load(*m_pHeightMap->getTileSampler(rVisibleTileID)))
+        m_streamer.request(rMissingTileID);
+    }
+    this->updateGauges();
+}
+
+void AnariHeightField::commitChanges()
+{
+    const auto uploadDeadline = std::chrono::steady_clock::now() + TileUploadTimeBudget;
+    while (std::chrono::steady_clock::now() < uploadDeadline)
+    {
+        auto geometry = m_streamer.popCompleted();
+        if (!geometry)
         {
-            m_pAvailableTilesQueue.pop_front();
-            useAvailableTile(pAvailableTile);
+            break;
         }
+        this->uploadTile(*geometry);
     }
+
+    std::ranges::for_each(m_pDirtyTiles, [](auto* pTile) { pTile->commitChanges(); });
+    m_pDirtyTiles.clear();
+    this->updateGauges();
 }
 
-void AnariHeightField::commitChanges()
+auto AnariHeightField::hasPendingChanges() const -> bool
+{
+    return !m_pDirtyTiles.empty() || m_streamer.hasCompleted();
+}
+
+auto AnariHeightField::isTileReady(const TileID& rTileID) const -> bool
+{
+    // Empty tiles have nothing to display and are always ready:
+    return m_emptyTileIDs.contains(rTileID) || m_pVisibleTiles.contains(rTileID) ||
+           m_tileIDToAvailableTile.contains(rTileID);
+}
+
+void AnariHeightField::useAvailableTile(AnariHeightFieldTile* pTile)
+{
+    m_rInstanceSet.insert(pTile->getInstance());
+    m_pVisibleTiles.insert_or_assign(
+        *pTile->getTileID(), UniquePtrWithDeleter<AnariHeightFieldTile>(pTile, [this](AnariHeightFieldTile* pTile) {
+            m_rInstanceSet.remove(pTile->getInstance());
+            this->makeTileAvailable(pTile);
+        }));
+}
+
+auto AnariHeightField::getLeastRecentUseTime() const -> std::optional<std::chrono::steady_clock::time_point>
+{
+    if (m_availableTiles.empty())
+    {
+        return std::nullopt;
+    }
+    return m_availableTiles.front().lastUseTime;
+}
+
+void AnariHeightField::releaseLeastRecentlyUsedTile()
+{
+    this->destroyTile(this->takeLeastRecentlyUsedTile());
+}
+
+void AnariHeightField::releaseUnusedTiles()
+{
+    const auto maxUnusedTileCount = std::max(m_pVisibleTiles.size(), MinUnusedTileCount);
+    const auto oldestUseTime = std::chrono::steady_clock::now() - UnusedTileLifetime;
+    while (!m_availableTiles.empty())
+    {
+        // Wanted tiles are loaded children waiting for their siblings, they are kept to replace their parent:
+        const auto& rOldestTile = m_availableTiles.front();
+        const auto tileID = rOldestTile.pTile->getTileID();
+        if ((tileID && m_wantedTileIDs.contains(*tileID)) ||
+            (m_availableTiles.size() <= maxUnusedTileCount && rOldestTile.lastUseTime >= oldestUseTime))
+        {
+            break;
+        }
+        this->releaseLeastRecentlyUsedTile();
+    }
+}
+
+void AnariHeightField::makeTileAvailable(AnariHeightFieldTile* pTile)
+{
+    m_availableTiles.emplace_back(AvailableTile{.pTile = pTile, .lastUseTime = std::chrono::steady_clock::now()});
+    if (const auto tileID = pTile->getTileID())
+    {
+        m_tileIDToAvailableTile.insert_or_assign(*tileID, std::prev(m_availableTiles.end()));
+    }
+}
+
+auto AnariHeightField::takeLeastRecentlyUsedTile() -> AnariHeightFieldTile*
+{
+    auto pTile = m_availableTiles.front().pTile;
+    if (const auto tileID = pTile->getTileID())
+    {
+        // Only forget the tile ID if it was not loaded again in a more recently used tile meanwhile:
+        if (auto itFind = m_tileIDToAvailableTile.find(*tileID);
+            itFind != m_tileIDToAvailableTile.end() && itFind->second == m_availableTiles.begin())
+        {
+            m_tileIDToAvailableTile.erase(itFind);
+        }
+    }
+    m_availableTiles.pop_front();
+    return pTile;
+}
+
+void AnariHeightField::destroyTile(AnariHeightFieldTile* pTile)
+{
+    m_rTileMemoryBudget.free(pTile->getByteSize());
+    m_pDirtyTiles.erase(pTile);
+    m_pTiles.erase(pTile);
+}
+
+void AnariHeightField::uploadTile(const HeightFieldTileGeometry& rGeometry)
+{
+    if (rGeometry.isEmpty())
+    {
+        m_emptyTileIDs.emplace(rGeometry.tileID);
+        return;
+    }
+
+    // The camera may have moved since the tile was requested:
+    if (!m_wantedTileIDs.contains(rGeometry.tileID))
+    {
+        return;
+    }
+
+    // Once the budget is full, recycle the least recently used tile of this height field rather than creating new
+    // ANARI objects. Otherwise the pool grows with a new tile:
+    const auto byteSize = rGeometry.getByteSize();
+    AnariHeightFieldTile* pTile{};
+    if (m_rTileMemoryBudget.getByteSize() + byteSize > m_rTileMemoryBudget.getByteBudget() &&
+        !m_availableTiles.empty())
+    {
+        pTile = this->takeLeastRecentlyUsedTile();
+        m_rTileMemoryBudget.free(pTile->getByteSize());
+    }
+    if (!m_rTileMemoryBudget.allocate(byteSize))
+    {
+        // Displayed tiles of all height fields already use the whole budget:
+        m_pLogger->debug(fmt::format("Tile memory budget exhausted, skipped tile ({}; {}; {})", rGeometry.tileID.x,
+                                     rGeometry.tileID.y, rGeometry.tileID.z));
+        if (pTile)
+        {
+            // Bytes of the recycled tile were already freed:
+            m_pDirtyTiles.erase(pTile);
+            m_pTiles.erase(pTile);
+        }
+        return;
+    }
+    if (!pTile)
+    {
+        auto pNewTile = std::make_unique<AnariHeightFieldTile>(m_pAnDevice, m_gridTopologies);
+        pTile = pNewTile.get();
+        m_pTiles.emplace(pTile, std::move(pNewTile));
+    }
+
+    pTile->load(rGeometry);
+    m_pDirtyTiles.insert(pTile);
+    m_pTileUploadCounter->add();
+    if (!m_visibleTileIDs.contains(rGeometry.tileID))
+    {
+        // Child of a visible tile, kept aside until all of its visible siblings are loaded to replace their parent:
+        this->makeTileAvailable(pTile);
+        return;
+    }
+    this->useAvailableTile(pTile);
+}
+
+void AnariHeightField::updateGauges()
 {
-    std::ranges::for_each(m_pTiles, [](auto& rpTile) { rpTile->commitChanges(); });
+    m_pVisibleTileGauge->set(static_cast<int64_t>(m_pVisibleTiles.size()));
+    m_pResidentTileGauge->set(static_cast<int64_t>(m_pTiles.size()));
+    m_pPendingTileGauge->set(static_cast<int64_t>(m_streamer.getPendingCount()));
 }
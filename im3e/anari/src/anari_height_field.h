@@ -2,51 +2,124 @@
 
 #include "anari.h"
 #include "anari_device.h"
+#include "anari_height_field_streamer.h"
 #include "anari_height_field_tile.h"
 #include "anari_instance_set.h"
 #include "anari_map_camera.h"
+#include "anari_tile_memory_budget.h"
 
 #include <im3e/api/height_map.h>
 #include <im3e/geo/geo.h>
 #include <im3e/utils/core/types.h>
 #include <im3e/utils/math_utils.h>
 #include <im3e/utils/properties/properties.h>
+#include <im3e/utils/stats.h>
+#include <im3e/utils/thread_pool.h>
 
 #include <chrono>
-#include <deque>
+#include <list>
 #include <map>
 #include <memory>
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace im3e {
 
-class AnariHeightField : public IAnariObject
+/// @brief Height map displayed as ANARI triangle meshes, one per tile.
+/// Tiles are created as they are loaded, their vertex and index arrays being allocated from the tile memory budget
+/// shared by the height fields of the world. Tiles that are no longer displayed keep their data until the budget
+/// requires releasing them, least recently used first, or until they stay unused for too long or are too many. Tile
+/// counts, pending tile requests and uploads are published as metrics of the stats provider, prefixed with the height
+/// map name.
+class AnariHeightField : public IAnariObject, public AnariTileMemoryBudget::IClient
 {
 public:
     AnariHeightField(std::shared_ptr<AnariDevice> pAnDevice, AnariInstanceSet& rInstanceSet,
-                     std::unique_ptr<IHeightMap> pHeightMap);
+                     AnariTileMemoryBudget& rTileMemoryBudget, ThreadPool& rTileLoaderThreadPool,
+                     IStatsProvider& rStatsProvider, std::unique_ptr<IHeightMap> pHeightMap);
+    ~AnariHeightField() override;
 
+    /// @brief Determine the tiles visible from the camera and request the missing ones to be loaded in the background.
+    /// Tiles are selected from mixed levels of details so that their screen space error stays below the "Max Screen
+    /// Space Error" property. Requests for tiles that are no longer needed are cancelled.
     void updateAsync(const AnariMapCamera& rCamera);
+
+    /// @brief Upload tiles that completed loading since the last call and commit tile changes.
+    /// Uploads stop once the per-frame time budget is exhausted, remaining tiles are uploaded on the next calls. Only
+    /// tiles loaded since the last call are committed.
     void commitChanges();
 
+    /// @return True if tiles completed loading or were loaded without being committed yet, i.e. if commitChanges has
+    /// something to do.
+    auto hasPendingChanges() const -> bool;
+
+    auto getLeastRecentUseTime() const -> std::optional<std::chrono::steady_clock::time_point> override;
+    void releaseLeastRecentlyUsedTile() override;
+
     auto getProperties() -> std::shared_ptr<IPropertyGroup> override { return m_pProperties; }
 
 private:
+    auto isTileReady(const TileID& rTileID) const -> bool;
+    void useAvailableTile(AnariHeightFieldTile* pTile);
+    void uploadTile(const HeightFieldTileGeometry& rGeometry);
+    void updateGauges();
+
+    /// @brief Release available tiles unused for too long, or in excess of the displayed tiles, oldest first.
+    void releaseUnusedTiles();
+
+    /// @brief Append the given tile to the available tiles, as the most recently used one.
+    void makeTileAvailable(AnariHeightFieldTile* pTile);
+
+    /// @brief Remove the least recently used available tile, so that it can be loaded with another tile's data.
+    auto takeLeastRecentlyUsedTile() -> AnariHeightFieldTile*;
+
+    /// @brief Destroy the given tile, which must not be visible nor available, and free its bytes from the budget.
+    /// The tile is no longer committed if it was loaded since the last commit.
+    void destroyTile(AnariHeightFieldTile* pTile);
+
     std::shared_ptr<AnariDevice> m_pAnDevice;
     AnariInstanceSet& m_rInstanceSet;
+    AnariTileMemoryBudget& m_rTileMemoryBudget;
     std::unique_ptr<IHeightMap> m_pHeightMap;
 
     std::unique_ptr<ILogger> m_pLogger;
-    std::shared_ptr<HeightMapQuadTreeNode> m_pQuadTreeRoot;
+    HeightMapQuadTree m_quadTree;
+    const size_t m_maxTileByteSize;
 
-    bool m_lodChanged = true;
-    std::shared_ptr<PropertyValue<uint32_t>> m_pLodProp;
+    std::shared_ptr<PropertyValue<float>> m_pMaxScreenSpaceErrorProp;
     std::shared_ptr<IPropertyGroup> m_pProperties;
 
-    std::vector<std::unique_ptr<AnariHeightFieldTile>> m_pTiles;
-    std::vector<UniquePtrWithDeleter<AnariHeightFieldTile>> m_pVisibleTiles;
-    std::deque<AnariHeightFieldTile*> m_pAvailableTilesQueue;
+    std::shared_ptr<Gauge> m_pVisibleTileGauge;
+    std::shared_ptr<Gauge> m_pResidentTileGauge;
+    std::shared_ptr<Gauge> m_pPendingTileGauge;
+    std::shared_ptr<Counter> m_pTileUploadCounter;
+
+    // Declared before the tiles which reference its arrays:
+    AnariHeightFieldGridTopologies m_gridTopologies;
+    std::unordered_map<const AnariHeightFieldTile*, std::unique_ptr<AnariHeightFieldTile>> m_pTiles;
+
+    // Tiles loaded since the last commit, so that committing does not go through all the tiles:
+    std::unordered_set<AnariHeightFieldTile*> m_pDirtyTiles;
+
+    // Tiles not displayed, least recently used first. Their data is kept until they are recycled so that tiles becoming
+    // visible again are displayed without being reloaded:
+    struct AvailableTile
+    {
+        AnariHeightFieldTile* pTile;
+        std::chrono::steady_clock::time_point lastUseTime;
+    };
+    std::list<AvailableTile> m_availableTiles;
+    std::unordered_map<TileID, std::list<AvailableTile>::iterator> m_tileIDToAvailableTile;
+
+    // Declared after the available tiles: visible tiles are made available again when destroyed.
+    std::unordered_map<TileID, UniquePtrWithDeleter<AnariHeightFieldTile>> m_pVisibleTiles;
+
+    std::unordered_set<TileID> m_visibleTileIDs;
+    std::unordered_set<TileID> m_wantedTileIDs;  // visible tiles and children loaded in the background
+    std::unordered_set<TileID> m_emptyTileIDs;  // tiles without data, unlike tiles that failed to load
+    AnariHeightFieldStreamer m_streamer;
 };
 
 }  // namespace im3e
\ No newline at end of file
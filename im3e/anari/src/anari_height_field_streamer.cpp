@@ -0,0 +1,144 @@
+#include "anari_height_field_streamer.h"
+
+#include <fmt/format.h>
+
+using namespace im3e;
+
+AnariHeightFieldStreamer::AnariHeightFieldStreamer(const ILogger& rLogger, IHeightMap& rHeightMap,
+                                                   ThreadPool& rThreadPool,
+                                                   std::chrono::milliseconds failedLoadRetryDelay)
+  : m_pLogger(rLogger.createChild("Streamer"))
+  , m_rHeightMap(rHeightMap)
+  , m_rThreadPool(rThreadPool)
+  , m_failedLoadRetryDelay(failedLoadRetryDelay)
+{
+}
+
+AnariHeightFieldStreamer::~AnariHeightFieldStreamer()
+{
+    std::unique_lock lk(m_mutex);
+    for (auto& [rTileID, rpRequest] : m_pPendingRequests)
+    {
+        rpRequest->cancelled = true;
+    }
+    m_pPendingRequests.clear();
+    m_completedTiles.clear();
+
+    // Worker threads reference this object and the height map: wait for all of them to be done before destruction.
+    m_loadCompleted.wait(lk, [this] { return m_loadsInFlightCount == 0U; });
+}
+
+void AnariHeightFieldStreamer::request(const TileID& rTileID)
+{
+    std::shared_ptr<Request> pRequest;
+    {
+        std::lock_guard lk(m_mutex);
+        if (auto itFailedLoad = m_failedLoadTimes.find(rTileID); itFailedLoad != m_failedLoadTimes.end())
+        {
+            if (std::chrono::steady_clock::now() < itFailedLoad->second + m_failedLoadRetryDelay)
+            {
+                return;
+            }
+            m_failedLoadTimes.erase(itFailedLoad);
+        }
+
+        auto [itRequest, inserted] = m_pPendingRequests.try_emplace(rTileID);
+        if (!inserted)
+        {
+            return;
+        }
+        pRequest = std::make_shared<Request>();
+        pRequest->tileID = rTileID;
+        itRequest->second = pRequest;
+        m_loadsInFlightCount++;
+    }
+
+    m_rThreadPool.submit([this, pRequest = std::move(pRequest)] {
+        if (!pRequest->cancelled)
+        {
+            this->loadTile(*pRequest);
+        }
+
+        std::lock_guard lk(m_mutex);
+        m_loadsInFlightCount--;
+        m_loadCompleted.notify_all();
+    });
+}
+
+void AnariHeightFieldStreamer::cancelStaleRequests(const std::unordered_set<TileID>& rWantedTileIDs)
+{
+    std::lock_guard lk(m_mutex);
+    std::erase_if(m_pPendingRequests, [&](auto& rPendingRequest) {
+        auto& [rTileID, rpRequest] = rPendingRequest;
+        if (rWantedTileIDs.contains(rTileID))
+        {
+            return false;
+        }
+        rpRequest->cancelled = true;
+        return true;
+    });
+    std::erase_if(m_completedTiles, [](auto& rCompletedTile) { return rCompletedTile.first->cancelled.load(); });
+}
+
+auto AnariHeightFieldStreamer::popCompleted() -> std::optional<HeightFieldTileGeometry>
+{
+    std::lock_guard lk(m_mutex);
+    if (m_completedTiles.empty())
+    {
+        return std::nullopt;
+    }
+
+    auto [pRequest, geometry] = std::move(m_completedTiles.front());
+    m_completedTiles.pop_front();
+    m_pPendingRequests.erase(pRequest->tileID);
+    return std::move(geometry);
+}
+
+auto AnariHeightFieldStreamer::hasCompleted() const -> bool
+{
+    std::lock_guard lk(m_mutex);
+    return !m_completedTiles.empty();
+}
+
+auto AnariHeightFieldStreamer::isPending(const TileID& rTileID) const -> bool
+{
+    std::lock_guard lk(m_mutex);
+    return m_pPendingRequests.contains(rTileID);
+}
+
+auto AnariHeightFieldStreamer::getPendingCount() const -> size_t
+{
+    std::lock_guard lk(m_mutex);
+    return m_pPendingRequests.size();
+}
+
+void AnariHeightFieldStreamer::loadTile(Request& rRequest)
+{
+    const auto& rTileID = rRequest.tileID;
+
+    std::optional<HeightFieldTileGeometry> geometry;
+    try
+    {
+        geometry = generateHeightFieldTileGeometry(*m_rHeightMap.getTileSampler(rTileID));
+    }
+    catch (const std::exception& rException)
+    {
+        m_pLogger->error(fmt::format("Failed to load tile ({}; {}; {}): {}", rTileID.x, rTileID.y, rTileID.z,
+                                     rException.what()));
+    }
+
+    std::lock_guard lk(m_mutex);
+    if (rRequest.cancelled)
+    {
+        return;
+    }
+    if (!geometry)
+    {
+        // Failed tiles are not reported as empty, the error may be transient e.g. a file being written:
+        m_pPendingRequests.erase(rTileID);
+        m_failedLoadTimes.insert_or_assign(rTileID, std::chrono::steady_clock::now());
+        return;
+    }
+    auto itRequest = m_pPendingRequests.find(rTileID);
+    m_completedTiles.emplace_back(itRequest->second, std::move(*geometry));
+}
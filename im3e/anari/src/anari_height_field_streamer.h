@@ -0,0 +1,82 @@
+#pragma once
+
+#include "anari_height_field_tile.h"
+
+#include <im3e/api/height_map.h>
+#include <im3e/utils/loggers.h>
+#include <im3e/utils/math_utils.h>
+#include <im3e/utils/thread_pool.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace im3e {
+
+/// @brief Loads height map tiles in the background.
+/// Tiles are requested from the render thread, decoded and triangulated by the worker threads of the given pool and
+/// made available through a completion queue that the render thread drains at its own pace. Tiles that fail to load
+/// are not completed, they can be requested again once the retry delay elapsed.
+class AnariHeightFieldStreamer
+{
+public:
+    static constexpr std::chrono::milliseconds DefaultFailedLoadRetryDelay{5000};
+
+    AnariHeightFieldStreamer(const ILogger& rLogger, IHeightMap& rHeightMap, ThreadPool& rThreadPool,
+                             std::chrono::milliseconds failedLoadRetryDelay = DefaultFailedLoadRetryDelay);
+
+    /// @brief Cancel all requests and wait for the tiles currently being loaded by worker threads.
+    ~AnariHeightFieldStreamer();
+
+    /// @brief Request the given tile to be loaded in the background.
+    /// Does nothing if the tile was already requested and is still pending, or if it failed to load less than the retry
+    /// delay ago.
+    void request(const TileID& rTileID);
+
+    /// @brief Cancel pending requests for tiles that are not in the given set.
+    /// Tiles that were cancelled before a worker picked them up are never loaded. Cancelled tiles that already
+    /// completed are discarded from the completion queue.
+    void cancelStaleRequests(const std::unordered_set<TileID>& rWantedTileIDs);
+
+    /// @brief Pop the next tile geometry that completed loading, if any.
+    /// Tiles that did not contain any data are returned with an empty geometry.
+    auto popCompleted() -> std::optional<HeightFieldTileGeometry>;
+
+    /// @return True if tiles completed loading and were not popped from the completion queue yet.
+    auto hasCompleted() const -> bool;
+
+    /// @return True if the tile was requested and was not popped from the completion queue yet.
+    auto isPending(const TileID& rTileID) const -> bool;
+    auto getPendingCount() const -> size_t;
+
+private:
+    struct Request
+    {
+        TileID tileID;
+        std::atomic_bool cancelled{};
+    };
+    void loadTile(Request& rRequest);
+
+    std::unique_ptr<ILogger> m_pLogger;
+    IHeightMap& m_rHeightMap;
+    ThreadPool& m_rThreadPool;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<TileID, std::shared_ptr<Request>> m_pPendingRequests;
+    std::deque<std::pair<std::shared_ptr<Request>, HeightFieldTileGeometry>> m_completedTiles;
+
+    // Tiles that failed to load, by time of failure, so that they are not requested over and over again:
+    const std::chrono::milliseconds m_failedLoadRetryDelay;
+    std::unordered_map<TileID, std::chrono::steady_clock::time_point> m_failedLoadTimes;
+
+    uint32_t m_loadsInFlightCount{};
+    std::condition_variable m_loadCompleted;
+};
+
+}  // namespace im3e
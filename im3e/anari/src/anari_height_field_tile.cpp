@@ -2,6 +2,10 @@
 
 #include <im3e/utils/core/throw_utils.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 using namespace im3e;
 
 namespace {
@@ -50,47 +54,126 @@ auto mapIndexBuffer(AnariDevice& rAnDevice, ANARIGeometry anGeometry, uint64_t t
                                               }};
 }
 
-auto initializeIndexBuffer(AnariDevice& rAnDevice, ANARIGeometry anGeometry, const glm::u32vec2& rTileSize)
+auto calculateGridTriangleCount(const glm::u32vec2& rSize)
 {
-    // Each row of vertices generate 2 triangles per vertex except for the last vertex of each row i.e. 2 * (width - 1).
-    // This applies to all rows except for the last one:
-    //     (height - 1) * trianglesPerRow = (height - 1) * 2 * (width - 1) = 2 * (width - 1) * (height - 1)
-    const auto triangleCount = 2U * static_cast<uint64_t>(rTileSize.x - 1U) * static_cast<uint64_t>(rTileSize.y - 1U);
+    // 2 triangles per quad of samples:
+    return 2U * static_cast<uint64_t>(rSize.x - 1U) * static_cast<uint64_t>(rSize.y - 1U);
+}
 
-    auto pIndices = mapIndexBuffer(rAnDevice, anGeometry, triangleCount);
-    auto pIndexIt = pIndices.get();
+}  // namespace
+
+auto im3e::generateHeightFieldTileGeometry(const IHeightMapTileSampler& rSampler) -> HeightFieldTileGeometry
+{
+    const auto scale = rSampler.getScale();
+    const auto& rSize = rSampler.getSize();
+    const auto& rActualSize = rSampler.getActualSize();
+
+    HeightFieldTileGeometry geometry{
+        .tileID = rSampler.getTileID(),
+        .size = rActualSize,
+        .origin = glm::vec2(rSampler.getPos() * rSize) * scale,
+        .scale = scale,
+        .heights = std::vector<float>(static_cast<size_t>(rActualSize.x) * static_cast<size_t>(rActualSize.y)),
+    };
 
-    auto toIndex = [&rTileSize](uint32_t x, uint32_t y) { return rTileSize.x * y + x; };
+    // Read the whole tile at once rather than sample by sample:
+    const auto sampleCount = static_cast<size_t>(rSize.x) * static_cast<size_t>(rActualSize.y);
+    std::vector<float> heights(sampleCount);
+    std::vector<uint8_t> validity(sampleCount);
+    rSampler.copyRows(0U, rActualSize.y, heights);
+    rSampler.copyMaskRows(0U, rActualSize.y, validity);
+    auto isValid = [&](uint32_t x, uint32_t y) { return validity[rSize.x * y + x] != 0U; };
 
-    for (uint32_t y = 0U; y < rTileSize.y - 1U; y++)
+    // Rows of the sampler are padded to the full tile width:
+    auto pHeightIt = geometry.heights.data();
+    for (uint32_t y = 0U; y < rActualSize.y; y++)
     {
-        for (uint32_t x = 0U; x < rTileSize.x - 1U; x++)
+        const auto pHeightsRow = heights.data() + rSize.x * y;
+        for (uint32_t x = 0U; x < rActualSize.x; x++)
         {
-            *(pIndexIt++) = glm::u32vec3{toIndex(x, y), toIndex(x, y + 1U), toIndex(x + 1U, y)};
-            *(pIndexIt++) = glm::u32vec3{toIndex(x, y + 1U), toIndex(x + 1U, y + 1U), toIndex(x + 1U, y)};
+            *(pHeightIt++) = isValid(x, y) ? pHeightsRow[x] : std::numeric_limits<float>::quiet_NaN();
         }
     }
+
+    // Fully valid tiles share the same triangles, only partially valid tiles need their own:
+    geometry.fullyValid = rActualSize.x > 1U && rActualSize.y > 1U;
+    for (uint32_t y = 0U; geometry.fullyValid && y < rActualSize.y; y++)
+    {
+        const auto pValidityRow = validity.data() + rSize.x * y;
+        geometry.fullyValid = std::all_of(pValidityRow, pValidityRow + rActualSize.x, [](auto v) { return v != 0U; });
+    }
+    if (geometry.fullyValid)
+    {
+        return geometry;
+    }
+
+    // Quads are split in 2 triangles sharing their (x, y + 1) - (x + 1, y) edge, triangles with invalid corners are
+    // skipped:
+    auto& rIndices = geometry.indices;
+    auto toIndex = [&rActualSize](uint32_t x, uint32_t y) { return rActualSize.x * y + x; };
+    for (uint32_t y = 0U; y + 1U < rActualSize.y; y++)
+    {
+        for (uint32_t x = 0U; x + 1U < rActualSize.x; x++)
+        {
+            if (!isValid(x, y + 1U) || !isValid(x + 1U, y))
+            {
+                continue;
+            }
+
+            if (isValid(x, y))
+            {
+                rIndices.emplace_back(toIndex(x, y), toIndex(x, y + 1U), toIndex(x + 1U, y));
+            }
+
+            if (isValid(x + 1U, y + 1U))
+            {
+                rIndices.emplace_back(toIndex(x, y + 1U), toIndex(x + 1U, y + 1U), toIndex(x + 1U, y));
+            }
+        }
+    }
+    return geometry;
+}
+
+AnariHeightFieldGridTopologies::AnariHeightFieldGridTopologies(std::shared_ptr<AnariDevice> pAnDevice)
+  : m_pAnDevice(throwIfArgNull(std::move(pAnDevice), "ANARI Height Field Grid Topologies require a device"))
+{
 }
 
-auto initializeVertexBuffer(AnariDevice& rAnDevice, ANARIGeometry anGeometry, const glm::u32vec2& rTileSize)
+auto AnariHeightFieldGridTopologies::getIndices(const glm::u32vec2& rSize) -> ANARIArray1D
 {
-    auto pVertices = mapVertexBuffer(rAnDevice, anGeometry, rTileSize);
-    auto pVertexIt = pVertices.get();
+    auto& rpAnIndices = m_pAnIndexArrays[std::make_pair(rSize.x, rSize.y)];
+    if (rpAnIndices)
+    {
+        return rpAnIndices.get();
+    }
 
-    for (uint32_t y = 0U; y < rTileSize.y; y++)
+    const auto anDevice = m_pAnDevice->getHandle();
+    rpAnIndices = UniquePtrWithDeleter<anari::api::Array1D>(
+        anariNewArray1D(anDevice, nullptr, nullptr, nullptr, ANARI_UINT32_VEC3, calculateGridTriangleCount(rSize)),
+        [anDevice](auto* anArray) { anariRelease(anDevice, anArray); });
+    throwIfNull<std::runtime_error>(rpAnIndices, "Failed to create grid topology of ANARI height field");
+
+    // Same triangles as generateHeightFieldTileGeometry, with every sample valid:
+    auto pIndexIt = reinterpret_cast<glm::u32vec3*>(anariMapArray(anDevice, rpAnIndices.get()));
+    throwIfNull<std::runtime_error>(pIndexIt, "Failed to map grid topology of ANARI height field");
+    auto toIndex = [&rSize](uint32_t x, uint32_t y) { return rSize.x * y + x; };
+    for (uint32_t y = 0U; y + 1U < rSize.y; y++)
     {
-        for (uint32_t x = 0U; x < rTileSize.x; x++)
+        for (uint32_t x = 0U; x + 1U < rSize.x; x++)
         {
-            *(pVertexIt++) = glm::vec3{x, 0.0F, y};
+            *(pIndexIt++) = glm::u32vec3{toIndex(x, y), toIndex(x, y + 1U), toIndex(x + 1U, y)};
+            *(pIndexIt++) = glm::u32vec3{toIndex(x, y + 1U), toIndex(x + 1U, y + 1U), toIndex(x + 1U, y)};
         }
     }
+    anariUnmapArray(anDevice, rpAnIndices.get());
+    anariCommitParameters(anDevice, rpAnIndices.get());
+    return rpAnIndices.get();
 }
 
-}  // namespace
-
-AnariHeightFieldTile::AnariHeightFieldTile(std::shared_ptr<AnariDevice> pAnDevice, const glm::u32vec2& rTileSize)
+AnariHeightFieldTile::AnariHeightFieldTile(std::shared_ptr<AnariDevice> pAnDevice,
+                                           AnariHeightFieldGridTopologies& rGridTopologies)
   : m_pAnDevice(throwIfArgNull(std::move(pAnDevice), "ANARI Height Field Tile requires a device"))
-  , m_tileSize(rTileSize)
+  , m_rGridTopologies(rGridTopologies)
 
   , m_pAnGeometry(m_pAnDevice->createGeometry(AnariPrimitiveType::Triangle))
   , m_pAnMaterial(createTileMaterial(*m_pAnDevice))
@@ -99,71 +182,50 @@ AnariHeightFieldTile::AnariHeightFieldTile(std::shared_ptr<AnariDevice> pAnDevic
   , m_pAnGroup(m_pAnDevice->createGroup({m_pAnSurface.get()}))
   , m_pAnInstance(m_pAnDevice->createInstance(m_pAnGroup.get()))
 {
-    initializeVertexBuffer(*m_pAnDevice, m_pAnGeometry.get(), m_tileSize);
-    initializeIndexBuffer(*m_pAnDevice, m_pAnGeometry.get(), m_tileSize);
-    anariCommitParameters(m_pAnDevice->getHandle(), m_pAnGeometry.get());
 }
 
-auto AnariHeightFieldTile::load(const IHeightMapTileSampler& rSampler) -> bool
+auto AnariHeightFieldTile::load(const HeightFieldTileGeometry& rGeometry) -> bool
 {
-    const auto scale = rSampler.getScale();
-    const auto tilePos = glm::vec2(rSampler.getPos() * rSampler.getSize()) * scale;
-    // const auto& rSize = rSampler.getSize();
-    const auto& rActualSize = rSampler.getActualSize();
-
-    // Prepare the vertex buffer first, the sampler sets invalid samples to NaN:
-    auto pDstVertices = mapVertexBuffer(*m_pAnDevice, m_pAnGeometry.get(), rActualSize);
-    auto pVertexIt = pDstVertices.get();
-    auto setVertex = [&](uint32_t x, uint32_t y, float height) {
-        *(pVertexIt + rActualSize.x * y + x) = glm::vec3{
-            tilePos.x + x * scale,
-            height,
-            tilePos.y + y * scale,
-        };
-    };
-
-    m_tmpIndices.clear();
-    auto toIndex = [&rActualSize](uint32_t x, uint32_t y) { return rActualSize.x * y + x; };
+    // An empty geometry means that the current tile did not contain any useful data to load (e.g. if all the data is
+    // masked out). In this case, leave early and let the user know by returning false.
+    if (rGeometry.isEmpty())
+    {
+        m_tileID.reset();
+        m_byteSize = 0U;
+        return false;
+    }
 
-    for (uint32_t y = 0U; y < rActualSize.y; y++)
     {
-        for (uint32_t x = 0U; x < rActualSize.x; x++)
+        // Expand heights to world positions, vertices of invalid samples are not referenced and left zeroed:
+        auto pDstVertices = mapVertexBuffer(*m_pAnDevice, m_pAnGeometry.get(), rGeometry.size);
+        auto pVertexIt = pDstVertices.get();
+        auto pHeightIt = rGeometry.heights.data();
+        for (uint32_t y = 0U; y < rGeometry.size.y; y++)
         {
-            bool isCurrentValid = rSampler.isValid(x, y);
-            if (isCurrentValid)
+            for (uint32_t x = 0U; x < rGeometry.size.x; x++, pHeightIt++)
             {
-                setVertex(x, y, rSampler.at(x, y));
-            }
-
-            if (!rSampler.isValid(x, y + 1U) || !rSampler.isValid(x + 1U, y))
-            {
-                continue;
-            }
-
-            if (isCurrentValid)
-            {
-                m_tmpIndices.emplace_back(toIndex(x, y), toIndex(x, y + 1U), toIndex(x + 1U, y));
-            }
-
-            if (rSampler.isValid(x + 1U, y + 1U))
-            {
-                m_tmpIndices.emplace_back(toIndex(x, y + 1U), toIndex(x + 1U, y + 1U), toIndex(x + 1U, y));
+                *(pVertexIt++) = std::isnan(*pHeightIt) ? glm::vec3{}
+                                                        : glm::vec3{
+                                                              rGeometry.origin.x + x * rGeometry.scale,
+                                                              *pHeightIt,
+                                                              rGeometry.origin.y + y * rGeometry.scale,
+                                                          };
             }
         }
     }
-
-    // If the index array is empty at this point, this means that the current tile did not contain any useful data to
-    // load (e.g. if all the data is masked out). In this case, leave early and let the user know by returning false.
-    if (m_tmpIndices.empty())
+    if (rGeometry.fullyValid)
     {
-        m_tileID.reset();
-        return false;
+        auto anIndices = m_rGridTopologies.getIndices(rGeometry.size);
+        anariSetParameter(m_pAnDevice->getHandle(), m_pAnGeometry.get(), "primitive.index", ANARI_ARRAY1D, &anIndices);
+    }
+    else
+    {
+        auto pDstIndices = mapIndexBuffer(*m_pAnDevice, m_pAnGeometry.get(), rGeometry.indices.size());
+        std::ranges::copy(rGeometry.indices, pDstIndices.get());
     }
 
-    auto pDstIndices = mapIndexBuffer(*m_pAnDevice, m_pAnGeometry.get(), m_tmpIndices.size());
-    std::ranges::copy(m_tmpIndices, pDstIndices.get());
-
-    m_tileID = rSampler.getTileID();
+    m_tileID = rGeometry.tileID;
+    m_byteSize = rGeometry.getByteSize();
     m_geometryChanged = true;
     return true;
 }
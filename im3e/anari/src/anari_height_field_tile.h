@@ -8,31 +8,88 @@
 #include <anari/anari.h>
 #include <glm/glm.hpp>
 
+#include <map>
 #include <memory>
 #include <optional>
+#include <utility>
+#include <vector>
 
 namespace im3e {
 
+/// @brief CPU-side geometry of a height map tile, ready to be uploaded to an ANARI height field tile.
+/// Generating it is the expensive part of loading a tile so it is done outside of the render thread, which only copies
+/// the arrays. Only the heights of the samples are kept until the upload, their X and Z coordinates being derived from
+/// the origin and scale of the tile: ANARI triangle geometries only take 3D float positions, which are written straight
+/// to the mapped vertex array.
+struct HeightFieldTileGeometry
+{
+    TileID tileID;
+    glm::u32vec2 size;
+
+    /// @brief World position of the first sample of the tile and distance between samples, along X and Z.
+    glm::vec2 origin{};
+    float scale = 1.0F;
+
+    /// @brief Heights of the samples, row by row. Invalid samples are NaN, their vertices are not referenced by any
+    /// triangle.
+    std::vector<float> heights;
+
+    /// @brief Triangles of the tile, left empty for fully valid tiles which share the same grid topology.
+    std::vector<glm::u32vec3> indices;
+    bool fullyValid{};
+
+    /// @return True if the geometry does not contain any triangle e.g. if all the tile data is masked out.
+    auto isEmpty() const -> bool { return !fullyValid && indices.empty(); }
+
+    /// @return Size in bytes of the vertex and index arrays of the geometry once uploaded, one position per sample.
+    auto getByteSize() const -> size_t
+    {
+        return heights.size() * sizeof(glm::vec3) + indices.size() * sizeof(glm::u32vec3);
+    }
+};
+auto generateHeightFieldTileGeometry(const IHeightMapTileSampler& rSampler) -> HeightFieldTileGeometry;
+
+/// @brief Immutable index arrays triangulating fully valid grids of samples, shared by all tiles of the same size.
+/// Arrays are created on first use and only accessed from the render thread.
+class AnariHeightFieldGridTopologies
+{
+public:
+    explicit AnariHeightFieldGridTopologies(std::shared_ptr<AnariDevice> pAnDevice);
+
+    /// @brief Index array with the triangles of a fully valid grid of samples of the given size.
+    /// Triangles are ordered as the ones generated by generateHeightFieldTileGeometry for partially valid tiles.
+    auto getIndices(const glm::u32vec2& rSize) -> ANARIArray1D;
+
+private:
+    std::shared_ptr<AnariDevice> m_pAnDevice;
+    std::map<std::pair<uint32_t, uint32_t>, UniquePtrWithDeleter<anari::api::Array1D>> m_pAnIndexArrays;
+};
+
+/// @brief ANARI triangle mesh of a height map tile.
+/// The tile has no geometry until loaded, its arrays being sized to the geometry of the last loaded tile. Fully valid
+/// tiles reference the shared index array of their size instead of uploading their own.
 class AnariHeightFieldTile
 {
 public:
-    AnariHeightFieldTile(std::shared_ptr<AnariDevice> pAnDevice, const glm::u32vec2& rSize);
+    AnariHeightFieldTile(std::shared_ptr<AnariDevice> pAnDevice, AnariHeightFieldGridTopologies& rGridTopologies);
 
-    /// @brief Loads the given height map tile into memory.
-    /// @return True if the tile was successfully loaded, False if given tile did not contain any data to load. For
+    /// @brief Uploads the given tile geometry to the ANARI tile.
+    /// @return True if the tile was successfully loaded, False if given geometry did not contain any data to load. For
     /// example, a given tile might have its data completely masked out.
-    auto load(const IHeightMapTileSampler& rSampler) -> bool;
+    auto load(const HeightFieldTileGeometry& rGeometry) -> bool;
 
     void commitChanges();
 
     auto getInstance() const -> ANARIInstance { return m_pAnInstance.get(); }
     auto getTileID() const -> std::optional<TileID> { return m_tileID; }
+    auto getByteSize() const -> size_t { return m_byteSize; }
 
 private:
     std::shared_ptr<AnariDevice> m_pAnDevice;
-    const glm::u32vec2 m_tileSize;
+    AnariHeightFieldGridTopologies& m_rGridTopologies;
 
     std::optional<TileID> m_tileID;
+    size_t m_byteSize{};
 
     bool m_geometryChanged{};
 
@@ -42,8 +99,6 @@ private:
 
     UniquePtrWithDeleter<anari::api::Group> m_pAnGroup;
     UniquePtrWithDeleter<anari::api::Instance> m_pAnInstance;
-
-    std::vector<glm::u32vec3> m_tmpIndices;
 };
 
 }  // namespace im3e
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <im3e/utils/core/throw_utils.h>
 
+#include <algorithm>
 #include <utility>
 
 using namespace im3e;
@@ -9,12 +10,15 @@ using namespace im3e;
 namespace {
 
 constexpr auto InstanceParam = "instance";
+constexpr size_t MinArrayCapacity = 64U;
 
 }  // namespace
 
 AnariInstanceSet::AnariInstanceSet(std::shared_ptr<AnariDevice> pAnDevice, ANARIWorld anWorld)
   : m_pAnDevice(throwIfArgNull(std::move(pAnDevice), "ANARI Instance Set requires a device"))
   , m_anWorld(throwIfArgNull(anWorld, "ANARI Instance Set requires a world"))
+  , m_pAnEmptyGroup(m_pAnDevice->createGroup())
+  , m_pAnEmptyInstance(m_pAnDevice->createInstance(m_pAnEmptyGroup.get()))
 {
     anariUnsetParameter(m_pAnDevice->getHandle(), m_anWorld, InstanceParam);
 }
@@ -24,40 +28,93 @@ void AnariInstanceSet::insert(ANARIInstance anInstance)
     throwIfArgNull(anInstance, "Cannot insert null to ANARI Instance Set");
 
     std::lock_guard lock(m_mutex);
-    m_changed |= m_anInstances.emplace(anInstance).second;
+    if (m_anInstanceToIndex.emplace(anInstance, m_anInstances.size()).second)
+    {
+        m_anInstances.emplace_back(anInstance);
+        this->markChanged(m_anInstances.size() - 1U);
+    }
 }
 
 void AnariInstanceSet::remove(ANARIInstance anInstance)
 {
     std::lock_guard lock(m_mutex);
-    m_changed |= !!m_anInstances.erase(anInstance);
+    auto itFind = m_anInstanceToIndex.find(anInstance);
+    if (itFind == m_anInstanceToIndex.end())
+    {
+        return;
+    }
+
+    // Move the last instance to the removed slot so that instances stay contiguous:
+    const auto index = itFind->second;
+    m_anInstanceToIndex.erase(itFind);
+    if (index + 1U < m_anInstances.size())
+    {
+        m_anInstances[index] = m_anInstances.back();
+        m_anInstanceToIndex[m_anInstances[index]] = index;
+        this->markChanged(index);
+    }
+    m_anInstances.pop_back();
+    this->markChanged(m_anInstances.size());
+}
+
+void AnariInstanceSet::markChanged(size_t index)
+{
+    if (m_changedBegin == m_changedEnd)
+    {
+        m_changedBegin = index;
+        m_changedEnd = index + 1U;
+        return;
+    }
+    m_changedBegin = std::min(m_changedBegin, index);
+    m_changedEnd = std::max(m_changedEnd, index + 1U);
+}
+
+auto AnariInstanceSet::hasPendingChanges() const -> bool
+{
+    std::lock_guard lock(m_mutex);
+    return m_changedBegin != m_changedEnd;
 }
 
 auto AnariInstanceSet::updateWorld() -> bool
 {
     std::lock_guard lock(m_mutex);
-    if (!m_changed)
+    if (m_changedBegin == m_changedEnd)
     {
         return false;
     }
-    m_changed = false;
 
-    if (m_anInstances.empty())
+    auto anDevice = m_pAnDevice->getHandle();
+    if (m_anInstances.size() > m_arrayCapacity)
     {
-        anariUnsetParameter(m_pAnDevice->getHandle(), m_anWorld, InstanceParam);
+        // Grow geometrically so that adding instances one at a time rarely recreates the array:
+        m_arrayCapacity = std::max({m_anInstances.size(), m_arrayCapacity * 2U, MinArrayCapacity});
+        m_pAnArray = m_pAnDevice->createArray1d(nullptr, ANARI_INSTANCE, m_arrayCapacity);
+        auto anArray = m_pAnArray.get();
+        anariSetParameter(anDevice, m_anWorld, InstanceParam, ANARI_ARRAY1D, &anArray);
+
+        m_changedBegin = 0U;
+        m_changedEnd = m_arrayCapacity;
     }
-    else
+
+    // Instances inserted then removed since the last update may have changed slots past the end of the array:
+    m_changedEnd = std::min(m_changedEnd, m_arrayCapacity);
+    if (m_changedBegin >= m_changedEnd)
     {
-        std::vector<ANARIInstance> anInstances;
-        anInstances.reserve(m_anInstances.size());
-        for (auto& rAnInstance : m_anInstances)
-        {
-            anInstances.emplace_back(rAnInstance);
-        }
+        m_changedBegin = 0U;
+        m_changedEnd = 0U;
+        return false;
+    }
 
-        auto pAnArray = m_pAnDevice->createArray1d(anInstances, ANARI_INSTANCE);
-        auto anArray = pAnArray.get();
-        anariSetParameter(m_pAnDevice->getHandle(), m_anWorld, InstanceParam, ANARI_ARRAY1D, &anArray);
+    auto* pSlots = static_cast<ANARIInstance*>(anariMapArray(anDevice, m_pAnArray.get()));
+    const auto instanceEnd = std::min(m_changedEnd, m_anInstances.size());
+    if (m_changedBegin < instanceEnd)
+    {
+        std::copy(m_anInstances.data() + m_changedBegin, m_anInstances.data() + instanceEnd, pSlots + m_changedBegin);
     }
+    std::fill(pSlots + std::max(m_changedBegin, instanceEnd), pSlots + m_changedEnd, m_pAnEmptyInstance.get());
+    anariUnmapArray(anDevice, m_pAnArray.get());
+
+    m_changedBegin = 0U;
+    m_changedEnd = 0U;
     return true;
-}
\ No newline at end of file
+}
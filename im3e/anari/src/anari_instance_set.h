@@ -2,13 +2,20 @@
 
 #include "anari_device.h"
 
+#include <im3e/utils/core/types.h>
+
 #include <anari/anari.h>
 
 #include <memory>
-#include <unordered_set>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace im3e {
 
+/// @brief Instances of a world, stored in a persistent ANARI array updated in place.
+/// The array grows geometrically and is never recreated while instances fit, its slots past the last instance being
+/// filled with an empty instance. Changes made between two updates are written with a single map of the array.
 class AnariInstanceSet
 {
 public:
@@ -21,13 +28,29 @@ public:
     /// @return True if the world was changed (and needs committing), false otherwise.
     auto updateWorld() -> bool;
 
+    /// @return True if instances were inserted or removed since the last update.
+    auto hasPendingChanges() const -> bool;
+
 private:
+    void markChanged(size_t index);
+
     std::shared_ptr<AnariDevice> m_pAnDevice;
     ANARIWorld m_anWorld;
 
+    // Fills the slots of the array that do not hold any instance:
+    UniquePtrWithDeleter<anari::api::Group> m_pAnEmptyGroup;
+    UniquePtrWithDeleter<anari::api::Instance> m_pAnEmptyInstance;
+
     mutable std::mutex m_mutex;
-    std::unordered_set<ANARIInstance> m_anInstances;
-    bool m_changed{};
+    std::vector<ANARIInstance> m_anInstances;
+    std::unordered_map<ANARIInstance, size_t> m_anInstanceToIndex;
+
+    // Range of slots changed since the last update:
+    size_t m_changedBegin{};
+    size_t m_changedEnd{};
+
+    UniquePtrWithDeleter<anari::api::Array1D> m_pAnArray;
+    size_t m_arrayCapacity{};
 };
 
-}  // namespace im3e
\ No newline at end of file
+}  // namespace im3e
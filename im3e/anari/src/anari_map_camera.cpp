@@ -76,16 +76,25 @@ void AnariMapCamera::onMouseWheel(float scrollSteps)
     this->update();
 }
 
-void AnariMapCamera::setAspectRatio(float aspectRatio)
+void AnariMapCamera::setViewportSize(const glm::u32vec2& rSize)
 {
-    if (m_perspective.aspectRatio == aspectRatio)
+    const auto aspectRatio = static_cast<float>(rSize.x) / static_cast<float>(rSize.y);
+    const auto viewportHeight = static_cast<float>(rSize.y);
+    if (m_perspective.aspectRatio == aspectRatio && m_perspective.viewportHeight == viewportHeight)
     {
         return;
     }
     m_perspective.aspectRatio = aspectRatio;
+    m_perspective.viewportHeight = viewportHeight;
+    m_viewFrustum = this->createViewFrustum();
     m_needsCommit = true;
 }
 
+auto AnariMapCamera::getProjectionScale() const -> float
+{
+    return m_perspective.viewportHeight / (2.0F * std::tan(m_perspective.fovY / 2.0F));
+}
+
 void AnariMapCamera::update()
 {
     m_view.update();
@@ -110,6 +119,7 @@ void AnariMapCamera::update()
     m_viewFrustum.top = glm::vec4{topNormal, 0.0F};*/
 
     m_needsCommit = true;
+    m_lastMoveTime = std::chrono::steady_clock::now();
 }
 
 auto AnariMapCamera::createViewFrustum() const -> ViewFrustum
@@ -6,6 +6,7 @@
 #include <im3e/utils/loggers.h>
 #include <im3e/utils/view_frustum.h>
 
+#include <chrono>
 #include <numbers>
 
 namespace im3e {
@@ -17,13 +18,23 @@ public:
 
     void commitChanges();
 
+    /// @return True if the camera changed since the last commit.
+    auto hasPendingChanges() const -> bool { return m_needsCommit; }
+
     void onMouseMove(const glm::vec2& rClipOffset, const std::array<bool, 3U>& rMouseButtonsDown) override;
     void onMouseWheel(float scrollSteps) override;
 
-    void setAspectRatio(float ratio);
+    void setViewportSize(const glm::u32vec2& rSize);
 
     auto getHandle() const -> ANARICamera { return m_pAnCamera.get(); }
     auto getViewFrustum() const -> const ViewFrustum& { return m_viewFrustum; }
+    auto getPosition() const -> const glm::vec3& { return m_view.getPosition(); }
+
+    /// @brief Time at which the camera last moved, e.g. to render at a lower resolution while the user interacts.
+    auto getLastMoveTime() const -> std::chrono::steady_clock::time_point { return m_lastMoveTime; }
+
+    /// @brief Size in pixels of an object of world size 1 seen at a distance of 1 from the camera.
+    auto getProjectionScale() const -> float;
 
 private:
     void update();
@@ -34,11 +45,13 @@ private:
     std::shared_ptr<anari::api::Camera> m_pAnCamera;
 
     bool m_needsCommit{true};
+    std::chrono::steady_clock::time_point m_lastMoveTime{};
 
     struct PerspectiveState
     {
         float fovY{std::numbers::pi_v<float> / 3.0F};
         float aspectRatio{1.0F};
+        float viewportHeight{1.0F};
         float near{0.1F};
         float far{10'000.0F};
 
@@ -20,6 +20,9 @@ public:
 
     void commitChanges();
 
+    /// @return True if the transform of the plane changed since the last commit.
+    auto hasPendingChanges() const -> bool { return m_transformChanged; }
+
     auto getProperties() -> std::shared_ptr<IPropertyGroup> override { return m_pProperties; }
     auto getInstance() const -> ANARIInstance { return m_pAnInstance.get(); }
 
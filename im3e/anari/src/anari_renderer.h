@@ -18,6 +18,10 @@ public:
     AnariRenderer(std::shared_ptr<AnariDevice> pAnDevice);
 
     void commitChanges();
+
+    /// @return True if renderer parameters changed since the last commit.
+    auto hasPendingChanges() const -> bool { return m_parametersChanged; }
+
     auto createProperties() -> std::shared_ptr<IPropertyGroup>;
 
     auto getHandle() const -> ANARIRenderer { return m_pAnRenderer.get(); }
@@ -0,0 +1,67 @@
+#include "anari_resolution_scaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace im3e;
+
+namespace {
+
+// Fraction of the scale error corrected per frame, lower values react slower but avoid oscillating:
+constexpr float ControllerGain = 0.5F;
+
+}  // namespace
+
+AnariResolutionScaler::AnariResolutionScaler()
+  : m_pEnabledProp(std::make_shared<PropertyValue<bool>>(PropertyValueConfig<bool>{
+        .name = "Enabled",
+        .description = "Lower the resolution of frames rendered while the camera moves to hold the target render time.",
+        .defaultValue = true,
+    }))
+  , m_pTargetRenderTimeProp(std::make_shared<PropertyValue<float>>(PropertyValueConfig<float>{
+        .name = "Target Render Time (ms)",
+        .description = "Render time of frames aimed for while the camera moves.",
+        .defaultValue = 33.0F,
+        .minValue = 1.0F,
+        .maxValue = 1000.0F,
+    }))
+  , m_pMinScaleProp(std::make_shared<PropertyValue<float>>(PropertyValueConfig<float>{
+        .name = "Min Scale",
+        .description = "Lowest scale of the resolution of frames rendered while the camera moves.",
+        .defaultValue = 0.25F,
+        .minValue = 0.1F,
+        .maxValue = 1.0F,
+    }))
+  , m_pProperties(createPropertyGroup("Dynamic Resolution", {m_pEnabledProp, m_pTargetRenderTimeProp, m_pMinScaleProp}))
+{
+}
+
+void AnariResolutionScaler::onFrameRendered(float frameScale, std::chrono::microseconds renderTime)
+{
+    if (renderTime.count() <= 0)
+    {
+        return;
+    }
+
+    const auto targetRenderTime = std::chrono::duration<float, std::milli>(m_pTargetRenderTimeProp->getValue());
+    const auto renderTimeRatio = targetRenderTime / std::chrono::duration<float, std::milli>(renderTime);
+    const auto wantedScale = frameScale * std::sqrt(renderTimeRatio);
+    m_scale = std::clamp(m_scale + ControllerGain * (wantedScale - m_scale), m_pMinScaleProp->getValue(), 1.0F);
+}
+
+auto AnariResolutionScaler::getScale(bool cameraMoving) const -> float
+{
+    if (!cameraMoving || !m_pEnabledProp->getValue())
+    {
+        return 1.0F;
+    }
+    return std::max(m_scale, m_pMinScaleProp->getValue());
+}
+
+auto AnariResolutionScaler::calculateFrameSize(const VkExtent2D& rViewportSize, float scale) -> VkExtent2D
+{
+    return VkExtent2D{
+        .width = std::max(static_cast<uint32_t>(std::lround(static_cast<float>(rViewportSize.width) * scale)), 1U),
+        .height = std::max(static_cast<uint32_t>(std::lround(static_cast<float>(rViewportSize.height) * scale)), 1U),
+    };
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <im3e/utils/properties/properties.h>
+#include <im3e/utils/vk_utils.h>
+
+#include <chrono>
+#include <memory>
+
+namespace im3e {
+
+/// @brief Scale of the resolution of ANARI frames, adapted while the camera moves to hold a target render time.
+/// The scale follows the render time of completed frames with a proportional controller: the number of pixels of a
+/// frame being proportional to the square of the scale, the scale is corrected by the square root of the ratio
+/// between the target and the measured render times. Frames are rendered at full resolution when the camera is idle.
+class AnariResolutionScaler
+{
+public:
+    AnariResolutionScaler();
+
+    /// @brief Adapt the scale to the render time of a completed frame rendered at the given scale.
+    void onFrameRendered(float frameScale, std::chrono::microseconds renderTime);
+
+    /// @return Scale at which to render the next frame, 1 for full resolution.
+    auto getScale(bool cameraMoving) const -> float;
+
+    /// @return Size of a frame rendered at the given scale for the given viewport size, at least one pixel wide.
+    static auto calculateFrameSize(const VkExtent2D& rViewportSize, float scale) -> VkExtent2D;
+
+    auto getProperties() -> std::shared_ptr<IPropertyGroup> { return m_pProperties; }
+
+private:
+    std::shared_ptr<PropertyValue<bool>> m_pEnabledProp;
+    std::shared_ptr<PropertyValue<float>> m_pTargetRenderTimeProp;
+    std::shared_ptr<PropertyValue<float>> m_pMinScaleProp;
+    std::shared_ptr<IPropertyGroup> m_pProperties;
+
+    float m_scale = 1.0F;
+};
+
+}  // namespace im3e
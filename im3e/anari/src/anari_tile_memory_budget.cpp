@@ -0,0 +1,66 @@
+#include "anari_tile_memory_budget.h"
+
+#include <algorithm>
+
+using namespace im3e;
+
+AnariTileMemoryBudget::AnariTileMemoryBudget(size_t byteBudget)
+  : m_byteBudget(byteBudget)
+{
+}
+
+void AnariTileMemoryBudget::addClient(IClient& rClient)
+{
+    m_pClients.emplace_back(&rClient);
+}
+
+void AnariTileMemoryBudget::removeClient(IClient& rClient)
+{
+    std::erase(m_pClients, &rClient);
+}
+
+auto AnariTileMemoryBudget::allocate(size_t byteSize) -> bool
+{
+    if (!this->releaseUntilFits(byteSize))
+    {
+        return false;
+    }
+    m_byteSize += byteSize;
+    return true;
+}
+
+void AnariTileMemoryBudget::free(size_t byteSize)
+{
+    m_byteSize -= std::min(byteSize, m_byteSize);
+}
+
+void AnariTileMemoryBudget::setByteBudget(size_t byteBudget)
+{
+    m_byteBudget = byteBudget;
+    this->releaseUntilFits(0U);
+}
+
+auto AnariTileMemoryBudget::releaseUntilFits(size_t byteSize) -> bool
+{
+    while (m_byteSize + byteSize > m_byteBudget)
+    {
+        // Least recently used tile of all clients first, clients only know about their own tiles:
+        IClient* pOldestClient{};
+        std::optional<std::chrono::steady_clock::time_point> oldestUseTime;
+        for (auto* pClient : m_pClients)
+        {
+            const auto useTime = pClient->getLeastRecentUseTime();
+            if (useTime && (!oldestUseTime || *useTime < *oldestUseTime))
+            {
+                pOldestClient = pClient;
+                oldestUseTime = useTime;
+            }
+        }
+        if (!pOldestClient)
+        {
+            return false;
+        }
+        pOldestClient->releaseLeastRecentlyUsedTile();
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace im3e {
+
+/// @brief Byte budget of the vertex and index arrays of the height field tiles of a world, shared by its height fields.
+/// Height fields allocate the bytes of each tile they load from the budget. When the budget is exceeded, the least
+/// recently used tiles of all height fields are released first, tiles that are displayed are never released.
+/// The budget is only used from the render thread and is not thread-safe.
+class AnariTileMemoryBudget
+{
+public:
+    class IClient
+    {
+    public:
+        virtual ~IClient() = default;
+
+        /// @return Time at which the least recently used tile that can be released was last displayed, if any.
+        virtual auto getLeastRecentUseTime() const -> std::optional<std::chrono::steady_clock::time_point> = 0;
+
+        /// @brief Release the least recently used tile that can be released, freeing its bytes from the budget.
+        virtual void releaseLeastRecentlyUsedTile() = 0;
+    };
+
+    explicit AnariTileMemoryBudget(size_t byteBudget);
+
+    void addClient(IClient& rClient);
+    void removeClient(IClient& rClient);
+
+    /// @brief Reserve the given number of bytes, releasing least recently used tiles if needed to stay within budget.
+    /// @return False if the bytes cannot fit in the budget even after releasing every releasable tile, nothing is
+    /// reserved in this case.
+    auto allocate(size_t byteSize) -> bool;
+    void free(size_t byteSize);
+
+    /// @brief Change the budget, releasing least recently used tiles until the reserved bytes fit in the new budget.
+    void setByteBudget(size_t byteBudget);
+
+    auto getByteBudget() const -> size_t { return m_byteBudget; }
+    auto getByteSize() const -> size_t { return m_byteSize; }
+
+private:
+    /// @brief Release least recently used tiles until the given number of bytes fits in the budget.
+    auto releaseUntilFits(size_t byteSize) -> bool;
+
+    size_t m_byteBudget;
+    size_t m_byteSize{};
+    std::vector<IClient*> m_pClients;
+};
+
+}  // namespace im3e
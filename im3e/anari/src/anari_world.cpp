@@ -9,6 +9,13 @@ using namespace im3e;
 
 namespace {
 
+constexpr uint32_t DefaultTileMemoryBudgetMiB = 512U;
+
+auto convertMiBToBytes(uint32_t mib)
+{
+    return static_cast<size_t>(mib) * 1024U * 1024U;
+}
+
 auto createAnariWorld(const ILogger& rLogger, ANARIDevice anDevice)
 {
     auto anWorld = anariNewWorld(anDevice);
@@ -37,11 +44,23 @@ auto createAnariLight(const ILogger& rLogger, ANARIDevice anDevice)
 
 }  // namespace
 
-AnariWorld::AnariWorld(std::shared_ptr<AnariDevice> pAnDevice)
+AnariWorld::AnariWorld(std::shared_ptr<AnariDevice> pAnDevice, std::shared_ptr<IStatsProvider> pStatsProvider)
   : m_pAnDevice(throwIfArgNull(std::move(pAnDevice), "Cannot create ANARI World without an ANARI Device"))
+  , m_pStatsProvider(throwIfArgNull(std::move(pStatsProvider), "Cannot create ANARI World without a stats provider"))
   , m_pLogger(m_pAnDevice->createLogger("ANARI World"))
   , m_pAnWorld(createAnariWorld(*m_pLogger, m_pAnDevice->getHandle()))
   , m_pAnLight(createAnariLight(*m_pLogger, m_pAnDevice->getHandle()))
+  , m_pTileMemoryBudgetProp(std::make_shared<PropertyValue<uint32_t>>(PropertyValueConfig<uint32_t>{
+        .name = "Tile Memory Budget (MiB)",
+        .description = "Maximum memory used by the vertex and index arrays of the tiles of all height fields.",
+        .defaultValue = DefaultTileMemoryBudgetMiB,
+        .minValue = 16U,
+        .maxValue = 64U * 1024U,
+    }))
+  , m_pProperties(createPropertyGroup("World", {m_pTileMemoryBudgetProp}))
+  , m_tileMemoryBudget(convertMiBToBytes(DefaultTileMemoryBudgetMiB))
+  , m_pTileMemoryByteSizeGauge(m_pStatsProvider->getGauge("AnariWorld.tileMemoryBytes"))
+  , m_pTileMemoryByteBudgetGauge(m_pStatsProvider->getGauge("AnariWorld.tileMemoryBudgetBytes"))
   , m_instanceSet(m_pAnDevice, m_pAnWorld.get())
 {
     // Initialize world lights:
@@ -64,7 +83,9 @@ auto AnariWorld::addPlane(std::string_view name) -> std::shared_ptr<IAnariObject
 
 auto AnariWorld::addHeightField(std::unique_ptr<IHeightMap> pHeightMap) -> std::shared_ptr<IAnariObject>
 {
-    auto pHeightField = std::make_shared<AnariHeightField>(m_pAnDevice, m_instanceSet, std::move(pHeightMap));
+    auto pHeightField = std::make_shared<AnariHeightField>(m_pAnDevice, m_instanceSet, m_tileMemoryBudget,
+                                                           m_tileLoaderThreadPool, *m_pStatsProvider,
+                                                           std::move(pHeightMap));
     m_pHeightFields.emplace_back(pHeightField);
     return pHeightField;
 }
@@ -76,8 +97,19 @@ void AnariWorld::updateAsync(const AnariMapCamera& rCamera)
 
 void AnariWorld::commitChanges()
 {
+    // Applied here rather than when the property changes, tiles must only be released from the render thread:
+    m_tileMemoryBudget.setByteBudget(convertMiBToBytes(m_pTileMemoryBudgetProp->getValue()));
+
     std::ranges::for_each(m_pPlanes, [](auto& pPlane) { pPlane->commitChanges(); });
-    std::ranges::for_each(m_pHeightFields, [](auto& pHeightField) { pHeightField->commitChanges(); });
+
+    // Height fields with no tile loaded since the last commit are left alone, e.g. when the camera does not move:
+    for (auto& pHeightField : m_pHeightFields)
+    {
+        if (pHeightField->hasPendingChanges())
+        {
+            pHeightField->commitChanges();
+        }
+    }
 
     bool needsCommit{};
     needsCommit |= m_instanceSet.updateWorld();
@@ -85,4 +117,15 @@ void AnariWorld::commitChanges()
     {
         anariCommitParameters(m_pAnDevice->getHandle(), m_pAnWorld.get());
     }
+
+    m_pTileMemoryByteSizeGauge->set(static_cast<int64_t>(m_tileMemoryBudget.getByteSize()));
+    m_pTileMemoryByteBudgetGauge->set(static_cast<int64_t>(m_tileMemoryBudget.getByteBudget()));
+}
+
+auto AnariWorld::hasPendingChanges() const -> bool
+{
+    return m_tileMemoryBudget.getByteBudget() != convertMiBToBytes(m_pTileMemoryBudgetProp->getValue()) ||
+           std::ranges::any_of(m_pPlanes, [](auto& pPlane) { return pPlane->hasPendingChanges(); }) ||
+           std::ranges::any_of(m_pHeightFields, [](auto& pHeightField) { return pHeightField->hasPendingChanges(); }) ||
+           m_instanceSet.hasPendingChanges();
 }
\ No newline at end of file
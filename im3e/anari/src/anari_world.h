@@ -5,9 +5,13 @@
 #include "anari_instance_set.h"
 #include "anari_map_camera.h"
 #include "anari_plane.h"
+#include "anari_tile_memory_budget.h"
 
 #include <im3e/utils/core/types.h>
 #include <im3e/utils/loggers.h>
+#include <im3e/utils/properties/properties.h>
+#include <im3e/utils/stats.h>
+#include <im3e/utils/thread_pool.h>
 
 #include <anari/anari.h>
 
@@ -19,10 +23,11 @@ namespace im3e {
 class AnariWorld : public IAnariWorld
 {
 public:
-    AnariWorld(std::shared_ptr<AnariDevice> pAnDevice);
+    AnariWorld(std::shared_ptr<AnariDevice> pAnDevice, std::shared_ptr<IStatsProvider> pStatsProvider);
 
     auto addPlane(std::string_view name) -> std::shared_ptr<IAnariObject> override;
     auto addHeightField(std::unique_ptr<IHeightMap> pHeightMap) -> std::shared_ptr<IAnariObject> override;
+    auto getProperties() -> std::shared_ptr<IPropertyGroup> override { return m_pProperties; }
 
     /// @brief Initiative asynchronous update of the world with the current camera state.
     /// If called while previous updates were not complete, the latter will be discarded to focus on the new camera
@@ -31,23 +36,37 @@ public:
 
     /// @brief Commit changes to world before rendering a new frame.
     /// Any changes made to the world is not effective until the changes have been committed with this function.
-    /// This should not be called while a frame is still rendering so avoid possible race conditions.
+    /// Frames still rendering may read the objects being changed, they must complete before committing pending changes.
     /// This function does NOT wait for any uncomplete async update. Instead, it commits completed changes so far and
     /// allow uncomplete async updates to continue for the next call to commitChanges.
     void commitChanges();
 
+    /// @return True if commitChanges would change objects of the world, e.g. upload tiles or update its instances.
+    auto hasPendingChanges() const -> bool;
+
     auto getHandle() const -> ANARIWorld { return m_pAnWorld.get(); }
 
 private:
     std::shared_ptr<AnariDevice> m_pAnDevice;
+    std::shared_ptr<IStatsProvider> m_pStatsProvider;
     std::unique_ptr<ILogger> m_pLogger;
     UniquePtrWithDeleter<anari::api::World> m_pAnWorld;
     UniquePtrWithDeleter<anari::api::Light> m_pAnLight;
 
-    std::vector<std::shared_ptr<AnariPlane>> m_pPlanes;
-    std::vector<std::shared_ptr<AnariHeightField>> m_pHeightFields;
+    std::shared_ptr<PropertyValue<uint32_t>> m_pTileMemoryBudgetProp;
+    std::shared_ptr<IPropertyGroup> m_pProperties;
+
+    // Declared before the height fields since they wait for their in-flight tile loads when destroyed:
+    ThreadPool m_tileLoaderThreadPool;
+    AnariTileMemoryBudget m_tileMemoryBudget;
+    std::shared_ptr<Gauge> m_pTileMemoryByteSizeGauge;
+    std::shared_ptr<Gauge> m_pTileMemoryByteBudgetGauge;
 
+    // Declared before the planes and height fields since they remove their instances when destroyed:
     AnariInstanceSet m_instanceSet;
+
+    std::vector<std::shared_ptr<AnariPlane>> m_pPlanes;
+    std::vector<std::shared_ptr<AnariHeightField>> m_pHeightFields;
 };
 
 }  // namespace im3e
\ No newline at end of file
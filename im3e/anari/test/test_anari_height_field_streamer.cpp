@@ -0,0 +1,226 @@
+#include "src/anari_height_field_streamer.h"
+
+#include <im3e/mock/mock_height_map.h>
+#include <im3e/test_utils/glm.h>
+#include <im3e/test_utils/test_utils.h>
+#include <im3e/utils/mock/mock_logger.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <span>
+#include <thread>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+constexpr glm::u32vec2 TestTileSize{4U, 4U};
+
+auto createTestTileSampler(const TileID& rTileID) -> unique_ptr<IHeightMapTileSampler>
+{
+    auto pMockSampler = make_unique<NiceMock<MockHeightMapTileSampler>>();
+    ON_CALL(*pMockSampler, getTileID()).WillByDefault(ReturnRefOfCopy(rTileID));
+    ON_CALL(*pMockSampler, getPos()).WillByDefault(Return(glm::u32vec2(rTileID.xy())));
+    ON_CALL(*pMockSampler, getSize()).WillByDefault(ReturnRefOfCopy(TestTileSize));
+    ON_CALL(*pMockSampler, getActualSize()).WillByDefault(ReturnRefOfCopy(TestTileSize));
+    ON_CALL(*pMockSampler, getScale()).WillByDefault(Return(1.0F));
+    ON_CALL(*pMockSampler, copyRows(_, _, _)).WillByDefault(Invoke([](auto, auto, span<float> dst) {
+        ranges::fill(dst, 1.0F);
+    }));
+    ON_CALL(*pMockSampler, copyMaskRows(_, _, _)).WillByDefault(Invoke([](auto, auto, span<uint8_t> dst) {
+        ranges::fill(dst, uint8_t{255U});
+    }));
+    return pMockSampler;
+}
+
+}  // namespace
+
+struct AnariHeightFieldStreamerTest : public Test
+{
+    AnariHeightFieldStreamerTest()
+    {
+        ON_CALL(m_mockHeightMap, getTileSampler(An<const TileID&>())).WillByDefault(Invoke(createTestTileSampler));
+    }
+
+    /// @brief Block the worker thread until the returned promise is fulfilled, so that requests stay queued.
+    auto blockThreadPool()
+    {
+        auto pUnblock = make_shared<promise<void>>();
+        m_threadPool.submit([unblocked = pUnblock->get_future().share()] { unblocked.wait(); });
+        return pUnblock;
+    }
+
+    NiceMock<MockLogger> m_mockLogger;
+    NiceMock<MockHeightMap> m_mockHeightMap;
+    ThreadPool m_threadPool{1U};
+};
+
+TEST_F(AnariHeightFieldStreamerTest, requestedTileIsCompleted)
+{
+    AnariHeightFieldStreamer streamer(m_mockLogger, m_mockHeightMap, m_threadPool);
+    const TileID tileID{1U, 2U, 0U};
+
+    streamer.request(tileID);
+    EXPECT_THAT(streamer.isPending(tileID), IsTrue());
+    m_threadPool.waitIdle();
+    EXPECT_THAT(streamer.hasCompleted(), IsTrue());
+
+    auto geometry = streamer.popCompleted();
+    ASSERT_THAT(geometry.has_value(), IsTrue());
+    EXPECT_THAT(geometry->tileID, Eq(tileID));
+    EXPECT_THAT(geometry->size, Eq(TestTileSize));
+    EXPECT_THAT(geometry->fullyValid, IsTrue());
+    EXPECT_THAT(geometry->heights, AllOf(SizeIs(TestTileSize.x * TestTileSize.y), Each(FloatEq(1.0F))));
+
+    // Popped tiles are no longer pending:
+    EXPECT_THAT(streamer.isPending(tileID), IsFalse());
+    EXPECT_THAT(streamer.hasCompleted(), IsFalse());
+    EXPECT_THAT(streamer.popCompleted().has_value(), IsFalse());
+}
+
+TEST_F(AnariHeightFieldStreamerTest, requestDoesNothingForPendingTile)
+{
+    AnariHeightFieldStreamer streamer(m_mockLogger, m_mockHeightMap, m_threadPool);
+    const TileID tileID{1U, 2U, 0U};
+
+    EXPECT_CALL(m_mockHeightMap, getTileSampler(An<const TileID&>())).Times(1);
+    streamer.request(tileID);
+    streamer.request(tileID);
+    m_threadPool.waitIdle();
+    streamer.request(tileID);
+    m_threadPool.waitIdle();
+
+    EXPECT_THAT(streamer.getPendingCount(), Eq(1U));
+}
+
+TEST_F(AnariHeightFieldStreamerTest, completedTilesArePoppedInCompletionOrder)
+{
+    AnariHeightFieldStreamer streamer(m_mockLogger, m_mockHeightMap, m_threadPool);
+    const TileID tileID0{0U, 0U, 1U};
+    const TileID tileID1{1U, 0U, 1U};
+
+    streamer.request(tileID0);
+    streamer.request(tileID1);
+    m_threadPool.waitIdle();
+    EXPECT_THAT(streamer.getPendingCount(), Eq(2U));
+
+    EXPECT_THAT(streamer.popCompleted()->tileID, Eq(tileID0));
+    EXPECT_THAT(streamer.popCompleted()->tileID, Eq(tileID1));
+    EXPECT_THAT(streamer.getPendingCount(), Eq(0U));
+}
+
+TEST_F(AnariHeightFieldStreamerTest, cancelledRequestsAreNotLoaded)
+{
+    AnariHeightFieldStreamer streamer(m_mockLogger, m_mockHeightMap, m_threadPool);
+    const TileID wantedTileID{0U, 0U, 0U};
+    const TileID staleTileID{1U, 0U, 0U};
+
+    EXPECT_CALL(m_mockHeightMap, getTileSampler(Eq(staleTileID))).Times(0);
+    auto pUnblock = this->blockThreadPool();
+    streamer.request(wantedTileID);
+    streamer.request(staleTileID);
+    streamer.cancelStaleRequests({wantedTileID});
+    EXPECT_THAT(streamer.isPending(staleTileID), IsFalse());
+    pUnblock->set_value();
+    m_threadPool.waitIdle();
+
+    EXPECT_THAT(streamer.popCompleted()->tileID, Eq(wantedTileID));
+    EXPECT_THAT(streamer.popCompleted().has_value(), IsFalse());
+}
+
+TEST_F(AnariHeightFieldStreamerTest, cancelStaleRequestsDiscardsCompletedTiles)
+{
+    AnariHeightFieldStreamer streamer(m_mockLogger, m_mockHeightMap, m_threadPool);
+    const TileID wantedTileID{0U, 0U, 0U};
+    const TileID staleTileID{1U, 0U, 0U};
+
+    streamer.request(staleTileID);
+    streamer.request(wantedTileID);
+    m_threadPool.waitIdle();
+    streamer.cancelStaleRequests({wantedTileID});
+
+    EXPECT_THAT(streamer.getPendingCount(), Eq(1U));
+    EXPECT_THAT(streamer.popCompleted()->tileID, Eq(wantedTileID));
+    EXPECT_THAT(streamer.popCompleted().has_value(), IsFalse());
+}
+
+TEST_F(AnariHeightFieldStreamerTest, destructorCancelsQueuedRequests)
+{
+    EXPECT_CALL(m_mockHeightMap, getTileSampler(An<const TileID&>())).Times(0);
+    auto pUnblock = this->blockThreadPool();
+    {
+        jthread unblockingThread;  // joined once the streamer is destroyed
+        AnariHeightFieldStreamer streamer(m_mockLogger, m_mockHeightMap, m_threadPool);
+        streamer.request(TileID{0U, 0U, 0U});
+        streamer.request(TileID{1U, 0U, 0U});
+
+        // The streamer waits for its queued requests, unblock the worker thread once it started waiting:
+        unblockingThread = jthread([&] {
+            this_thread::sleep_for(chrono::milliseconds(20));
+            pUnblock->set_value();
+        });
+    }
+    m_threadPool.waitIdle();
+}
+
+TEST_F(AnariHeightFieldStreamerTest, destructorWaitsForTilesBeingLoaded)
+{
+    promise<void> loadStarted;
+    atomic_bool loadFinished{};
+    ON_CALL(m_mockHeightMap, getTileSampler(An<const TileID&>())).WillByDefault(Invoke([&](const TileID& rTileID) {
+        loadStarted.set_value();
+        this_thread::sleep_for(chrono::milliseconds(20));
+        loadFinished = true;
+        return createTestTileSampler(rTileID);
+    }));
+    {
+        AnariHeightFieldStreamer streamer(m_mockLogger, m_mockHeightMap, m_threadPool);
+        streamer.request(TileID{0U, 0U, 0U});
+        loadStarted.get_future().wait();
+    }
+    EXPECT_THAT(loadFinished.load(), IsTrue());
+}
+
+TEST_F(AnariHeightFieldStreamerTest, failedLoadsAreNotCompleted)
+{
+    AnariHeightFieldStreamer streamer(m_mockLogger, m_mockHeightMap, m_threadPool);
+    const TileID tileID{1U, 2U, 0U};
+
+    EXPECT_CALL(m_mockHeightMap, getTileSampler(Eq(tileID)))
+        .WillOnce(Invoke([](auto&) -> unique_ptr<IHeightMapTileSampler> { throw runtime_error("read error"); }));
+    EXPECT_CALL(m_mockLogger, error(HasSubstr("read error")));
+    streamer.request(tileID);
+    m_threadPool.waitIdle();
+
+    EXPECT_THAT(streamer.hasCompleted(), IsFalse());
+    EXPECT_THAT(streamer.popCompleted().has_value(), IsFalse());
+    EXPECT_THAT(streamer.isPending(tileID), IsFalse());
+
+    // Failed tiles are not requested again before the retry delay:
+    streamer.request(tileID);
+    m_threadPool.waitIdle();
+    EXPECT_THAT(streamer.isPending(tileID), IsFalse());
+}
+
+TEST_F(AnariHeightFieldStreamerTest, failedLoadsAreRetriedAfterDelay)
+{
+    AnariHeightFieldStreamer streamer(m_mockLogger, m_mockHeightMap, m_threadPool, chrono::milliseconds(0));
+    const TileID tileID{1U, 2U, 0U};
+
+    EXPECT_CALL(m_mockHeightMap, getTileSampler(Eq(tileID)))
+        .WillOnce(Invoke([](auto&) -> unique_ptr<IHeightMapTileSampler> { throw runtime_error("read error"); }))
+        .WillOnce(Invoke(createTestTileSampler));
+    streamer.request(tileID);
+    m_threadPool.waitIdle();
+    EXPECT_THAT(streamer.hasCompleted(), IsFalse());
+
+    streamer.request(tileID);
+    m_threadPool.waitIdle();
+    auto geometry = streamer.popCompleted();
+    ASSERT_THAT(geometry.has_value(), IsTrue());
+    EXPECT_THAT(geometry->tileID, Eq(tileID));
+    EXPECT_THAT(geometry->isEmpty(), IsFalse());
+}
@@ -0,0 +1,143 @@
+#include "src/anari_resolution_scaler.h"
+
+#include <im3e/test_utils/test_utils.h>
+
+#include <any>
+#include <chrono>
+#include <cmath>
+#include <string_view>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+// Render time of a full resolution frame, 4 times the default target render time of 33 ms:
+constexpr float FullResolutionRenderTimeInMs = 132.0F;
+
+/// @brief Render time of a frame rendered at the given scale, proportional to its number of pixels.
+auto calculateRenderTime(float scale)
+{
+    return chrono::microseconds(lround(FullResolutionRenderTimeInMs * 1000.0F * scale * scale));
+}
+
+}  // namespace
+
+struct AnariResolutionScalerTest : public Test
+{
+    void setProperty(string_view name, any value)
+    {
+        for (auto& pProperty : m_scaler.getProperties()->getChildren())
+        {
+            if (pProperty->getName() == name)
+            {
+                auto pPropertyValue = dynamic_pointer_cast<IPropertyValue>(pProperty);
+                ASSERT_THAT(pPropertyValue, NotNull());
+                pPropertyValue->setAnyValue(std::move(value));
+                return;
+            }
+        }
+        FAIL() << "No property named " << name;
+    }
+
+    /// @brief Render the given number of frames while the camera moves, each at the scale given by the scaler.
+    void renderMovingFrames(uint32_t frameCount)
+    {
+        for (uint32_t i = 0U; i < frameCount; i++)
+        {
+            const auto scale = m_scaler.getScale(true);
+            m_scaler.onFrameRendered(scale, calculateRenderTime(scale));
+        }
+    }
+
+    AnariResolutionScaler m_scaler;
+};
+
+TEST_F(AnariResolutionScalerTest, scaleIsFullResolutionByDefault)
+{
+    EXPECT_THAT(m_scaler.getScale(true), FloatEq(1.0F));
+    EXPECT_THAT(m_scaler.getScale(false), FloatEq(1.0F));
+}
+
+TEST_F(AnariResolutionScalerTest, scaleConvergesToHoldTargetRenderTime)
+{
+    // 4 times fewer pixels to render in the target time, i.e. half the resolution:
+    this->renderMovingFrames(20U);
+    EXPECT_THAT(m_scaler.getScale(true), FloatNear(0.5F, 0.001F));
+}
+
+TEST_F(AnariResolutionScalerTest, scaleCorrectsHalfOfErrorPerFrame)
+{
+    // Wanted scale is 0.5 from a full resolution frame, half of the error is corrected:
+    m_scaler.onFrameRendered(1.0F, calculateRenderTime(1.0F));
+    EXPECT_THAT(m_scaler.getScale(true), FloatEq(0.75F));
+}
+
+TEST_F(AnariResolutionScalerTest, scaleIsClampedToMinScale)
+{
+    for (uint32_t i = 0U; i < 20U; i++)
+    {
+        m_scaler.onFrameRendered(m_scaler.getScale(true), chrono::seconds(10));
+    }
+    EXPECT_THAT(m_scaler.getScale(true), FloatEq(0.25F));
+
+    // Raising the min scale applies to the next frames, even before any frame is rendered:
+    this->setProperty("Min Scale", 0.5F);
+    EXPECT_THAT(m_scaler.getScale(true), FloatEq(0.5F));
+}
+
+TEST_F(AnariResolutionScalerTest, scaleIsClampedToFullResolution)
+{
+    this->renderMovingFrames(20U);
+
+    for (uint32_t i = 0U; i < 20U; i++)
+    {
+        m_scaler.onFrameRendered(m_scaler.getScale(true), chrono::milliseconds(1));
+    }
+    EXPECT_THAT(m_scaler.getScale(true), FloatEq(1.0F));
+}
+
+TEST_F(AnariResolutionScalerTest, scaleIsFullResolutionWhenCameraIsIdle)
+{
+    this->renderMovingFrames(20U);
+
+    EXPECT_THAT(m_scaler.getScale(false), FloatEq(1.0F));
+
+    // The scale reached while moving is kept for the next moves:
+    EXPECT_THAT(m_scaler.getScale(true), FloatNear(0.5F, 0.001F));
+}
+
+TEST_F(AnariResolutionScalerTest, scaleIsFullResolutionWhenDisabled)
+{
+    this->renderMovingFrames(20U);
+
+    this->setProperty("Enabled", false);
+    EXPECT_THAT(m_scaler.getScale(true), FloatEq(1.0F));
+}
+
+TEST_F(AnariResolutionScalerTest, framesWithoutRenderTimeAreIgnored)
+{
+    m_scaler.onFrameRendered(1.0F, chrono::microseconds(0));
+    EXPECT_THAT(m_scaler.getScale(true), FloatEq(1.0F));
+}
+
+TEST_F(AnariResolutionScalerTest, calculateFrameSizeRoundsToNearestPixel)
+{
+    const auto vkFrameSize = AnariResolutionScaler::calculateFrameSize(VkExtent2D{101U, 98U}, 0.5F);
+    EXPECT_THAT(vkFrameSize.width, Eq(51U));
+    EXPECT_THAT(vkFrameSize.height, Eq(49U));
+}
+
+TEST_F(AnariResolutionScalerTest, calculateFrameSizeKeepsViewportSizeAtFullResolution)
+{
+    const auto vkFrameSize = AnariResolutionScaler::calculateFrameSize(VkExtent2D{1920U, 1080U}, 1.0F);
+    EXPECT_THAT(vkFrameSize.width, Eq(1920U));
+    EXPECT_THAT(vkFrameSize.height, Eq(1080U));
+}
+
+TEST_F(AnariResolutionScalerTest, calculateFrameSizeIsAtLeastOnePixel)
+{
+    const auto vkFrameSize = AnariResolutionScaler::calculateFrameSize(VkExtent2D{1U, 3U}, 0.1F);
+    EXPECT_THAT(vkFrameSize.width, Eq(1U));
+    EXPECT_THAT(vkFrameSize.height, Eq(1U));
+}
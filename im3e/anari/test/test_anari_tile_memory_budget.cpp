@@ -0,0 +1,153 @@
+#include "src/anari_tile_memory_budget.h"
+
+#include <im3e/test_utils/test_utils.h>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <optional>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+class MockTileMemoryBudgetClient : public AnariTileMemoryBudget::IClient
+{
+public:
+    MOCK_METHOD(optional<chrono::steady_clock::time_point>, getLeastRecentUseTime, (), (const, override));
+    MOCK_METHOD(void, releaseLeastRecentlyUsedTile, (), (override));
+};
+
+struct TestTile
+{
+    chrono::seconds useTime;
+    size_t byteSize;
+};
+
+}  // namespace
+
+struct AnariTileMemoryBudgetTest : public Test
+{
+    /// @brief Register the given client holding the given tiles, least recently used first, allocated from the budget.
+    /// Released tiles free their bytes from the budget as height fields do.
+    void addClient(MockTileMemoryBudgetClient& rClient, const deque<TestTile>& rTiles)
+    {
+        auto pTiles = make_shared<deque<TestTile>>(rTiles);
+        for (const auto& rTile : rTiles)
+        {
+            ASSERT_THAT(m_budget.allocate(rTile.byteSize), IsTrue());
+        }
+        ON_CALL(rClient, getLeastRecentUseTime())
+            .WillByDefault(Invoke([pTiles]() -> optional<chrono::steady_clock::time_point> {
+                if (pTiles->empty())
+                {
+                    return nullopt;
+                }
+                return chrono::steady_clock::time_point{pTiles->front().useTime};
+            }));
+        ON_CALL(rClient, releaseLeastRecentlyUsedTile()).WillByDefault(Invoke([this, pTiles] {
+            m_budget.free(pTiles->front().byteSize);
+            pTiles->pop_front();
+        }));
+        m_budget.addClient(rClient);
+    }
+
+    AnariTileMemoryBudget m_budget{300U};
+    NiceMock<MockTileMemoryBudgetClient> m_mockClient1;
+    NiceMock<MockTileMemoryBudgetClient> m_mockClient2;
+};
+
+TEST_F(AnariTileMemoryBudgetTest, allocateWithinBudgetReleasesNothing)
+{
+    this->addClient(m_mockClient1, {{1s, 100U}});
+
+    EXPECT_CALL(m_mockClient1, releaseLeastRecentlyUsedTile()).Times(0);
+    EXPECT_THAT(m_budget.allocate(200U), IsTrue());
+    EXPECT_THAT(m_budget.getByteSize(), Eq(300U));
+}
+
+TEST_F(AnariTileMemoryBudgetTest, allocateReleasesLeastRecentlyUsedTilesAcrossClients)
+{
+    this->addClient(m_mockClient1, {{1s, 100U}, {3s, 100U}});
+    this->addClient(m_mockClient2, {{2s, 100U}});
+
+    {
+        InSequence sequence;
+        EXPECT_CALL(m_mockClient1, releaseLeastRecentlyUsedTile());
+        EXPECT_CALL(m_mockClient2, releaseLeastRecentlyUsedTile());
+    }
+    EXPECT_THAT(m_budget.allocate(100U), IsTrue());
+    EXPECT_THAT(m_budget.allocate(100U), IsTrue());
+    EXPECT_THAT(m_budget.getByteSize(), Eq(300U));
+}
+
+TEST_F(AnariTileMemoryBudgetTest, allocateReleasesSeveralTilesToFitLargeAllocation)
+{
+    this->addClient(m_mockClient1, {{1s, 100U}, {3s, 100U}});
+    this->addClient(m_mockClient2, {{2s, 100U}});
+
+    EXPECT_CALL(m_mockClient1, releaseLeastRecentlyUsedTile()).Times(1);
+    EXPECT_CALL(m_mockClient2, releaseLeastRecentlyUsedTile()).Times(1);
+    EXPECT_THAT(m_budget.allocate(200U), IsTrue());
+    EXPECT_THAT(m_budget.getByteSize(), Eq(300U));
+}
+
+TEST_F(AnariTileMemoryBudgetTest, allocateFailsWithoutReleasableTiles)
+{
+    EXPECT_THAT(m_budget.allocate(250U), IsTrue());
+
+    EXPECT_THAT(m_budget.allocate(100U), IsFalse());
+    EXPECT_THAT(m_budget.getByteSize(), Eq(250U));
+}
+
+TEST_F(AnariTileMemoryBudgetTest, allocateFailsWhenReleasingAllTilesIsNotEnough)
+{
+    this->addClient(m_mockClient1, {{1s, 100U}});
+    this->addClient(m_mockClient2, {{2s, 100U}});
+
+    // Tiles are released on the way, nothing is reserved for the failed allocation:
+    EXPECT_CALL(m_mockClient1, releaseLeastRecentlyUsedTile()).Times(1);
+    EXPECT_CALL(m_mockClient2, releaseLeastRecentlyUsedTile()).Times(1);
+    EXPECT_THAT(m_budget.allocate(400U), IsFalse());
+    EXPECT_THAT(m_budget.getByteSize(), Eq(0U));
+}
+
+TEST_F(AnariTileMemoryBudgetTest, removedClientsAreNotReleased)
+{
+    this->addClient(m_mockClient1, {{1s, 100U}});
+    this->addClient(m_mockClient2, {{2s, 100U}});
+    m_budget.removeClient(m_mockClient1);
+
+    EXPECT_CALL(m_mockClient1, releaseLeastRecentlyUsedTile()).Times(0);
+    EXPECT_CALL(m_mockClient2, releaseLeastRecentlyUsedTile()).Times(1);
+    EXPECT_THAT(m_budget.allocate(200U), IsTrue());
+}
+
+TEST_F(AnariTileMemoryBudgetTest, setByteBudgetShrinkingReleasesTilesUntilFit)
+{
+    this->addClient(m_mockClient1, {{1s, 100U}, {3s, 100U}});
+    this->addClient(m_mockClient2, {{2s, 100U}});
+
+    EXPECT_CALL(m_mockClient1, releaseLeastRecentlyUsedTile()).Times(1);
+    EXPECT_CALL(m_mockClient2, releaseLeastRecentlyUsedTile()).Times(1);
+    m_budget.setByteBudget(150U);
+    EXPECT_THAT(m_budget.getByteBudget(), Eq(150U));
+    EXPECT_THAT(m_budget.getByteSize(), Eq(100U));
+}
+
+TEST_F(AnariTileMemoryBudgetTest, setByteBudgetGrowingReleasesNothing)
+{
+    this->addClient(m_mockClient1, {{1s, 100U}, {2s, 100U}});
+
+    EXPECT_CALL(m_mockClient1, releaseLeastRecentlyUsedTile()).Times(0);
+    m_budget.setByteBudget(1000U);
+    EXPECT_THAT(m_budget.getByteSize(), Eq(200U));
+}
+
+TEST_F(AnariTileMemoryBudgetTest, freeDoesNotGoBelowZero)
+{
+    EXPECT_THAT(m_budget.allocate(100U), IsTrue());
+    m_budget.free(200U);
+    EXPECT_THAT(m_budget.getByteSize(), Eq(0U));
+}
@@ -4,7 +4,9 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 
 namespace im3e {
@@ -19,6 +21,19 @@ public:
 
     virtual auto isValid(uint32_t x, uint32_t y) const -> bool = 0;
 
+    /// @brief Copy the heights of consecutive rows of the tile into the given destination.
+    /// Rows are copied one after the other with getSize().x heights per row. Prefer this over calling at() for every
+    /// sample when reading whole tiles.
+    /// @param[in] firstRow Index of the first row to copy
+    /// @param[in] rowCount Number of rows to copy, firstRow + rowCount must not exceed getSize().y
+    /// @param[out] dst Destination, must hold at least rowCount * getSize().x heights
+    virtual void copyRows(uint32_t firstRow, uint32_t rowCount, std::span<float> dst) const = 0;
+
+    /// @brief Copy the validity of the samples of consecutive rows of the tile into the given destination.
+    /// Same layout as copyRows with one byte per sample, set to 1 if the sample is valid and 0 otherwise. Samples
+    /// outside of getActualSize() are invalid.
+    virtual void copyMaskRows(uint32_t firstRow, uint32_t rowCount, std::span<uint8_t> dst) const = 0;
+
     virtual auto getTileID() const -> const TileID& = 0;
     virtual auto getPos() const -> glm::u32vec2 = 0;
     virtual auto getSize() const -> const glm::u32vec2& = 0;
@@ -35,6 +50,8 @@ public:
     /// The height map cannot be in read-only mode.
     virtual void rebuildPyramid() = 0;
 
+    /// @brief Read the tile with the given ID.
+    /// Tiles may be read concurrently from multiple threads: implementations must be thread-safe.
     virtual auto getTileSampler(const TileID& rTileID) -> std::unique_ptr<IHeightMapTileSampler> = 0;
     virtual auto getTileSampler(const glm::u32vec2& rTilePos, uint32_t lod)
         -> std::unique_ptr<IHeightMapTileSampler> = 0;
@@ -46,6 +63,11 @@ public:
     virtual auto getLodCount() const -> uint32_t = 0;
     virtual auto getMinHeight() const -> float = 0;
     virtual auto getMaxHeight() const -> float = 0;
+
+    /// @brief Minimum (x) and maximum (y) heights of the valid samples of the tile with the given ID.
+    /// Height maps without per-tile information return (getMinHeight(), getMaxHeight()). The minimum is greater than
+    /// the maximum for tiles without any valid sample.
+    virtual auto getTileHeightRange(const TileID& rTileID) const -> glm::vec2 = 0;
 };
 
 }  // namespace im3e
\ No newline at end of file
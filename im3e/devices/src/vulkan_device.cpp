@@ -201,7 +201,8 @@ VulkanDevice::VulkanDevice(const ILogger& rLogger, DeviceConfig config)
   , m_physicalDevice(m_instance.choosePhysicalDevice(config.isPresentationSupported))
   , m_pVkDevice(createDeviceAndLoadFcts(m_instance, m_physicalDevice, m_fcts))
   , m_commandQueueInfo(findCommandQueueInfo(m_fcts, m_pVkDevice.get(), m_physicalDevice.queueFamilies))
-  , m_pMemoryAllocator(createVulkanMemoryAllocator(*this, m_instance.loadVmaFcts(m_pVkDevice.get())))
+  , m_pMemoryAllocator(
+        createVulkanMemoryAllocator(*this, m_instance.loadVmaFcts(m_pVkDevice.get()), m_pStatsProvider))
   , m_pCommandQueue(createVulkanCommandQueue(*this, m_commandQueueInfo, "MainQueue"))
 {
     m_pLogger->info("Successfully initialized");
@@ -2,6 +2,8 @@
 
 #include "vulkan_instance.h"
 
+#include <im3e/utils/core/throw_utils.h>
+
 using namespace im3e;
 using namespace std;
 
@@ -28,11 +30,13 @@ auto createVmaAllocator(VkInstance vkInstance, VkPhysicalDevice vkPhysicalDevice
 class VulkanMemoryAllocator : public IVulkanMemoryAllocator
 {
 public:
-    VulkanMemoryAllocator(const IDevice& rDevice, VmaVulkanFunctions vmaFcts)
+    VulkanMemoryAllocator(const IDevice& rDevice, VmaVulkanFunctions vmaFcts, IStatsProvider& rStatsProvider)
       : m_rDevice(rDevice)
       , m_vmaFcts(move(vmaFcts))
       , m_pVmaAllocator(createVmaAllocator(m_rDevice.getVkInstance(), m_rDevice.getVkPhysicalDevice(),
                                            m_rDevice.getVkDevice(), vmaFcts))
+      , m_pAllocationCountGauge(rStatsProvider.getGauge("VulkanMemoryAllocator.allocations"))
+      , m_pAllocatedByteGauge(rStatsProvider.getGauge("VulkanMemoryAllocator.allocatedBytes"))
     {
     }
 
@@ -40,12 +44,21 @@ public:
                      VkImage* pVkImage, VmaAllocation* pVmaAllocation, VmaAllocationInfo* pVmaAllocationInfo)
         -> VkResult override
     {
-        return vmaCreateImage(m_pVmaAllocator.get(), pVkCreateInfo, pVmaCreateInfo, pVkImage, pVmaAllocation,
-                              pVmaAllocationInfo);
+        const auto vkResult = vmaCreateImage(m_pVmaAllocator.get(), pVkCreateInfo, pVmaCreateInfo, pVkImage,
+                                             pVmaAllocation, pVmaAllocationInfo);
+        if (vkResult == VK_SUCCESS)
+        {
+            this->updateGauges(*pVmaAllocation, 1);
+        }
+        return vkResult;
     }
 
     void destroyImage(VkImage vkImage, VmaAllocation vmaAllocation) override
     {
+        if (vmaAllocation)
+        {
+            this->updateGauges(vmaAllocation, -1);
+        }
         vmaDestroyImage(m_pVmaAllocator.get(), vkImage, vmaAllocation);
     }
 
@@ -63,15 +76,27 @@ public:
     }
 
 private:
+    void updateGauges(VmaAllocation vmaAllocation, int64_t sign)
+    {
+        VmaAllocationInfo vmaAllocationInfo{};
+        vmaGetAllocationInfo(m_pVmaAllocator.get(), vmaAllocation, &vmaAllocationInfo);
+        m_pAllocationCountGauge->add(sign);
+        m_pAllocatedByteGauge->add(sign * static_cast<int64_t>(vmaAllocationInfo.size));
+    }
+
     const IDevice& m_rDevice;
     VmaVulkanFunctions m_vmaFcts;
     VkUniquePtr<VmaAllocator> m_pVmaAllocator;
+
+    shared_ptr<Gauge> m_pAllocationCountGauge;
+    shared_ptr<Gauge> m_pAllocatedByteGauge;
 };
 
 }  // namespace
 
-auto im3e::createVulkanMemoryAllocator(const IDevice& rDevice, VmaVulkanFunctions vmaFcts)
-    -> unique_ptr<IVulkanMemoryAllocator>
+auto im3e::createVulkanMemoryAllocator(const IDevice& rDevice, VmaVulkanFunctions vmaFcts,
+                                       shared_ptr<IStatsProvider> pStatsProvider) -> unique_ptr<IVulkanMemoryAllocator>
 {
-    return make_unique<VulkanMemoryAllocator>(rDevice, move(vmaFcts));
+    throwIfArgNull(pStatsProvider, "Vulkan memory allocator requires a stats provider");
+    return make_unique<VulkanMemoryAllocator>(rDevice, move(vmaFcts), *pStatsProvider);
 }
\ No newline at end of file
@@ -20,7 +20,9 @@ public:
     virtual void unmapMemory(VmaAllocation vmaAllocation) = 0;
 };
 
-auto createVulkanMemoryAllocator(const IDevice& rDevice, VmaVulkanFunctions vmaFcts)
+/// @brief Create an allocator publishing the count and bytes of its allocations as gauges of the stats provider.
+auto createVulkanMemoryAllocator(const IDevice& rDevice, VmaVulkanFunctions vmaFcts,
+                                 std::shared_ptr<IStatsProvider> pStatsProvider)
     -> std::unique_ptr<IVulkanMemoryAllocator>;
 
 }  // namespace im3e
\ No newline at end of file
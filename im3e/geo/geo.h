@@ -3,14 +3,18 @@
 #include <im3e/api/height_map.h>
 #include <im3e/utils/loggers.h>
 #include <im3e/utils/math_utils.h>
+#include <im3e/utils/stats.h>
 #include <im3e/utils/view_frustum.h>
 
 #include <glm/glm.hpp>
 
 #include <array>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <string_view>
+#include <vector>
 
 namespace im3e {
 
@@ -18,24 +22,124 @@ struct HeightMapFileConfig
 {
     std::filesystem::path path;
     bool readOnly = true;
+
+    /// @brief Maximum size in bytes of the decoded tiles kept in memory by the height map. 0 disables the cache.
+    size_t tileCacheByteBudget = 256U * 1024U * 1024U;
+
+    /// @brief Optional provider receiving the tile cache hit, miss and eviction events.
+    std::shared_ptr<IStatsProvider> pStatsProvider;
+
+    /// @brief Maximum number of files of a mosaic kept open at once, least recently used files being closed first.
+    uint32_t maxOpenFileCount = 64U;
+
+    /// @brief Maximum number of GDAL datasets opened on a same file, each one reading tiles for one thread at a time.
+    /// Tiles are read concurrently by up to this number of threads, other threads wait for a dataset to be released.
+    uint32_t maxConcurrentReadCount = 8U;
 };
+
+/// @brief Extension of im3e native height map files.
+/// Native height maps are memory-mapped and store every level of details as raw tiles, making tile loads free of any
+/// decoding. They are created from any other height map with convertToNativeHeightMap.
+constexpr std::string_view NativeHeightMapExtension = ".imhm";
+
+/// @brief Extension of mosaic manifest files.
+/// Manifests are text files listing the raster files of a mosaic, one path per line relative to the manifest. Empty
+/// lines and lines starting with '#' are ignored.
+constexpr std::string_view MosaicManifestExtension = ".immosaic";
+
+/// @brief Load the height map file at the given path.
+/// Files with the NativeHeightMapExtension are loaded as im3e native height maps. Directories and files with the
+/// MosaicManifestExtension are loaded as a single mosaic of their GeoTIFF files, which must share the same resolution.
+/// Other files are loaded with GDAL.
 auto loadHeightMapFromFile(const ILogger& rLogger, HeightMapFileConfig config) -> std::unique_ptr<IHeightMap>;
 
+/// @brief Write all levels of details of the given height map to an im3e native height map file.
+void convertToNativeHeightMap(const ILogger& rLogger, IHeightMap& rSrcHeightMap, const std::filesystem::path& rDstPath);
+
 struct HeightMapQuadTreeNode
 {
     TileID tileID;
 
     glm::vec3 minWorldPos;
     glm::vec3 maxWorldPos;
+};
+
+struct HeightMapTileSelectionConfig
+{
+    /// @brief Position of the camera, from which distances to tiles are measured.
+    glm::vec3 viewPosition{};
+
+    /// @brief Size in pixels of an object of world size 1 seen at a distance of 1 from the camera, computed as
+    /// viewportHeight / (2 * tan(fovY / 2)).
+    float projectionScale = 1.0F;
+
+    /// @brief Tiles are refined until the projection of their geometric error on screen is below this size in pixels.
+    float maxScreenSpaceError = 2.0F;
+
+    /// @brief Maximum number of tiles selected and loaded at once, including the children loaded in the background.
+    uint32_t maxTileCount = 100U;
 
-    std::array<std::shared_ptr<HeightMapQuadTreeNode>, 4U> pChildren;
+    /// @brief Returns true if the tile with the given ID can be displayed right away.
+    /// A tile is only replaced by its children once all its visible children are ready, so that coarse tiles remain
+    /// displayed while their children are streamed.
+    std::function<bool(const TileID&)> isTileReady = [](const TileID&) { return true; };
+};
+
+struct HeightMapTileSelection
+{
+    /// @brief Tiles to display, from mixed levels of details, covering every visible part of the height map once.
+    std::vector<TileID> tileIDs;
+
+    /// @brief Tiles to load, most needed first: selected tiles that are not ready, then children of selected tiles
+    /// waiting for them to be ready.
+    std::vector<TileID> missingTileIDs;
+};
+
+/// @brief Quad tree of the tiles of a height map, used to find the tiles visible within a view frustum.
+/// Nodes are bounded vertically by the height ranges of the tiles they cover, as returned by
+/// IHeightMap::getTileHeightRange, so that frustum culling rejects tiles above or below the view.
+///
+/// Nodes are stored level after level in flat arrays, with one array per bound coordinate. The children of a node are
+/// stored next to each other as a group of 4: children outside of the height map are kept as empty nodes, whose
+/// minimum height is greater than their maximum height, so that the 4 children of a node are culled at once.
+class HeightMapQuadTree
+{
+public:
+    explicit HeightMapQuadTree(const IHeightMap& rHeightMap);
 
     /// @brief Find tiles that are visible within the given view frustum.
     /// @param[in] rViewFrustum View frustum
     /// @param[in] lod Level of Detail that the function should return
     /// @return List of vec3 defined as (x, y, l) with (x, y) the tile position at the level of detail l.
     auto findVisible(const ViewFrustum& rViewFrustum, uint32_t lod) const -> std::vector<TileID>;
+
+    /// @brief Select visible tiles from mixed levels of details, refining the tiles closest to the camera the most.
+    /// Tiles are refined by order of decreasing screen space error until their error is below the maximum allowed or
+    /// until the tile budget is exhausted. Tiles of levels of details that the height map does not provide, e.g. when
+    /// it has fewer overviews than the tree has levels, are never selected: they are always refined, even beyond the
+    /// tile budget.
+    auto selectTiles(const ViewFrustum& rViewFrustum, const HeightMapTileSelectionConfig& rConfig) const
+        -> HeightMapTileSelection;
+
+    auto getNodeCount() const -> uint32_t { return static_cast<uint32_t>(m_tileIDs.size()); }
+    auto getNode(uint32_t index) const -> HeightMapQuadTreeNode;
+
+    /// @brief Index of the first of the 4 children of the node at the given index, 0 if the node has no children.
+    auto getFirstChildIndex(uint32_t index) const -> uint32_t { return m_firstChildIndices[index]; }
+
+private:
+    void cullChildren(const ViewFrustum& rViewFrustum, uint32_t firstChildIndex,
+                      std::array<bool, 4U>& rChildrenVisible) const;
+    auto calculateScreenSpaceError(uint32_t index, const HeightMapTileSelectionConfig& rConfig) const -> float;
+
+    // Number of levels of details provided by the height map, which may be less than the number of levels of the tree:
+    uint32_t m_heightMapLodCount;
+
+    std::vector<TileID> m_tileIDs;
+    std::vector<uint32_t> m_firstChildIndices;
+
+    std::array<std::vector<float>, 3U> m_minWorldPos;
+    std::array<std::vector<float>, 3U> m_maxWorldPos;
 };
-auto generateHeightMapQuadTree(const IHeightMap& rHeightMap) -> std::shared_ptr<HeightMapQuadTreeNode>;
 
 }  // namespace im3e
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "gdal_dataset_pool.h"
+
+#include <im3e/utils/core/throw_utils.h>
+
+#include <algorithm>
+#include <exception>
+
+using namespace im3e;
+using namespace std;
+
+GdalDatasetPool::GdalDatasetPool(function<GDALDatasetUniquePtr()> openDataset, uint32_t maxDatasetCount)
+  : m_openDataset(move(openDataset))
+  , m_maxDatasetCount(max(maxDatasetCount, 1U))
+{
+}
+
+auto GdalDatasetPool::acquire() -> DatasetHandle
+{
+    unique_lock lk(m_mutex);
+    m_datasetReleased.wait(lk, [&] { return !m_pIdleDatasets.empty() || m_datasetCount < m_maxDatasetCount; });
+
+    const auto generation = m_generation;
+    auto makeHandle = [&](GDALDatasetUniquePtr pDataset) {
+        return DatasetHandle(pDataset.release(), [this, generation](auto* pDataset) {
+            this->release(pDataset, generation);
+        });
+    };
+    if (!m_pIdleDatasets.empty())
+    {
+        auto pDataset = move(m_pIdleDatasets.back());
+        m_pIdleDatasets.pop_back();
+        return makeHandle(move(pDataset));
+    }
+
+    // Opening a file is slow, other threads keep acquiring and releasing datasets in the meantime:
+    m_datasetCount++;
+    lk.unlock();
+    GDALDatasetUniquePtr pDataset;
+    try
+    {
+        pDataset = m_openDataset();
+        throwIfNull<runtime_error>(pDataset, "Failed to open GDAL dataset");
+    }
+    catch (...)
+    {
+        lk.lock();
+        m_datasetCount--;
+        m_datasetReleased.notify_one();
+        throw;
+    }
+    return makeHandle(move(pDataset));
+}
+
+void GdalDatasetPool::release(GDALDataset* pDataset, uint64_t generation)
+{
+    // Outdated datasets are closed when leaving this function, outside of the lock:
+    GDALDatasetUniquePtr pReleasedDataset(pDataset);
+    {
+        lock_guard lk(m_mutex);
+        if (generation == m_generation)
+        {
+            m_pIdleDatasets.emplace_back(move(pReleasedDataset));
+        }
+        else
+        {
+            m_datasetCount--;
+        }
+    }
+    m_datasetReleased.notify_one();
+}
+
+void GdalDatasetPool::clear()
+{
+    vector<GDALDatasetUniquePtr> pIdleDatasets;
+    {
+        lock_guard lk(m_mutex);
+        m_generation++;
+        m_datasetCount -= static_cast<uint32_t>(m_pIdleDatasets.size());
+        pIdleDatasets.swap(m_pIdleDatasets);
+    }
+    m_datasetReleased.notify_all();
+}
+
+auto GdalDatasetPool::getDatasetCount() const -> uint32_t
+{
+    lock_guard lk(m_mutex);
+    return m_datasetCount;
+}
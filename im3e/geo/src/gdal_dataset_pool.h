@@ -0,0 +1,52 @@
+#pragma once
+
+#include <im3e/utils/core/types.h>
+
+#include <gdal_priv.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace im3e {
+
+/// @brief Pool of GDAL datasets opened on the same file, allowing tiles to be read from several threads at once.
+/// A GDAL dataset and its raster bands must only be used by one thread at a time: each reader acquires a dataset of its
+/// own, opened on demand and returned to the pool for reuse once released. Acquiring blocks while the maximum number of
+/// datasets are in use. The pool is thread-safe and must outlive the datasets acquired from it.
+class GdalDatasetPool
+{
+public:
+    using DatasetHandle = UniquePtrWithDeleter<GDALDataset>;
+
+    GdalDatasetPool(std::function<GDALDatasetUniquePtr()> openDataset, uint32_t maxDatasetCount);
+
+    /// @brief Acquire a dataset for exclusive use by the calling thread until the returned handle is destroyed.
+    auto acquire() -> DatasetHandle;
+
+    /// @brief Close the datasets not in use, datasets in use are closed when released.
+    /// Used when the file was modified through another dataset, so that following reads see the changes.
+    void clear();
+
+    /// @brief Number of open datasets, in use or not.
+    auto getDatasetCount() const -> uint32_t;
+    auto getMaxDatasetCount() const -> uint32_t { return m_maxDatasetCount; }
+
+private:
+    void release(GDALDataset* pDataset, uint64_t generation);
+
+    const std::function<GDALDatasetUniquePtr()> m_openDataset;
+    const uint32_t m_maxDatasetCount;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_datasetReleased;
+    std::vector<GDALDatasetUniquePtr> m_pIdleDatasets;
+    uint32_t m_datasetCount{};
+
+    // Incremented when clearing the pool, datasets of older generations are closed instead of being reused:
+    uint64_t m_generation{};
+};
+
+}  // namespace im3e
@@ -1,13 +1,20 @@
 #include "gdal_geotiff_height_map.h"
 
+#include "gdal_mosaic_height_map.h"
 #include "gdal_utils.h"
+#include "height_map_pyramid.h"
+#include "native_height_map.h"
 
 #include <im3e/utils/core/throw_utils.h>
+#include <im3e/utils/thread_pool.h>
 
 #include <fmt/format.h>
 #include <fmt/std.h>
 
+#include <algorithm>
+#include <exception>
 #include <limits>
+#include <optional>
 
 using namespace im3e;
 using namespace std;
@@ -170,78 +177,25 @@ auto getRasterBandWithLod(GDALRasterBand& rRasterBand, uint32_t lod) -> GDALRast
     return (lod == 0U) ? rRasterBand : *rRasterBand.GetOverview(lod - 1U);
 }
 
-class GdalGeoTiffHeightMapTileSampler : public IHeightMapTileSampler
+auto readBlockSize(GDALRasterBand& rBand)
 {
-public:
-    GdalGeoTiffHeightMapTileSampler(GDALRasterBand& rBand, const TileID& rTileID, float scale)
-      : m_tileID(rTileID)
-      , m_size([&rBand] {
-          int sizeX, sizeY;
-          rBand.GetBlockSize(&sizeX, &sizeY);
-          return glm::u32vec2{static_cast<uint32_t>(sizeX), static_cast<uint32_t>(sizeY)};
-      }())
-      , m_actualSize([this, &rBand] {
-          int actualSizeX, actualSizeY;
-          rBand.GetActualBlockSize(m_tileID.x, m_tileID.y, &actualSizeX, &actualSizeY);
-          return glm::u32vec2{static_cast<uint32_t>(actualSizeX), static_cast<uint32_t>(actualSizeY)};
-      }())
-      , m_scale(scale)
-      , m_noDataValue([&]() -> std::optional<float> {
-          int noDataValueFound{};
-          const auto noDataValue = rBand.GetNoDataValue(&noDataValueFound);
-          if (noDataValueFound)
-          {
-              return noDataValue;
-          }
-          return std::nullopt;
-      }())
-
-      , m_pBlock{throwIfNull<std::runtime_error>(rBand.GetLockedBlockRef(m_tileID.x, m_tileID.y),
-                                                 fmt::format("Failed to read GDAL height map tile with ID ({}; {}; {})",
-                                                             m_tileID.x, m_tileID.y, m_tileID.z)),
-                 [](auto* pBlock) { pBlock->DropLock(); }}
-      , m_pData{reinterpret_cast<const float*>(m_pBlock->GetDataRef())}
-
-      , m_pMaskBlock([this, &rBand]() -> UniquePtrWithDeleter<GDALRasterBlock> {
-          auto pMaskBand = rBand.GetMaskBand();
-          if (!pMaskBand)
-          {
-              return nullptr;
-          }
-          return UniquePtrWithDeleter<GDALRasterBlock>{pMaskBand->GetLockedBlockRef(m_tileID.x, m_tileID.y),
-                                                       [](auto* pBlock) { pBlock->DropLock(); }};
-      }())
-      , m_pMaskData(m_pMaskBlock ? reinterpret_cast<const uint8_t*>(m_pMaskBlock->GetDataRef()) : nullptr)
-    {
-    }
-
-    auto at(uint32_t x, uint32_t y) const -> float override { return *(m_pData + y * m_size.x + x); }
-    auto at(const glm::u32vec2& rPos) const -> float override { return this->at(rPos.x, rPos.y); }
-
-    auto isValid(uint32_t x, uint32_t y) const -> bool override
-    {
-        return x < m_actualSize.x && y < m_actualSize.y && m_pMaskData && *(m_pMaskData + y * m_size.x + x) != 0U;
-    }
-
-    auto getTileID() const -> const TileID& override { return m_tileID; }
-    auto getPos() const -> glm::u32vec2 override { return m_tileID.xy(); }
-    auto getSize() const -> const glm::u32vec2& override { return m_size; }
-    auto getActualSize() const -> const glm::u32vec2& override { return m_actualSize; }
-    auto getScale() const -> float override { return m_scale; }
-
-private:
-    const TileID m_tileID;
-    const glm::u32vec2 m_size;
-    const glm::u32vec2 m_actualSize;
-    const float m_scale;
-    const std::optional<float> m_noDataValue;
-
-    UniquePtrWithDeleter<GDALRasterBlock> m_pBlock{};
-    const float* m_pData;
+    int sizeX, sizeY;
+    rBand.GetBlockSize(&sizeX, &sizeY);
+    return glm::u32vec2{static_cast<uint32_t>(sizeX), static_cast<uint32_t>(sizeY)};
+}
 
-    UniquePtrWithDeleter<GDALRasterBlock> m_pMaskBlock{};
-    const uint8_t* m_pMaskData;
-};
+/// @brief Copy the given block of a raster band into the given destination, sized to contain a whole block.
+template <typename T>
+void copyBlock(GDALRasterBand& rBand, const TileID& rTileID, std::vector<T>& rDst)
+{
+    UniquePtrWithDeleter<GDALRasterBlock> pBlock{
+        throwIfNull<std::runtime_error>(rBand.GetLockedBlockRef(rTileID.x, rTileID.y),
+                                        fmt::format("Failed to read GDAL height map tile with ID ({}; {}; {})",
+                                                    rTileID.x, rTileID.y, rTileID.z)),
+        [](auto* pBlock) { pBlock->DropLock(); }};
+    auto pData = reinterpret_cast<const T*>(pBlock->GetDataRef());
+    std::copy(pData, pData + rDst.size(), rDst.data());
+}
 
 }  // namespace
 
@@ -251,6 +205,13 @@ GdalGeoTiffHeightMap::GdalGeoTiffHeightMap(const ILogger& rLogger, HeightMapFile
   , m_pGdalInstance(getGdalInstance(rLogger))
   , m_pDataset(createGdalDataset(*m_pLogger, m_config))
   , m_pRasterBand(loadRasterBand(*m_pLogger, *m_pDataset))
+  , m_datasetPool(
+        [this] {
+            // Tiles are only read from these datasets, writes go through m_pDataset:
+            return GDALDatasetUniquePtr(GDALDataset::FromHandle(GDALOpen(m_config.path.c_str(), GA_ReadOnly)));
+        },
+        m_config.maxConcurrentReadCount)
+  , m_tileCache(m_config.path.stem().string(), m_config.tileCacheByteBudget, m_config.pStatsProvider)
 
   , m_size(readSize(*m_pRasterBand))
   , m_tileSize(readTileSize(*m_pRasterBand))
@@ -258,10 +219,43 @@ GdalGeoTiffHeightMap::GdalGeoTiffHeightMap(const ILogger& rLogger, HeightMapFile
 
   , m_minHeight(static_cast<float>(m_pRasterBand->GetMinimum()))
   , m_maxHeight(static_cast<float>(m_pRasterBand->GetMaximum()))
+  , m_tileRanges(this->loadTileRanges())
 {
+    if (m_config.pStatsProvider)
+    {
+        const auto name = this->getName();
+        m_pTileReadCounter = m_config.pStatsProvider->getCounter(fmt::format("{}.tileReads", name));
+        m_pTileReadByteCounter = m_config.pStatsProvider->getCounter(fmt::format("{}.tileReadBytes", name));
+        m_pOpenDatasetGauge = m_config.pStatsProvider->getGauge(fmt::format("{}.openDatasets", name));
+    }
     m_pLogger->info("Successfully loaded file");
 }
 
+auto GdalGeoTiffHeightMap::loadTileRanges() const -> HeightMapTileRanges
+{
+    const auto path = getHeightMapTileRangesPath(m_config.path);
+    auto tileRanges = loadHeightMapTileRanges(path);
+    if (!tileRanges)
+    {
+        m_pLogger->info(fmt::format("No valid tile height ranges found in \"{}\", rebuild the pyramid to create them",
+                                    path));
+        return HeightMapTileRanges{};
+    }
+
+    bool matchesHeightMap = tileRanges->getLodCount() == m_lodCount;
+    for (uint32_t lod = 0U; matchesHeightMap && lod < m_lodCount; lod++)
+    {
+        matchesHeightMap = tileRanges->getTileCounts()[lod] == this->getTileCount(lod);
+    }
+    if (!matchesHeightMap)
+    {
+        m_pLogger->warning(
+            fmt::format("Ignoring outdated tile height ranges \"{}\", rebuild the pyramid to update them", path));
+        return HeightMapTileRanges{};
+    }
+    return std::move(*tileRanges);
+}
+
 namespace {
 
 auto buildPyramidProgressFunction(double progress, const char* pMessage, void* pUserData) -> int
@@ -278,6 +272,94 @@ auto buildPyramidProgressFunction(double progress, const char* pMessage, void* p
     return true;
 }
 
+auto findOverviewWithSize(GDALRasterBand& rRasterBand, const glm::u32vec2& rSize) -> GDALRasterBand&
+{
+    for (auto i = 0; i < rRasterBand.GetOverviewCount(); i++)
+    {
+        auto pOverview = rRasterBand.GetOverview(i);
+        if (readSize(*pOverview) == rSize)
+        {
+            return *pOverview;
+        }
+    }
+    throw std::runtime_error(fmt::format("Failed to find overview of size {}x{}", rSize.x, rSize.y));
+}
+
+auto findLevelWithSize(GDALRasterBand& rRasterBand, const glm::u32vec2& rSize) -> GDALRasterBand&
+{
+    return (readSize(rRasterBand) == rSize) ? rRasterBand : findOverviewWithSize(rRasterBand, rSize);
+}
+
+struct PyramidLevelConfig
+{
+    glm::u32vec2 srcSize;
+    GDALRasterBand& rDstBand;
+    glm::u32vec2 tileSize;
+
+    bool writeMask;
+    std::optional<float> noDataValue;
+};
+
+/// @brief Compute a tile of a pyramid level from the level above it.
+/// The source tile is read and decoded through a read-only dataset of the given pool, concurrently with other tiles.
+/// Only writes to the destination level are serialized with the given mutex.
+void buildPyramidTile(const PyramidLevelConfig& rConfig, const glm::u32vec2& rTilePos,
+                      GdalDatasetPool& rReadDatasetPool, std::mutex& rDatasetMutex)
+{
+    const auto srcSize = rConfig.srcSize;
+    const auto dstSize = readSize(rConfig.rDstBand);
+
+    const auto dstOrigin = rTilePos * rConfig.tileSize;
+    const auto dstTileSize = glm::min(rConfig.tileSize, dstSize - dstOrigin);
+    const auto srcOrigin = dstOrigin * 2U;
+    const auto srcReadSize = glm::min(dstTileSize * 2U, srcSize - srcOrigin);
+
+    // Samples past the edge of the source level remain masked out:
+    const auto srcStride = dstTileSize.x * 2U;
+    const auto srcSampleCount = static_cast<size_t>(srcStride) * dstTileSize.y * 2U;
+    std::vector<float> srcHeights(srcSampleCount);
+    std::vector<uint8_t> srcMask(srcSampleCount);
+    {
+        auto pReadDataset = rReadDatasetPool.acquire();
+        auto& rSrcBand = findLevelWithSize(*pReadDataset->GetRasterBand(1), srcSize);
+        auto readCode = rSrcBand.RasterIO(GF_Read, srcOrigin.x, srcOrigin.y, srcReadSize.x, srcReadSize.y,
+                                          srcHeights.data(), srcReadSize.x, srcReadSize.y, GDT_Float32, sizeof(float),
+                                          srcStride * sizeof(float), nullptr);
+        if (readCode == CE_None)
+        {
+            readCode = rSrcBand.GetMaskBand()->RasterIO(GF_Read, srcOrigin.x, srcOrigin.y, srcReadSize.x,
+                                                        srcReadSize.y, srcMask.data(), srcReadSize.x, srcReadSize.y,
+                                                        GDT_Byte, 1, srcStride, nullptr);
+        }
+        throwIfFalse<std::runtime_error>(readCode == CE_None, "Failed to read pyramid level");
+    }
+
+    const auto dstSampleCount = static_cast<size_t>(dstTileSize.x) * dstTileSize.y;
+    std::vector<float> dstHeights(dstSampleCount);
+    std::vector<uint8_t> dstMask(dstSampleCount);
+    downsampleHeights(srcHeights.data(), srcMask.data(), srcStride, dstHeights.data(), dstMask.data(), dstTileSize);
+
+    if (rConfig.noDataValue)
+    {
+        for (size_t i = 0U; i < dstSampleCount; i++)
+        {
+            dstHeights[i] = (dstMask[i] != 0U) ? dstHeights[i] : *rConfig.noDataValue;
+        }
+    }
+
+    std::lock_guard lk(rDatasetMutex);
+    auto writeCode = rConfig.rDstBand.RasterIO(GF_Write, dstOrigin.x, dstOrigin.y, dstTileSize.x, dstTileSize.y,
+                                               dstHeights.data(), dstTileSize.x, dstTileSize.y, GDT_Float32, 0, 0,
+                                               nullptr);
+    if (writeCode == CE_None && rConfig.writeMask)
+    {
+        writeCode = rConfig.rDstBand.GetMaskBand()->RasterIO(GF_Write, dstOrigin.x, dstOrigin.y, dstTileSize.x,
+                                                             dstTileSize.y, dstMask.data(), dstTileSize.x,
+                                                             dstTileSize.y, GDT_Byte, 0, 0, nullptr);
+    }
+    throwIfFalse<std::runtime_error>(writeCode == CE_None, "Failed to write pyramid level");
+}
+
 }  // namespace
 
 void GdalGeoTiffHeightMap::rebuildPyramid()
@@ -285,6 +367,7 @@ void GdalGeoTiffHeightMap::rebuildPyramid()
     throwIfFalse<std::logic_error>(!m_config.readOnly, "Cannot rebuild pyramid of GeoTIFF while in read-only mode");
 
     std::vector<int> decimationFactors{};
+    std::vector<glm::u32vec2> levelSizes{};
     glm::u32vec2 currSize{m_pRasterBand->GetXSize(), m_pRasterBand->GetYSize()};
     float currFactor = 1.0F;
     while (currSize.x > m_tileSize.x || currSize.y > m_tileSize.y)
@@ -293,6 +376,7 @@ void GdalGeoTiffHeightMap::rebuildPyramid()
         currSize = (currSize + 1U) / 2U;
         currFactor *= 2.0F;
         decimationFactors.emplace_back(currFactor);
+        levelSizes.emplace_back(currSize);
 
         m_pLogger->info(fmt::format("level {}: {}x{} => {}x{}, factor = {}", decimationFactors.size(), prevSize.x,
                                     prevSize.y, currSize.x, currSize.y, decimationFactors.back()));
@@ -300,28 +384,111 @@ void GdalGeoTiffHeightMap::rebuildPyramid()
 
     const int targetBandIndex = 1U;
 
-    const auto returnCode = m_pDataset->BuildOverviews("BILINEAR", decimationFactors.size(), decimationFactors.data(),
-                                                       1U, &targetBandIndex, &buildPyramidProgressFunction,
+    // Let GDAL create the overviews without computing them, their content is computed below:
+    const auto returnCode = m_pDataset->BuildOverviews("NONE", decimationFactors.size(), decimationFactors.data(), 1U,
+                                                       &targetBandIndex, &buildPyramidProgressFunction,
                                                        m_pLogger.get());
     throwIfFalse<std::runtime_error>(returnCode == CE_None, "Failed to build pyramid of GeoTIFF");
+
+    // Source tiles are read through the datasets of the pool, which only see the overviews once written to the file:
+    m_pDataset->FlushCache();
+    m_datasetPool.clear();
+
+    // Masks derived from the no data value are kept in sync by writing the no data value to invalid samples, other
+    // masks are written to the mask overviews that GDAL created along with the overviews.
+    const auto maskFlags = m_pRasterBand->GetMaskFlags();
+    int noDataValueFound{};
+    const auto noDataValue = static_cast<float>(m_pRasterBand->GetNoDataValue(&noDataValueFound));
+    const bool writeMask = maskFlags == GMF_PER_DATASET;
+
+    size_t totalTileCount{};
+    for (const auto& rLevelSize : levelSizes)
+    {
+        const auto tileCount = (rLevelSize + m_tileSize - 1U) / m_tileSize;
+        totalTileCount += static_cast<size_t>(tileCount.x) * tileCount.y;
+    }
+
+    std::mutex progressMutex;
+    size_t builtTileCount{};
+    uint32_t reportedPercentage{};
+    std::exception_ptr pFirstException;
+
+    // Each level is computed from the previous one, one level at a time: at most one task per tile of the current
+    // level is queued and each task only holds the samples of its own tile.
+    ThreadPool threadPool;
+    auto srcSize = readSize(*m_pRasterBand);
+    for (const auto& rLevelSize : levelSizes)
+    {
+        auto& rDstBand = findOverviewWithSize(*m_pRasterBand, rLevelSize);
+        const PyramidLevelConfig levelConfig{
+            .srcSize = srcSize,
+            .rDstBand = rDstBand,
+            .tileSize = readTileSize(rDstBand),
+            .writeMask = writeMask,
+            .noDataValue = noDataValueFound ? std::optional<float>(noDataValue) : std::nullopt,
+        };
+
+        const auto tileCount = calculateTileCount(rDstBand, levelConfig.tileSize);
+        for (uint32_t y = 0U; y < tileCount.y; y++)
+        {
+            for (uint32_t x = 0U; x < tileCount.x; x++)
+            {
+                threadPool.submit([&, tilePos = glm::u32vec2{x, y}] {
+                    try
+                    {
+                        buildPyramidTile(levelConfig, tilePos, m_datasetPool, m_datasetMutex);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard lk(progressMutex);
+                        pFirstException = pFirstException ? pFirstException : std::current_exception();
+                    }
+
+                    std::lock_guard lk(progressMutex);
+                    builtTileCount++;
+                    const auto percentage = static_cast<uint32_t>(builtTileCount * 100U / totalTileCount);
+                    if (percentage != reportedPercentage)
+                    {
+                        reportedPercentage = percentage;
+                        buildPyramidProgressFunction(static_cast<double>(builtTileCount) / totalTileCount, nullptr,
+                                                     m_pLogger.get());
+                    }
+                });
+            }
+        }
+        threadPool.waitIdle();
+        if (pFirstException)
+        {
+            std::rethrow_exception(pFirstException);
+        }
+
+        // The level is the source of the next one, datasets opened for reading must see its new content:
+        m_pDataset->FlushCache();
+        m_datasetPool.clear();
+        srcSize = rLevelSize;
+    }
+
+    // Overviews changed, cached tiles of lower levels of details are outdated:
+    m_tileCache.clear();
+    m_lodCount = readLodCount(*m_pRasterBand);
+
+    m_pLogger->info("Computing tile height ranges");
+    m_tileRanges = computeHeightMapTileRanges(*this);
+    saveHeightMapTileRanges(m_tileRanges, getHeightMapTileRangesPath(m_config.path));
 }
 
 auto GdalGeoTiffHeightMap::getTileSampler(const TileID& rTileID) -> std::unique_ptr<IHeightMapTileSampler>
 {
     throwIfFalse<invalid_argument>(rTileID.z < m_lodCount,
                                    fmt::format("Invalid input LOD: {} > max {}", rTileID.z, m_lodCount));
-    auto& rBand = getRasterBandWithLod(*m_pRasterBand, rTileID.z);
-    const auto scale = pow(2.0F, rTileID.z);
-    return std::make_unique<GdalGeoTiffHeightMapTileSampler>(rBand, rTileID, scale);
+    auto pTile = m_tileCache.getOrLoad(rTileID, [&] { return this->loadTile(rTileID); });
+    return std::make_unique<HeightMapTileSampler>(std::move(pTile));
 }
 
 auto GdalGeoTiffHeightMap::getTileSampler(const glm::u32vec2& rTilePos, uint32_t lod)
     -> std::unique_ptr<IHeightMapTileSampler>
 {
-    throwIfFalse<invalid_argument>(lod < m_lodCount, fmt::format("Invalid input LOD: {} > max {}", lod, m_lodCount));
-    auto& rBand = getRasterBandWithLod(*m_pRasterBand, lod);
-    const auto scale = pow(2.0F, lod);
-    return std::make_unique<GdalGeoTiffHeightMapTileSampler>(rBand, TileID{rTilePos.x, rTilePos.y, lod}, scale);
+    return this->getTileSampler(TileID{rTilePos.x, rTilePos.y, lod});
 }
 
 auto GdalGeoTiffHeightMap::getTileCount(uint32_t lod) const -> glm::u32vec2
@@ -331,7 +498,57 @@ auto GdalGeoTiffHeightMap::getTileCount(uint32_t lod) const -> glm::u32vec2
     return calculateTileCount(rBand, m_tileSize);
 }
 
+auto GdalGeoTiffHeightMap::getTileHeightRange(const TileID& rTileID) const -> glm::vec2
+{
+    return m_tileRanges.contains(rTileID) ? m_tileRanges.get(rTileID) : glm::vec2{m_minHeight, m_maxHeight};
+}
+
+auto GdalGeoTiffHeightMap::loadTile(const TileID& rTileID) -> HeightMapTile
+{
+    // Each thread reads from a dataset of its own, tiles are loaded concurrently:
+    auto pDataset = m_datasetPool.acquire();
+    if (m_pOpenDatasetGauge)
+    {
+        m_pOpenDatasetGauge->set(m_datasetPool.getDatasetCount());
+    }
+    auto& rBand = getRasterBandWithLod(*pDataset->GetRasterBand(1), rTileID.z);
+
+    HeightMapTile tile{
+        .tileID = rTileID,
+        .size = readBlockSize(rBand),
+        .scale = static_cast<float>(pow(2.0F, rTileID.z)),
+    };
+    const auto sampleCount = static_cast<size_t>(tile.size.x) * static_cast<size_t>(tile.size.y);
+    tile.heights.resize(sampleCount);
+
+    int actualSizeX, actualSizeY;
+    rBand.GetActualBlockSize(rTileID.x, rTileID.y, &actualSizeX, &actualSizeY);
+    tile.actualSize = glm::u32vec2{static_cast<uint32_t>(actualSizeX), static_cast<uint32_t>(actualSizeY)};
+
+    copyBlock(rBand, rTileID, tile.heights);
+    if (auto pMaskBand = rBand.GetMaskBand())
+    {
+        tile.mask.resize(sampleCount);
+        copyBlock(*pMaskBand, rTileID, tile.mask);
+    }
+
+    if (m_pTileReadCounter)
+    {
+        m_pTileReadCounter->add();
+        m_pTileReadByteCounter->add(static_cast<int64_t>(tile.getByteSize()));
+    }
+    return tile;
+}
+
 auto im3e::loadHeightMapFromFile(const ILogger& rLogger, HeightMapFileConfig config) -> unique_ptr<IHeightMap>
 {
+    if (config.path.extension() == NativeHeightMapExtension)
+    {
+        return make_unique<NativeHeightMap>(rLogger, move(config));
+    }
+    if (filesystem::is_directory(config.path) || config.path.extension() == MosaicManifestExtension)
+    {
+        return make_unique<GdalMosaicHeightMap>(rLogger, move(config));
+    }
     return make_unique<GdalGeoTiffHeightMap>(rLogger, move(config));
 }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "gdal_dataset_pool.h"
 #include "gdal_instance.h"
 #include "geo.h"
+#include "height_map_tile_cache.h"
+#include "height_map_tile_ranges.h"
 
 #include <im3e/api/height_map.h>
 #include <im3e/utils/loggers.h>
@@ -9,6 +12,7 @@
 #include <gdal_priv.h>
 
 #include <memory>
+#include <mutex>
 #include <numeric>
 
 namespace im3e {
@@ -31,8 +35,15 @@ public:
     auto getLodCount() const -> uint32_t override { return m_lodCount; }
     auto getMinHeight() const -> float override { return m_minHeight; }
     auto getMaxHeight() const -> float override { return m_maxHeight; }
+    auto getTileHeightRange(const TileID& rTileID) const -> glm::vec2 override;
+
+    auto getTileCache() const -> const HeightMapTileCache& { return m_tileCache; }
+    auto getDatasetPool() const -> const GdalDatasetPool& { return m_datasetPool; }
 
 private:
+    auto loadTile(const TileID& rTileID) -> HeightMapTile;
+    auto loadTileRanges() const -> HeightMapTileRanges;
+
     std::unique_ptr<ILogger> m_pLogger;
     const HeightMapFileConfig m_config;
 
@@ -40,12 +51,26 @@ private:
     GDALDatasetUniquePtr m_pDataset;
     GDALRasterBand* m_pRasterBand;
 
+    // GDAL datasets are not thread-safe: writes to m_pDataset while rebuilding the pyramid are serialized, tiles and
+    // the sources of the pyramid levels are read concurrently through datasets of their own.
+    std::mutex m_datasetMutex;
+    GdalDatasetPool m_datasetPool;
+    HeightMapTileCache m_tileCache;
+
     const glm::u32vec2 m_size;
     const glm::u32vec2 m_tileSize;
-    const uint32_t m_lodCount;
+    uint32_t m_lodCount;
 
     const float m_minHeight = std::numeric_limits<float>::min();
     const float m_maxHeight = std::numeric_limits<float>::max();
+
+    // Read from the sidecar file written when rebuilding the pyramid, empty if there is none:
+    HeightMapTileRanges m_tileRanges;
+
+    // Metrics of the stats provider, null without provider:
+    std::shared_ptr<Counter> m_pTileReadCounter;
+    std::shared_ptr<Counter> m_pTileReadByteCounter;
+    std::shared_ptr<Gauge> m_pOpenDatasetGauge;
 };
 
 }  // namespace im3e
\ No newline at end of file
@@ -0,0 +1,462 @@
+#include "gdal_mosaic_height_map.h"
+
+#include "height_map_tile_ranges.h"
+
+#include <im3e/utils/core/throw_utils.h>
+#include <im3e/utils/thread_pool.h>
+
+#include <fmt/format.h>
+#include <fmt/std.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <string>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+constexpr glm::u32vec2 MosaicTileSize{512U, 512U};
+
+auto getMosaicName(const filesystem::path& rPath)
+{
+    // Directories given with a trailing separator have an empty file name:
+    return (rPath.has_filename() ? rPath : rPath.parent_path()).stem().string();
+}
+
+auto isGeoTiffFile(const filesystem::path& rPath)
+{
+    auto extension = rPath.extension().string();
+    ranges::transform(extension, extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return extension == ".tif" || extension == ".tiff";
+}
+
+auto listMosaicFiles(const filesystem::path& rPath)
+{
+    vector<filesystem::path> paths;
+    if (filesystem::is_directory(rPath))
+    {
+        for (const auto& rEntry : filesystem::directory_iterator(rPath))
+        {
+            if (rEntry.is_regular_file() && isGeoTiffFile(rEntry.path()))
+            {
+                paths.emplace_back(rEntry.path());
+            }
+        }
+        // Files overlapping each other are merged in this order, keep it stable:
+        ranges::sort(paths);
+    }
+    else
+    {
+        ifstream manifest(rPath);
+        throwIfFalse<runtime_error>(manifest.is_open(), fmt::format("Failed to open mosaic manifest \"{}\"", rPath));
+        string line;
+        while (getline(manifest, line))
+        {
+            line.erase(line.find_last_not_of(" \t\r") + 1U);
+            if (!line.empty() && line.front() != '#')
+            {
+                paths.emplace_back(rPath.parent_path() / line);
+            }
+        }
+    }
+    throwIfFalse<runtime_error>(!paths.empty(), fmt::format("No GeoTIFF file found for mosaic \"{}\"", rPath));
+    return paths;
+}
+
+/// @brief Georeferencing of a file, as read from its header.
+struct FileHeader
+{
+    glm::dvec2 origin;
+    glm::dvec2 pixelSize;
+    glm::u32vec2 size;
+    glm::vec2 heightRange;
+    uint32_t lodCount;
+};
+
+auto calculateFileLodCount(GDALRasterBand& rRasterBand, const glm::u32vec2& rSize)
+{
+    // Coarsest resolution the file can be read at without going through all its samples, its smallest overview if any:
+    auto coarsestSize = rSize;
+    for (int overviewIndex = 0; overviewIndex < rRasterBand.GetOverviewCount(); overviewIndex++)
+    {
+        if (auto pOverview = rRasterBand.GetOverview(overviewIndex))
+        {
+            coarsestSize = glm::min(coarsestSize, glm::u32vec2{pOverview->GetXSize(), pOverview->GetYSize()});
+        }
+    }
+
+    // Reading no more than a tile of samples is cheap whatever the level of details:
+    if (coarsestSize.x <= MosaicTileSize.x && coarsestSize.y <= MosaicTileSize.y)
+    {
+        return numeric_limits<uint32_t>::max();
+    }
+
+    // Levels down to the coarsest resolution, halved as by GDAL, and the next one which averages 2x2 of its samples:
+    uint32_t lodCount = 2U;
+    for (auto size = (rSize + 1U) / 2U; glm::all(glm::greaterThanEqual(size, coarsestSize)); size = (size + 1U) / 2U)
+    {
+        lodCount++;
+    }
+    return lodCount;
+}
+
+auto readFileHeightRange(GDALRasterBand& rRasterBand)
+{
+    // Minimum and maximum are read from the metadata when the file has statistics. Otherwise, they are computed from
+    // the smallest overview rather than from every sample, which is approximate but reads little of the file:
+    int hasMinHeight{};
+    int hasMaxHeight{};
+    const auto minHeight = rRasterBand.GetMinimum(&hasMinHeight);
+    const auto maxHeight = rRasterBand.GetMaximum(&hasMaxHeight);
+    if (hasMinHeight && hasMaxHeight)
+    {
+        return glm::vec2{minHeight, maxHeight};
+    }
+
+    array<double, 2U> minMax{};
+    if (rRasterBand.ComputeRasterMinMax(TRUE, minMax.data()) != CE_None)
+    {
+        // No valid sample in the file:
+        CPLErrorReset();
+        return EmptyHeightRange;
+    }
+    return glm::vec2{minMax[0], minMax[1]};
+}
+
+auto readFileHeader(const filesystem::path& rPath)
+{
+    GDALDatasetUniquePtr pDataset(GDALDataset::FromHandle(GDALOpen(rPath.c_str(), GA_ReadOnly)));
+    throwIfNull<runtime_error>(pDataset, fmt::format("Failed to open mosaic file \"{}\"", rPath));
+    throwIfFalse<runtime_error>(pDataset->GetRasterCount() == 1,
+                                fmt::format("Unexpected number of raster bands in \"{}\", expected 1", rPath));
+
+    array<double, 6U> geoTransform{};
+    throwIfFalse<runtime_error>(pDataset->GetGeoTransform(geoTransform.data()) == CE_None,
+                                fmt::format("Mosaic file \"{}\" is not georeferenced", rPath));
+    throwIfFalse<runtime_error>(geoTransform[2] == 0.0 && geoTransform[4] == 0.0 && geoTransform[5] < 0.0,
+                                fmt::format("Mosaic file \"{}\" is not north-up", rPath));
+
+    auto pRasterBand = pDataset->GetRasterBand(1);
+    const glm::u32vec2 size{pDataset->GetRasterXSize(), pDataset->GetRasterYSize()};
+    return FileHeader{
+        .origin = glm::dvec2{geoTransform[0], geoTransform[3]},
+        .pixelSize = glm::dvec2{geoTransform[1], -geoTransform[5]},
+        .size = size,
+        .heightRange = readFileHeightRange(*pRasterBand),
+        .lodCount = calculateFileLodCount(*pRasterBand, size),
+    };
+}
+
+auto readFileHeaders(const vector<filesystem::path>& rPaths)
+{
+    // Required to silence warnings from LidarBC files, see createGdalDataset in gdal_geotiff_height_map.cpp:
+    CPLSetConfigOption("GTIFF_SRS_SOURCE", "GEOKEYS");
+
+    // Headers are independent from each other: read them in parallel since mosaics can have thousands of files.
+    vector<FileHeader> headers(rPaths.size());
+    mutex exceptionMutex;
+    exception_ptr pFirstException;
+    {
+        ThreadPool threadPool;
+        for (size_t i = 0U; i < rPaths.size(); i++)
+        {
+            threadPool.submit([&, i] {
+                try
+                {
+                    headers[i] = readFileHeader(rPaths[i]);
+                }
+                catch (...)
+                {
+                    lock_guard lk(exceptionMutex);
+                    pFirstException = pFirstException ? pFirstException : current_exception();
+                }
+            });
+        }
+        threadPool.waitIdle();
+    }
+    if (pFirstException)
+    {
+        rethrow_exception(pFirstException);
+    }
+    return headers;
+}
+
+auto loadFileInfos(const ILogger& rLogger, const filesystem::path& rPath)
+{
+    const auto paths = listMosaicFiles(rPath);
+    rLogger.info(fmt::format("Reading headers of {} files", paths.size()));
+    const auto headers = readFileHeaders(paths);
+
+    // Files are placed relative to the top-left corner of the mosaic, on the sample grid of the first file:
+    const auto pixelSize = headers.front().pixelSize;
+    glm::dvec2 topLeft = headers.front().origin;
+    for (size_t i = 0U; i < headers.size(); i++)
+    {
+        const auto& rHeader = headers[i];
+        throwIfFalse<runtime_error>(glm::all(glm::lessThan(glm::abs(rHeader.pixelSize - pixelSize), pixelSize * 1e-6)),
+                                    fmt::format("Mosaic file \"{}\" has a different resolution than \"{}\"", paths[i],
+                                                paths.front()));
+        topLeft = glm::dvec2{min(topLeft.x, rHeader.origin.x), max(topLeft.y, rHeader.origin.y)};
+    }
+
+    vector<GdalMosaicHeightMap::FileInfo> fileInfos;
+    fileInfos.reserve(paths.size());
+    for (size_t i = 0U; i < headers.size(); i++)
+    {
+        const auto& rHeader = headers[i];
+        const auto offset = glm::round(glm::dvec2{rHeader.origin.x - topLeft.x, topLeft.y - rHeader.origin.y} /
+                                       pixelSize);
+        fileInfos.emplace_back(GdalMosaicHeightMap::FileInfo{
+            .path = paths[i],
+            .footprint = HeightMapMosaicFootprint{.offset = glm::u32vec2{offset}, .size = rHeader.size},
+            .heightRange = rHeader.heightRange,
+            .lodCount = rHeader.lodCount,
+        });
+    }
+    return fileInfos;
+}
+
+auto createIndex(const vector<GdalMosaicHeightMap::FileInfo>& rFileInfos)
+{
+    vector<HeightMapMosaicFootprint> footprints;
+    footprints.reserve(rFileInfos.size());
+    for (const auto& rFileInfo : rFileInfos)
+    {
+        footprints.emplace_back(rFileInfo.footprint);
+    }
+
+    // Cells the size of the first file: files of a mosaic usually share the same size, so that each file overlaps a
+    // handful of cells.
+    return HeightMapMosaicIndex(move(footprints), rFileInfos.front().footprint.size);
+}
+
+auto calculateLodCount(const glm::u32vec2& rSize, const glm::u32vec2& rTileSize)
+{
+    // Same levels as GdalGeoTiffHeightMap::rebuildPyramid: halved until fitting in a single tile.
+    uint32_t lodCount = 1U;
+    for (auto size = rSize; size.x > rTileSize.x || size.y > rTileSize.y; size = (size + 1U) / 2U)
+    {
+        lodCount++;
+    }
+    return lodCount;
+}
+
+auto calculateServedLodCount(const vector<GdalMosaicHeightMap::FileInfo>& rFileInfos)
+{
+    auto lodCount = numeric_limits<uint32_t>::max();
+    for (const auto& rFileInfo : rFileInfos)
+    {
+        lodCount = min(lodCount, rFileInfo.lodCount);
+    }
+    return lodCount;
+}
+
+auto calculateHeightRange(const vector<GdalMosaicHeightMap::FileInfo>& rFileInfos)
+{
+    auto heightRange = EmptyHeightRange;
+    for (const auto& rFileInfo : rFileInfos)
+    {
+        heightRange.x = min(heightRange.x, rFileInfo.heightRange.x);
+        heightRange.y = max(heightRange.y, rFileInfo.heightRange.y);
+    }
+    return heightRange;
+}
+
+}  // namespace
+
+GdalMosaicHeightMap::GdalMosaicHeightMap(const ILogger& rLogger, HeightMapFileConfig config)
+  : m_pLogger(rLogger.createChild(getMosaicName(config.path)))
+  , m_config(move(config))
+  , m_name(getMosaicName(m_config.path))
+  , m_pGdalInstance(getGdalInstance(rLogger))
+  , m_fileInfos(loadFileInfos(*m_pLogger, m_config.path))
+  , m_index(createIndex(m_fileInfos))
+  , m_tileSize(MosaicTileSize)
+  , m_lodCount(min(calculateLodCount(m_index.getSize(), m_tileSize), calculateServedLodCount(m_fileInfos)))
+  , m_heightRange(calculateHeightRange(m_fileInfos))
+  , m_tileCache(m_name, m_config.tileCacheByteBudget, m_config.pStatsProvider)
+{
+    const auto size = m_index.getSize();
+    if (const auto pyramidLodCount = calculateLodCount(size, m_tileSize); m_lodCount < pyramidLodCount)
+    {
+        const auto limitingFileCount = ranges::count_if(m_fileInfos, [&](auto& rFileInfo) {
+            return rFileInfo.lodCount == m_lodCount;
+        });
+        m_pLogger->warning(fmt::format("Mosaic limited to {} levels of details instead of {}: {} files do not have "
+                                       "enough overviews, build them to display the whole mosaic",
+                                       m_lodCount, pyramidLodCount, limitingFileCount));
+    }
+    m_pLogger->info(fmt::format("Successfully loaded mosaic of {} files: {}x{} samples, {} levels of details",
+                                m_fileInfos.size(), size.x, size.y, m_lodCount));
+}
+
+void GdalMosaicHeightMap::rebuildPyramid()
+{
+    throw logic_error("Cannot rebuild pyramid of a mosaic, rebuild the pyramid of each of its files instead");
+}
+
+auto GdalMosaicHeightMap::getTileSampler(const TileID& rTileID) -> unique_ptr<IHeightMapTileSampler>
+{
+    throwIfFalse<invalid_argument>(rTileID.z < m_lodCount,
+                                   fmt::format("Invalid input LOD: {} > max {}", rTileID.z, m_lodCount));
+    const auto tileCount = this->getTileCount(rTileID.z);
+    throwIfFalse<out_of_range>(rTileID.x < tileCount.x && rTileID.y < tileCount.y,
+                               fmt::format("Invalid tile ({}; {}; {})", rTileID.x, rTileID.y, rTileID.z));
+
+    auto pTile = m_tileCache.getOrLoad(rTileID, [&] { return this->loadTile(rTileID); });
+    return make_unique<HeightMapTileSampler>(move(pTile));
+}
+
+auto GdalMosaicHeightMap::getTileSampler(const glm::u32vec2& rTilePos, uint32_t lod)
+    -> unique_ptr<IHeightMapTileSampler>
+{
+    return this->getTileSampler(TileID{rTilePos.x, rTilePos.y, lod});
+}
+
+auto GdalMosaicHeightMap::getTileCount(uint32_t lod) const -> glm::u32vec2
+{
+    throwIfFalse<invalid_argument>(lod < m_lodCount, fmt::format("Invalid input LOD: {} > max {}", lod, m_lodCount));
+    const auto scale = 1U << lod;
+    const auto lodSize = (m_index.getSize() + scale - 1U) / scale;
+    return (lodSize + m_tileSize - 1U) / m_tileSize;
+}
+
+auto GdalMosaicHeightMap::getTileHeightRange(const TileID& rTileID) const -> glm::vec2
+{
+    // Merged from the height ranges of the files covering the tile, the samples of the tile are not read:
+    const auto scale = 1U << rTileID.z;
+    const auto regionOffset = glm::u32vec2{rTileID.xy()} * m_tileSize * scale;
+    const auto regionEnd = glm::min(regionOffset + m_tileSize * scale, m_index.getSize());
+    if (glm::any(glm::greaterThanEqual(regionOffset, regionEnd)))
+    {
+        return EmptyHeightRange;
+    }
+
+    auto heightRange = EmptyHeightRange;
+    for (const auto fileIndex : m_index.findIntersecting(regionOffset, regionEnd - regionOffset))
+    {
+        const auto& rFileHeightRange = m_fileInfos[fileIndex].heightRange;
+        heightRange = glm::vec2{min(heightRange.x, rFileHeightRange.x), max(heightRange.y, rFileHeightRange.y)};
+    }
+    return heightRange;
+}
+
+auto GdalMosaicHeightMap::getOpenFileCount() const -> uint32_t
+{
+    lock_guard lk(m_openFileMutex);
+    return static_cast<uint32_t>(m_openFiles.size());
+}
+
+auto GdalMosaicHeightMap::openFile(uint32_t index) -> shared_ptr<GdalDatasetPool>
+{
+    lock_guard lk(m_openFileMutex);
+    if (auto itFind = m_openFiles.find(index); itFind != m_openFiles.end())
+    {
+        auto& [rpDatasetPool, itRecentUse] = itFind->second;
+        m_openFileIndicesByRecentUse.splice(m_openFileIndicesByRecentUse.begin(), m_openFileIndicesByRecentUse,
+                                            itRecentUse);
+        return rpDatasetPool;
+    }
+
+    // Datasets of closed files still in use are kept alive by their readers until released:
+    const auto maxOpenFileCount = max(m_config.maxOpenFileCount, 1U);
+    while (m_openFiles.size() >= maxOpenFileCount)
+    {
+        m_openFiles.erase(m_openFileIndicesByRecentUse.back());
+        m_openFileIndicesByRecentUse.pop_back();
+    }
+
+    // Datasets are opened on first use, outside of the lock:
+    auto pDatasetPool = make_shared<GdalDatasetPool>(
+        [&rPath = m_fileInfos[index].path] {
+            GDALDatasetUniquePtr pDataset(GDALDataset::FromHandle(GDALOpen(rPath.c_str(), GA_ReadOnly)));
+            throwIfNull<runtime_error>(pDataset, fmt::format("Failed to open mosaic file \"{}\"", rPath));
+            return pDataset;
+        },
+        m_config.maxConcurrentReadCount);
+    m_openFileIndicesByRecentUse.emplace_front(index);
+    m_openFiles[index] = make_pair(pDatasetPool, m_openFileIndicesByRecentUse.begin());
+    return pDatasetPool;
+}
+
+auto GdalMosaicHeightMap::loadTile(const TileID& rTileID) -> HeightMapTile
+{
+    const auto scale = 1U << rTileID.z;
+    const auto lodSize = (m_index.getSize() + scale - 1U) / scale;
+    const auto tileOrigin = glm::u32vec2{rTileID.xy()} * m_tileSize;
+
+    HeightMapTile tile{
+        .tileID = rTileID,
+        .size = m_tileSize,
+        .actualSize = glm::min(m_tileSize, lodSize - tileOrigin),
+        .scale = static_cast<float>(scale),
+        .heights = vector<float>(static_cast<size_t>(m_tileSize.x) * m_tileSize.y),
+        .mask = vector<uint8_t>(static_cast<size_t>(m_tileSize.x) * m_tileSize.y),
+    };
+
+    // Region of the tile in samples of the highest level of details:
+    const auto regionOffset = tileOrigin * scale;
+    const auto regionEnd = glm::min(regionOffset + tile.actualSize * scale, m_index.getSize());
+
+    for (const auto fileIndex : m_index.findIntersecting(regionOffset, regionEnd - regionOffset))
+    {
+        const auto& rFootprint = m_fileInfos[fileIndex].footprint;
+        const auto srcBegin = glm::max(regionOffset, rFootprint.offset);
+        const auto srcEnd = glm::min(regionEnd, rFootprint.offset + rFootprint.size);
+
+        // Samples of the tile covered by the file, rounded outwards so that samples on file boundaries are filled:
+        const auto dstBegin = (srcBegin - regionOffset) / scale;
+        const auto dstEnd = glm::min((srcEnd - regionOffset + scale - 1U) / scale, tile.actualSize);
+        const auto dstSize = dstEnd - dstBegin;
+        const auto srcSize = srcEnd - srcBegin;
+        const auto srcOffset = srcBegin - rFootprint.offset;
+
+        vector<float> heights(static_cast<size_t>(dstSize.x) * dstSize.y);
+        vector<uint8_t> mask(heights.size());
+        {
+            // The pool is held until the dataset is released, even if the file is closed by another thread meanwhile:
+            const auto pDatasetPool = this->openFile(fileIndex);
+            const auto pDataset = pDatasetPool->acquire();
+            auto pRasterBand = pDataset->GetRasterBand(1);
+
+            // GDAL reads from the overviews of the file when the destination is smaller than the source region. The
+            // mask is averaged as the heights, which skip invalid samples: samples are valid if any source is.
+            GDALRasterIOExtraArg extraArg;
+            INIT_RASTERIO_EXTRA_ARG(extraArg);
+            extraArg.eResampleAlg = GRIORA_Average;
+            auto readCode = pRasterBand->RasterIO(GF_Read, srcOffset.x, srcOffset.y, srcSize.x, srcSize.y,
+                                                  heights.data(), dstSize.x, dstSize.y, GDT_Float32, 0, 0, &extraArg);
+            if (readCode == CE_None)
+            {
+                readCode = pRasterBand->GetMaskBand()->RasterIO(GF_Read, srcOffset.x, srcOffset.y, srcSize.x,
+                                                                srcSize.y, mask.data(), dstSize.x, dstSize.y,
+                                                                GDT_Byte, 0, 0, &extraArg);
+            }
+            throwIfFalse<runtime_error>(readCode == CE_None,
+                                        fmt::format("Failed to read mosaic file \"{}\"", m_fileInfos[fileIndex].path));
+        }
+
+        // Files are merged in order, valid samples of a file overwriting the samples of the files before it:
+        for (uint32_t y = 0U; y < dstSize.y; y++)
+        {
+            for (uint32_t x = 0U; x < dstSize.x; x++)
+            {
+                const auto srcIndex = static_cast<size_t>(y) * dstSize.x + x;
+                if (mask[srcIndex] != 0U)
+                {
+                    const auto dstIndex = static_cast<size_t>(dstBegin.y + y) * m_tileSize.x + dstBegin.x + x;
+                    tile.heights[dstIndex] = heights[srcIndex];
+                    tile.mask[dstIndex] = 255U;
+                }
+            }
+        }
+    }
+    return tile;
+}
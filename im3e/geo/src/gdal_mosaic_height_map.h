@@ -0,0 +1,89 @@
+#pragma once
+
+#include "gdal_dataset_pool.h"
+#include "gdal_instance.h"
+#include "geo.h"
+#include "height_map_mosaic_index.h"
+#include "height_map_tile_cache.h"
+
+#include <im3e/api/height_map.h>
+#include <im3e/utils/loggers.h>
+
+#include <gdal_priv.h>
+
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace im3e {
+
+/// @brief Height map made of many GeoTIFF files sharing the same resolution, seen as a single virtual raster.
+/// Only the headers of the files are read when loading the mosaic. Files are opened when a tile covering them is first
+/// loaded and kept open up to HeightMapFileConfig::maxOpenFileCount, each file having its own pool of datasets so that
+/// tiles are read concurrently. Tiles of lower levels of details are read from the overviews of the files, the levels
+/// of details of the mosaic being limited to the ones that all files serve from their overviews. Height ranges of the
+/// tiles are merged from the height ranges of the files covering them.
+class GdalMosaicHeightMap : public IHeightMap
+{
+public:
+    GdalMosaicHeightMap(const ILogger& rLogger, HeightMapFileConfig config);
+
+    /// @brief Not supported: the pyramid of each file of the mosaic is rebuilt separately.
+    void rebuildPyramid() override;
+
+    auto getTileSampler(const TileID& rTileID) -> std::unique_ptr<IHeightMapTileSampler> override;
+    auto getTileSampler(const glm::u32vec2& rTilePos, uint32_t lod) -> std::unique_ptr<IHeightMapTileSampler> override;
+
+    auto getName() const -> std::string override { return m_name; }
+    auto getSize() const -> glm::u32vec2 override { return m_index.getSize(); }
+    auto getTileSize() const -> glm::u32vec2 override { return m_tileSize; }
+    auto getTileCount(uint32_t lod) const -> glm::u32vec2 override;
+    auto getLodCount() const -> uint32_t override { return m_lodCount; }
+    auto getMinHeight() const -> float override { return m_heightRange.x; }
+    auto getMaxHeight() const -> float override { return m_heightRange.y; }
+    auto getTileHeightRange(const TileID& rTileID) const -> glm::vec2 override;
+
+    auto getFileCount() const -> uint32_t { return m_index.getFootprintCount(); }
+    auto getOpenFileCount() const -> uint32_t;
+
+    /// @brief Description of a file of the mosaic, read from its header.
+    struct FileInfo
+    {
+        std::filesystem::path path;
+        HeightMapMosaicFootprint footprint;
+        glm::vec2 heightRange;
+
+        /// @brief Number of levels of details read without going through more than 2x2 samples of the file or of its
+        /// overviews per sample.
+        uint32_t lodCount;
+    };
+
+private:
+    auto loadTile(const TileID& rTileID) -> HeightMapTile;
+    auto openFile(uint32_t index) -> std::shared_ptr<GdalDatasetPool>;
+
+    std::unique_ptr<ILogger> m_pLogger;
+    const HeightMapFileConfig m_config;
+    const std::string m_name;
+
+    std::shared_ptr<IGdalInstance> m_pGdalInstance;
+    const std::vector<FileInfo> m_fileInfos;
+    const HeightMapMosaicIndex m_index;
+
+    const glm::u32vec2 m_tileSize;
+    const uint32_t m_lodCount;
+    const glm::vec2 m_heightRange;
+
+    // Guards the list of open files only, reads go through the dataset pools of the files without holding it:
+    mutable std::mutex m_openFileMutex;
+    std::list<uint32_t> m_openFileIndicesByRecentUse;
+    std::unordered_map<uint32_t, std::pair<std::shared_ptr<GdalDatasetPool>, std::list<uint32_t>::iterator>>
+        m_openFiles;
+
+    HeightMapTileCache m_tileCache;
+};
+
+}  // namespace im3e
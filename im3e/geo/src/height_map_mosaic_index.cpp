@@ -0,0 +1,81 @@
+#include "height_map_mosaic_index.h"
+
+#include <algorithm>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+auto calculateMosaicSize(const vector<HeightMapMosaicFootprint>& rFootprints)
+{
+    glm::u32vec2 size{};
+    for (const auto& rFootprint : rFootprints)
+    {
+        size = glm::max(size, rFootprint.offset + rFootprint.size);
+    }
+    return size;
+}
+
+}  // namespace
+
+HeightMapMosaicIndex::HeightMapMosaicIndex(vector<HeightMapMosaicFootprint> footprints, const glm::u32vec2& rCellSize)
+  : m_footprints(move(footprints))
+  , m_size(calculateMosaicSize(m_footprints))
+  , m_cellSize(glm::max(rCellSize, glm::u32vec2{1U}))
+  , m_cellCount((m_size + m_cellSize - 1U) / m_cellSize)
+  , m_cells(static_cast<size_t>(m_cellCount.x) * m_cellCount.y)
+{
+    for (uint32_t index = 0U; index < m_footprints.size(); index++)
+    {
+        const auto& rFootprint = m_footprints[index];
+        if (rFootprint.size.x == 0U || rFootprint.size.y == 0U)
+        {
+            continue;
+        }
+        const auto firstCell = rFootprint.offset / m_cellSize;
+        const auto lastCell = (rFootprint.offset + rFootprint.size - 1U) / m_cellSize;
+        for (uint32_t y = firstCell.y; y <= lastCell.y; y++)
+        {
+            for (uint32_t x = firstCell.x; x <= lastCell.x; x++)
+            {
+                m_cells[static_cast<size_t>(y) * m_cellCount.x + x].emplace_back(index);
+            }
+        }
+    }
+}
+
+auto HeightMapMosaicIndex::findIntersecting(const glm::u32vec2& rOffset, const glm::u32vec2& rSize) const
+    -> vector<uint32_t>
+{
+    vector<uint32_t> indices;
+    const auto end = glm::min(rOffset + rSize, m_size);
+    if (rSize.x == 0U || rSize.y == 0U || rOffset.x >= end.x || rOffset.y >= end.y)
+    {
+        return indices;
+    }
+
+    const auto firstCell = rOffset / m_cellSize;
+    const auto lastCell = (end - 1U) / m_cellSize;
+    for (uint32_t y = firstCell.y; y <= lastCell.y; y++)
+    {
+        for (uint32_t x = firstCell.x; x <= lastCell.x; x++)
+        {
+            for (const auto index : m_cells[static_cast<size_t>(y) * m_cellCount.x + x])
+            {
+                // Cells are coarser than footprints, only keep the footprints that actually intersect the region:
+                const auto& rFootprint = m_footprints[index];
+                const auto footprintEnd = rFootprint.offset + rFootprint.size;
+                if (glm::all(glm::lessThan(rFootprint.offset, end)) && glm::all(glm::lessThan(rOffset, footprintEnd)))
+                {
+                    indices.emplace_back(index);
+                }
+            }
+        }
+    }
+
+    // Footprints spanning several cells are found once per cell:
+    ranges::sort(indices);
+    indices.erase(unique(indices.begin(), indices.end()), indices.end());
+    return indices;
+}
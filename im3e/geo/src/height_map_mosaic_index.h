@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace im3e {
+
+/// @brief Region covered by a file of a mosaic, in samples of the highest level of details of the mosaic.
+struct HeightMapMosaicFootprint
+{
+    glm::u32vec2 offset;
+    glm::u32vec2 size;
+};
+
+/// @brief Grid index of the footprints of the files of a mosaic.
+/// Each cell of the grid lists the footprints overlapping it, so that finding the files covering a region only
+/// inspects the cells of that region instead of every file of the mosaic.
+class HeightMapMosaicIndex
+{
+public:
+    HeightMapMosaicIndex(std::vector<HeightMapMosaicFootprint> footprints, const glm::u32vec2& rCellSize);
+
+    /// @brief Find the footprints intersecting the given region.
+    /// @return Indices of the intersecting footprints, in increasing order.
+    auto findIntersecting(const glm::u32vec2& rOffset, const glm::u32vec2& rSize) const -> std::vector<uint32_t>;
+
+    auto getFootprint(uint32_t index) const -> const HeightMapMosaicFootprint& { return m_footprints[index]; }
+    auto getFootprintCount() const -> uint32_t { return static_cast<uint32_t>(m_footprints.size()); }
+
+    /// @brief Size of the region covering all footprints, starting at (0; 0).
+    auto getSize() const -> const glm::u32vec2& { return m_size; }
+
+private:
+    const std::vector<HeightMapMosaicFootprint> m_footprints;
+    const glm::u32vec2 m_size;
+
+    const glm::u32vec2 m_cellSize;
+    const glm::u32vec2 m_cellCount;
+    std::vector<std::vector<uint32_t>> m_cells;
+};
+
+}  // namespace im3e
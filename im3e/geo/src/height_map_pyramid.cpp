@@ -0,0 +1,65 @@
+#include "height_map_pyramid.h"
+
+#include <vector>
+
+using namespace im3e;
+
+namespace {
+
+/// @brief Replace invalid heights by 0 and convert the mask to weights of 0 or 1.
+/// Kept as separate loops since GCC only vectorizes them individually.
+void prepareRow(const float* __restrict pHeights, const uint8_t* __restrict pMask, float* __restrict pValidHeights,
+                float* __restrict pWeights, uint32_t size)
+{
+    for (uint32_t x = 0U; x < size; x++)
+    {
+        // Invalid samples may hold any value including NaN: select them out rather than multiplying them by 0.
+        const float height = pHeights[x];
+        pValidHeights[x] = pMask[x] ? height : 0.0F;
+    }
+    for (uint32_t x = 0U; x < size; x++)
+    {
+        pWeights[x] = static_cast<float>(pMask[x] != 0U);
+    }
+}
+
+void downsampleRow(const float* __restrict pValidHeights0, const float* __restrict pValidHeights1,
+                   const float* __restrict pWeights0, const float* __restrict pWeights1, float* __restrict pDstHeights,
+                   uint8_t* __restrict pDstMask, uint32_t dstSize)
+{
+    for (uint32_t x = 0U; x < dstSize; x++)
+    {
+        const auto srcX = 2U * x;
+        const float sum = pValidHeights0[srcX] + pValidHeights0[srcX + 1U] + pValidHeights1[srcX] +
+                          pValidHeights1[srcX + 1U];
+        const auto count = static_cast<uint32_t>(pWeights0[srcX] + pWeights0[srcX + 1U] + pWeights1[srcX] +
+                                                 pWeights1[srcX + 1U]);
+
+        // Integer selects: floating-point comparisons prevent vectorization with the default trapping math.
+        pDstHeights[x] = sum / static_cast<float>(count | static_cast<uint32_t>(count == 0U));
+        pDstMask[x] = static_cast<uint8_t>(count ? 255U : 0U);
+    }
+}
+
+}  // namespace
+
+void im3e::downsampleHeights(const float* pSrcHeights, const uint8_t* pSrcMask, uint32_t srcStride, float* pDstHeights,
+                             uint8_t* pDstMask, const glm::u32vec2& rDstSize)
+{
+    const auto srcRowSize = 2U * rDstSize.x;
+    std::vector<float> rows(4U * srcRowSize);
+    auto pValidHeights0 = rows.data();
+    auto pValidHeights1 = pValidHeights0 + srcRowSize;
+    auto pWeights0 = pValidHeights1 + srcRowSize;
+    auto pWeights1 = pWeights0 + srcRowSize;
+
+    for (uint32_t y = 0U; y < rDstSize.y; y++)
+    {
+        const auto srcRowOffset = 2U * y * srcStride;
+        prepareRow(pSrcHeights + srcRowOffset, pSrcMask + srcRowOffset, pValidHeights0, pWeights0, srcRowSize);
+        prepareRow(pSrcHeights + srcRowOffset + srcStride, pSrcMask + srcRowOffset + srcStride, pValidHeights1,
+                   pWeights1, srcRowSize);
+        downsampleRow(pValidHeights0, pValidHeights1, pWeights0, pWeights1, pDstHeights + y * rDstSize.x,
+                      pDstMask + y * rDstSize.x, rDstSize.x);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+namespace im3e {
+
+/// @brief Downsample heights by a factor of 2, averaging the valid samples of each 2x2 block.
+/// A destination sample is valid if at least one sample of its source block is valid. Invalid destination samples are
+/// set to 0. Rows are processed with branchless loops that the compiler vectorizes.
+/// @param[in] pSrcHeights Source heights, 2 * rDstSize samples stored row by row with srcStride samples per row
+/// @param[in] pSrcMask Source mask with the same layout as the source heights, 0 meaning invalid
+/// @param[in] srcStride Number of samples between the start of two consecutive source rows
+/// @param[out] pDstHeights Destination heights, rDstSize samples stored row by row with rDstSize.x samples per row
+/// @param[out] pDstMask Destination mask with the same layout as the destination heights, set to 0 or 255
+/// @param[in] rDstSize Size of the destination
+void downsampleHeights(const float* pSrcHeights, const uint8_t* pSrcMask, uint32_t srcStride, float* pDstHeights,
+                       uint8_t* pDstMask, const glm::u32vec2& rDstSize);
+
+}  // namespace im3e
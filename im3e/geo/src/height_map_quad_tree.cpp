@@ -1,7 +1,11 @@
 #include "geo.h"
+#include "height_map_tile_ranges.h"
 
 #include <im3e/utils/core/throw_utils.h>
 
+#include <algorithm>
+#include <queue>
+
 using namespace im3e;
 
 namespace {
@@ -14,90 +18,311 @@ auto calculateLodCount(const glm::u32vec2& rSize, const glm::u32vec2& rTileSize)
     return static_cast<uint32_t>(downsampleCount) + 1U;  // add 1 to account for the base level
 }
 
-auto generateTreeNodeChildren(HeightMapQuadTreeNode& rParentNode, const glm::vec3& rParentTileWorldSize)
+constexpr uint32_t ChildCount = 4U;
+
+struct TileSelectionCandidate
+{
+    float screenSpaceError;
+    uint32_t index;
+
+    auto operator<(const TileSelectionCandidate& rOther) const { return screenSpaceError < rOther.screenSpaceError; }
+};
+
+}  // namespace
+
+HeightMapQuadTree::HeightMapQuadTree(const IHeightMap& rHeightMap)
+  : m_heightMapLodCount(std::max(rHeightMap.getLodCount(), 1U))
 {
-    if (rParentNode.tileID.z == 0U)
+    const auto size = rHeightMap.getSize();
+    const auto tileSize = rHeightMap.getTileSize();
+    const auto lodCount = calculateLodCount(size, tileSize);
+
+    // Tiles of a level of details cover twice the world size of the tiles of the level below:
+    std::vector<glm::vec2> tileWorldSizes(lodCount);
+    tileWorldSizes[lodCount - 1U] = glm::vec2{tileSize} * static_cast<float>(std::pow(2U, lodCount - 1U));
+    for (uint32_t lod = lodCount - 1U; lod > 0U; lod--)
     {
-        return;
+        tileWorldSizes[lod - 1U] = glm::ceil(tileWorldSizes[lod] / 2.0F);
     }
-    const auto childLod = rParentNode.tileID.z - 1U;
-    const auto childTileWorldSize = glm::vec3{glm::ceil(rParentTileWorldSize.x / 2.0F), rParentTileWorldSize.y,
-                                              glm::ceil(rParentTileWorldSize.z / 2.0F)};
 
-    for (uint16_t y = 0U; y < 2U; y++)
+    auto addNode = [this](const TileID& rTileID, const glm::vec3& rMinWorldPos, const glm::vec3& rMaxWorldPos) {
+        m_tileIDs.emplace_back(rTileID);
+        m_firstChildIndices.emplace_back(0U);
+        for (uint32_t axis = 0U; axis < 3U; axis++)
+        {
+            m_minWorldPos[axis].emplace_back(rMinWorldPos[axis]);
+            m_maxWorldPos[axis].emplace_back(rMaxWorldPos[axis]);
+        }
+    };
+    const TileID rootTileID{0U, 0U, lodCount - 1U};
+    const auto rootHeightRange = (rootTileID.z == 0U) ? rHeightMap.getTileHeightRange(rootTileID) : EmptyHeightRange;
+    addNode(rootTileID, glm::vec3{0.0F, rootHeightRange.x, 0.0F}, glm::vec3{size.x, rootHeightRange.y, size.y});
+
+    // Nodes are added level after level: the children of a node are always added after the node itself.
+    for (uint32_t parentIndex = 0U; parentIndex < m_tileIDs.size(); parentIndex++)
     {
-        for (uint16_t x = 0U; x < 2U; x++)
+        const auto parentTileID = m_tileIDs[parentIndex];
+        const auto parentNode = this->getNode(parentIndex);
+        if (parentTileID.z == 0U || parentNode.maxWorldPos.x <= parentNode.minWorldPos.x)
+        {
+            // Tiles of the highest level of details and children outside of the height map have no children:
+            continue;
+        }
+
+        const auto childLod = parentTileID.z - 1U;
+        const auto childTileWorldSize = glm::vec3{tileWorldSizes[childLod].x, 0.0F, tileWorldSizes[childLod].y};
+        m_firstChildIndices[parentIndex] = this->getNodeCount();
+        for (uint16_t y = 0U; y < 2U; y++)
         {
-            const auto childMinWorldPos = rParentNode.minWorldPos + glm::vec3{x, 0.0F, y} * childTileWorldSize;
-            const auto childMaxWorldPos = glm::min(childMinWorldPos + childTileWorldSize, rParentNode.maxWorldPos);
-            if (childMaxWorldPos.x <= childMinWorldPos.x || childMaxWorldPos.z <= childMinWorldPos.z)
+            for (uint16_t x = 0U; x < 2U; x++)
             {
-                // If the child world size is negative, this means that this child tile is outside of the boundaries
-                // of the parent. It should therefore be skipped:
-                continue;
+                const TileID childTileID{uint16_t{2U} * parentTileID.xy() + glm::u16vec2{x, y}, childLod};
+                const auto childMinWorldPos = parentNode.minWorldPos + glm::vec3{x, 0.0F, y} * childTileWorldSize;
+                const auto childMaxWorldPos = glm::min(childMinWorldPos + childTileWorldSize, parentNode.maxWorldPos);
+                if (childMaxWorldPos.x <= childMinWorldPos.x || childMaxWorldPos.z <= childMinWorldPos.z)
+                {
+                    // If the child world size is negative, this means that this child tile is outside of the
+                    // boundaries of the parent. It is kept as an empty node so that children stay grouped by 4:
+                    addNode(childTileID, glm::vec3{childMinWorldPos.x, EmptyHeightRange.x, childMinWorldPos.z},
+                            glm::vec3{childMinWorldPos.x, EmptyHeightRange.y, childMinWorldPos.z});
+                    continue;
+                }
+
+                const auto heightRange = (childLod == 0U) ? rHeightMap.getTileHeightRange(childTileID)
+                                                          : EmptyHeightRange;
+                addNode(childTileID, glm::vec3{childMinWorldPos.x, heightRange.x, childMinWorldPos.z},
+                        glm::vec3{childMaxWorldPos.x, heightRange.y, childMaxWorldPos.z});
             }
+        }
+    }
 
-            auto pChildNode = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-                .tileID = TileID{uint16_t{2U} * rParentNode.tileID.xy() + glm::u16vec2{x, y}, childLod},
-                .minWorldPos = childMinWorldPos,
-                .maxWorldPos = childMaxWorldPos,
-            });
-            rParentNode.pChildren[y * 2U + x] = pChildNode;
-            generateTreeNodeChildren(*pChildNode, childTileWorldSize);
+    // Bound every node as tightly as its children, whose heights are known from the tiles of the highest level of
+    // details. Tiles of lower levels of details are downsampled from them and cannot exceed their range. Children are
+    // stored after their parent, so iterating backwards merges children before their own parent is merged.
+    auto& rMinHeights = m_minWorldPos[1U];
+    auto& rMaxHeights = m_maxWorldPos[1U];
+    for (auto index = this->getNodeCount(); index-- > 0U;)
+    {
+        const auto firstChildIndex = m_firstChildIndices[index];
+        if (firstChildIndex == 0U)
+        {
+            continue;
+        }
+        auto heightRange = EmptyHeightRange;
+        for (uint32_t childIndex = firstChildIndex; childIndex < firstChildIndex + ChildCount; childIndex++)
+        {
+            heightRange.x = std::min(heightRange.x, rMinHeights[childIndex]);
+            heightRange.y = std::max(heightRange.y, rMaxHeights[childIndex]);
         }
+        rMinHeights[index] = heightRange.x;
+        rMaxHeights[index] = heightRange.y;
     }
 }
 
-void findVisibleInQuadTree(const HeightMapQuadTreeNode& rNode, const ViewFrustum& rViewFrustum, uint32_t lod,
-                           std::vector<TileID>& rVisibleTileIDs)
+auto HeightMapQuadTree::getNode(uint32_t index) const -> HeightMapQuadTreeNode
 {
-    if (!rViewFrustum.isAABBInside(rNode.minWorldPos, rNode.maxWorldPos))
-    {
-        return;
-    }
+    return HeightMapQuadTreeNode{
+        .tileID = m_tileIDs[index],
+        .minWorldPos = glm::vec3{m_minWorldPos[0U][index], m_minWorldPos[1U][index], m_minWorldPos[2U][index]},
+        .maxWorldPos = glm::vec3{m_maxWorldPos[0U][index], m_maxWorldPos[1U][index], m_maxWorldPos[2U][index]},
+    };
+}
 
-    if (rNode.tileID.z == lod)
+void HeightMapQuadTree::cullChildren(const ViewFrustum& rViewFrustum, uint32_t firstChildIndex,
+                                     std::array<bool, 4U>& rChildrenVisible) const
+{
+    // Nodes without any valid sample have an empty height range and nothing to render:
+    for (uint32_t i = 0U; i < ChildCount; i++)
     {
-        rVisibleTileIDs.emplace_back(rNode.tileID);
-        return;
+        rChildrenVisible[i] = m_minWorldPos[1U][firstChildIndex + i] <= m_maxWorldPos[1U][firstChildIndex + i];
     }
 
-    for (auto& rpChild : rNode.pChildren)
+    // Same test as ViewFrustum::isAABBInside, on the 4 children at once. The corner of the AABBs furthest along the
+    // plane normal only depends on the plane, leaving the inner loop free of branches so that it is vectorized.
+    for (const auto& rPlane : rViewFrustum.getPlanes())
     {
-        if (rpChild)
+        const auto* pX = (rPlane.x >= 0.0F ? m_maxWorldPos[0U] : m_minWorldPos[0U]).data() + firstChildIndex;
+        const auto* pY = (rPlane.y >= 0.0F ? m_maxWorldPos[1U] : m_minWorldPos[1U]).data() + firstChildIndex;
+        const auto* pZ = (rPlane.z >= 0.0F ? m_maxWorldPos[2U] : m_minWorldPos[2U]).data() + firstChildIndex;
+        for (uint32_t i = 0U; i < ChildCount; i++)
         {
-            findVisibleInQuadTree(*rpChild, rViewFrustum, lod, rVisibleTileIDs);
+            const auto distance = rPlane.x * pX[i] + rPlane.y * pY[i] + rPlane.z * pZ[i] + rPlane.w;
+            rChildrenVisible[i] = rChildrenVisible[i] && distance >= 0.0F;
         }
     }
 }
 
-}  // namespace
-
-auto HeightMapQuadTreeNode::findVisible(const ViewFrustum& rViewFrustum, uint32_t lod) const -> std::vector<TileID>
+auto HeightMapQuadTree::findVisible(const ViewFrustum& rViewFrustum, uint32_t lod) const -> std::vector<TileID>
 {
+    const auto rootNode = this->getNode(0U);
     throwIfFalse<std::invalid_argument>(
-        lod <= this->tileID.z, fmt::format("Invalid lod {} passed to quad tree of max level {}", lod, this->tileID.z));
+        lod <= rootNode.tileID.z,
+        fmt::format("Invalid lod {} passed to quad tree of max level {}", lod, rootNode.tileID.z));
 
     std::vector<TileID> visibleTileIDs;
-    findVisibleInQuadTree(*this, rViewFrustum, lod, visibleTileIDs);
+    if (rootNode.minWorldPos.y > rootNode.maxWorldPos.y ||
+        !rViewFrustum.isAABBInside(rootNode.minWorldPos, rootNode.maxWorldPos))
+    {
+        return visibleTileIDs;
+    }
+    if (rootNode.tileID.z == lod)
+    {
+        visibleTileIDs.emplace_back(rootNode.tileID);
+        return visibleTileIDs;
+    }
+
+    // Depth-first traversal, children being pushed in reverse order so that tiles are returned in the same order as a
+    // recursive traversal. At most 3 siblings wait on the stack for each level of details.
+    std::vector<uint32_t> nodeIndexStack;
+    nodeIndexStack.reserve(3U * rootNode.tileID.z + 1U);
+    nodeIndexStack.emplace_back(0U);
+
+    std::array<bool, ChildCount> childrenVisible{};
+    while (!nodeIndexStack.empty())
+    {
+        const auto firstChildIndex = m_firstChildIndices[nodeIndexStack.back()];
+        nodeIndexStack.pop_back();
+
+        this->cullChildren(rViewFrustum, firstChildIndex, childrenVisible);
+        if (m_tileIDs[firstChildIndex].z == lod)
+        {
+            for (uint32_t i = 0U; i < ChildCount; i++)
+            {
+                if (childrenVisible[i])
+                {
+                    visibleTileIDs.emplace_back(m_tileIDs[firstChildIndex + i]);
+                }
+            }
+            continue;
+        }
+        for (uint32_t i = ChildCount; i-- > 0U;)
+        {
+            if (childrenVisible[i])
+            {
+                nodeIndexStack.emplace_back(firstChildIndex + i);
+            }
+        }
+    }
     return visibleTileIDs;
 }
 
-auto im3e::generateHeightMapQuadTree(const IHeightMap& rHeightMap) -> std::shared_ptr<HeightMapQuadTreeNode>
+auto HeightMapQuadTree::calculateScreenSpaceError(uint32_t index, const HeightMapTileSelectionConfig& rConfig) const
+    -> float
 {
-    const auto size = rHeightMap.getSize();
-    const auto tileSize = rHeightMap.getTileSize();
-    const auto lodCount = calculateLodCount(size, tileSize);
+    const auto lod = m_tileIDs[index].z;
+    if (lod == 0U)
+    {
+        return 0.0F;
+    }
+
+    // Tiles of a level of details have one sample every 2^lod samples of the highest level of details. The error of the
+    // missing samples is estimated as this spacing, and cannot exceed the height range of the tile:
+    const auto sampleSpacing = static_cast<float>(1U << lod);
+    const auto geometricError = std::min(sampleSpacing, m_maxWorldPos[1U][index] - m_minWorldPos[1U][index]);
+
+    // Distance from the camera to the closest point of the tile bounds:
+    glm::vec3 offset{};
+    for (uint32_t axis = 0U; axis < 3U; axis++)
+    {
+        offset[axis] = std::max({m_minWorldPos[axis][index] - rConfig.viewPosition[axis], 0.0F,
+                                 rConfig.viewPosition[axis] - m_maxWorldPos[axis][index]});
+    }
+    constexpr float MinDistance = 1.0e-3F;
+    const auto distance = std::max(glm::length(offset), MinDistance);
+    return geometricError * rConfig.projectionScale / distance;
+}
+
+auto HeightMapQuadTree::selectTiles(const ViewFrustum& rViewFrustum, const HeightMapTileSelectionConfig& rConfig) const
+    -> HeightMapTileSelection
+{
+    HeightMapTileSelection selection;
+    const auto rootNode = this->getNode(0U);
+    if (rConfig.maxTileCount == 0U || rootNode.minWorldPos.y > rootNode.maxWorldPos.y ||
+        !rViewFrustum.isAABBInside(rootNode.minWorldPos, rootNode.maxWorldPos))
+    {
+        return selection;
+    }
+
+    std::priority_queue<TileSelectionCandidate> candidates;
+    candidates.push(TileSelectionCandidate{this->calculateScreenSpaceError(0U, rConfig), 0U});
+
+    // Number of tiles selected or waiting for their children, and of children loaded in the background:
+    uint32_t tileCount = 1U;
+    std::vector<TileID> childTileIDs;
+
+    std::array<bool, ChildCount> childrenVisible{};
+    while (!candidates.empty())
+    {
+        const auto candidate = candidates.top();
+        candidates.pop();
+
+        const auto& rTileID = m_tileIDs[candidate.index];
+        const auto firstChildIndex = m_firstChildIndices[candidate.index];
+
+        // Tiles of levels of details missing from the height map cannot be loaded, only their children can:
+        const auto isTileLoadable = rTileID.z < m_heightMapLodCount;
+        if (firstChildIndex == 0U || (isTileLoadable && candidate.screenSpaceError <= rConfig.maxScreenSpaceError))
+        {
+            selection.tileIDs.emplace_back(rTileID);
+            continue;
+        }
+
+        this->cullChildren(rViewFrustum, firstChildIndex, childrenVisible);
+        const auto visibleChildCount = static_cast<uint32_t>(std::ranges::count(childrenVisible, true));
+        if (isTileLoadable && tileCount + visibleChildCount > rConfig.maxTileCount + 1U)
+        {
+            // Not enough budget left to refine this tile, tiles with less visible children may still be refined:
+            selection.tileIDs.emplace_back(rTileID);
+            continue;
+        }
+
+        bool childrenReady = true;
+        for (uint32_t i = 0U; i < ChildCount; i++)
+        {
+            const auto& rChildTileID = m_tileIDs[firstChildIndex + i];
+            childrenReady = childrenReady && (!childrenVisible[i] || rConfig.isTileReady(rChildTileID));
+        }
+
+        // Tiles that are not ready have nothing to display while their children load, they are refined right away:
+        if (!childrenReady && isTileLoadable && rConfig.isTileReady(rTileID))
+        {
+            // Keep displaying this tile while its children load, if there is enough budget left to load them:
+            selection.tileIDs.emplace_back(rTileID);
+            std::vector<TileID> missingChildTileIDs;
+            for (uint32_t i = 0U; i < ChildCount; i++)
+            {
+                if (childrenVisible[i] && !rConfig.isTileReady(m_tileIDs[firstChildIndex + i]))
+                {
+                    missingChildTileIDs.emplace_back(m_tileIDs[firstChildIndex + i]);
+                }
+            }
+            if (tileCount + missingChildTileIDs.size() <= rConfig.maxTileCount)
+            {
+                tileCount += static_cast<uint32_t>(missingChildTileIDs.size());
+                childTileIDs.insert(childTileIDs.end(), missingChildTileIDs.begin(), missingChildTileIDs.end());
+            }
+            continue;
+        }
 
-    auto pRoot = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-        .tileID = TileID{0U, 0U, lodCount - 1U},
-        .minWorldPos = glm::vec3{0.0F, rHeightMap.getMinHeight(), 0.0F},
-        .maxWorldPos = glm::vec3{size.x, rHeightMap.getMaxHeight(), size.y},
-    });
-
-    const auto tileSizeAtMaxLevel = glm::vec2{tileSize} * static_cast<float>(std::pow(2U, pRoot->tileID.z));
-    const auto tileWorldSize = glm::vec3{tileSizeAtMaxLevel.x, pRoot->maxWorldPos.y - pRoot->minWorldPos.y,
-                                         tileSizeAtMaxLevel.y};
-    generateTreeNodeChildren(*pRoot, tileWorldSize);
-    return pRoot;
-}
\ No newline at end of file
+        tileCount += visibleChildCount - 1U;
+        for (uint32_t i = 0U; i < ChildCount; i++)
+        {
+            if (childrenVisible[i])
+            {
+                const auto childIndex = firstChildIndex + i;
+                const auto childError = this->calculateScreenSpaceError(childIndex, rConfig);
+                candidates.push(TileSelectionCandidate{childError, childIndex});
+            }
+        }
+    }
+
+    for (const auto& rTileID : selection.tileIDs)
+    {
+        if (!rConfig.isTileReady(rTileID))
+        {
+            selection.missingTileIDs.emplace_back(rTileID);
+        }
+    }
+    selection.missingTileIDs.insert(selection.missingTileIDs.end(), childTileIDs.begin(), childTileIDs.end());
+    return selection;
+}
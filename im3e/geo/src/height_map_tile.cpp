@@ -0,0 +1,59 @@
+#include "height_map_tile.h"
+
+#include <im3e/utils/core/throw_utils.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+using namespace im3e;
+using namespace std;
+
+HeightMapTileSampler::HeightMapTileSampler(shared_ptr<const HeightMapTile> pTile)
+  : m_pTile(throwIfArgNull(move(pTile), "Height map tile sampler requires a tile"))
+  , m_pHeights(m_pTile->heights.data())
+  , m_pMask(m_pTile->mask.empty() ? nullptr : m_pTile->mask.data())
+{
+}
+
+void HeightMapTileSampler::copyRows(uint32_t firstRow, uint32_t rowCount, span<float> dst) const
+{
+    const auto& rSize = m_pTile->size;
+    checkCopyRowsArgs(rSize, firstRow, rowCount, dst.size());
+    copy_n(m_pHeights + firstRow * rSize.x, rowCount * rSize.x, dst.data());
+}
+
+void HeightMapTileSampler::copyMaskRows(uint32_t firstRow, uint32_t rowCount, span<uint8_t> dst) const
+{
+    const auto& rSize = m_pTile->size;
+    const auto& rActualSize = m_pTile->actualSize;
+    checkCopyRowsArgs(rSize, firstRow, rowCount, dst.size());
+
+    const auto pDst = dst.data();
+    fill_n(pDst, rowCount * rSize.x, uint8_t{});
+    if (!m_pMask)
+    {
+        return;
+    }
+
+    const auto validRowCount = min(firstRow + rowCount, rActualSize.y) - min(firstRow, rActualSize.y);
+    for (uint32_t row = 0U; row < validRowCount; row++)
+    {
+        const auto pSrcRow = m_pMask + (firstRow + row) * rSize.x;
+        const auto pDstRow = pDst + row * rSize.x;
+        for (uint32_t x = 0U; x < rActualSize.x; x++)
+        {
+            pDstRow[x] = static_cast<uint8_t>(pSrcRow[x] != 0U);
+        }
+    }
+}
+
+void im3e::checkCopyRowsArgs(const glm::u32vec2& rTileSize, uint32_t firstRow, uint32_t rowCount, size_t dstSize)
+{
+    throwIfFalse<out_of_range>(firstRow + rowCount <= rTileSize.y,
+                               fmt::format("Cannot copy rows [{}; {}) of tile with {} rows", firstRow,
+                                           firstRow + rowCount, rTileSize.y));
+    throwIfFalse<invalid_argument>(dstSize >= static_cast<size_t>(rowCount) * rTileSize.x,
+                                   fmt::format("Destination is too small to copy {} rows of {} samples: {}", rowCount,
+                                               rTileSize.x, dstSize));
+}
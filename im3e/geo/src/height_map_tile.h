@@ -0,0 +1,71 @@
+#pragma once
+
+#include <im3e/api/height_map.h>
+#include <im3e/utils/math_utils.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace im3e {
+
+/// @brief Decoded height map tile held in memory.
+struct HeightMapTile
+{
+    TileID tileID;
+    glm::u32vec2 size;
+    glm::u32vec2 actualSize;
+    float scale = 1.0F;
+
+    /// @brief Heights stored row by row, size.x * size.y values.
+    std::vector<float> heights;
+
+    /// @brief Validity mask stored row by row, size.x * size.y values where 0 means invalid.
+    /// Empty if the tile has no mask, in which case all samples are invalid.
+    std::vector<uint8_t> mask;
+
+    auto getByteSize() const -> size_t
+    {
+        return sizeof(HeightMapTile) + heights.size() * sizeof(float) + mask.size() * sizeof(uint8_t);
+    }
+};
+
+/// @brief Check that the given rows and destination are valid arguments to IHeightMapTileSampler::copyRows or
+/// IHeightMapTileSampler::copyMaskRows for a tile of the given size.
+void checkCopyRowsArgs(const glm::u32vec2& rTileSize, uint32_t firstRow, uint32_t rowCount, size_t dstSize);
+
+/// @brief Sampler reading from a decoded tile. The sampler shares ownership of the tile so that the tile remains
+/// valid while being sampled, even if it gets evicted from a cache in the meantime.
+class HeightMapTileSampler : public IHeightMapTileSampler
+{
+public:
+    HeightMapTileSampler(std::shared_ptr<const HeightMapTile> pTile);
+
+    auto at(uint32_t x, uint32_t y) const -> float override { return m_pHeights[y * m_pTile->size.x + x]; }
+    auto at(const glm::u32vec2& rPos) const -> float override { return this->at(rPos.x, rPos.y); }
+
+    auto isValid(uint32_t x, uint32_t y) const -> bool override
+    {
+        return x < m_pTile->actualSize.x && y < m_pTile->actualSize.y && m_pMask &&
+               m_pMask[y * m_pTile->size.x + x] != 0U;
+    }
+
+    void copyRows(uint32_t firstRow, uint32_t rowCount, std::span<float> dst) const override;
+    void copyMaskRows(uint32_t firstRow, uint32_t rowCount, std::span<uint8_t> dst) const override;
+
+    auto getTileID() const -> const TileID& override { return m_pTile->tileID; }
+    auto getPos() const -> glm::u32vec2 override { return m_pTile->tileID.xy(); }
+    auto getSize() const -> const glm::u32vec2& override { return m_pTile->size; }
+    auto getActualSize() const -> const glm::u32vec2& override { return m_pTile->actualSize; }
+    auto getScale() const -> float override { return m_pTile->scale; }
+
+private:
+    std::shared_ptr<const HeightMapTile> m_pTile;
+    const float* m_pHeights;
+    const uint8_t* m_pMask;
+};
+
+}  // namespace im3e
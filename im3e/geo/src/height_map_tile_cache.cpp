@@ -0,0 +1,130 @@
+#include "height_map_tile_cache.h"
+
+#include <fmt/format.h>
+
+using namespace im3e;
+using namespace std;
+
+HeightMapTileCache::HeightMapTileCache(string_view name, size_t byteBudget, shared_ptr<IStatsProvider> pStatsProvider)
+  : m_byteBudget(byteBudget)
+  , m_pStatsProvider(move(pStatsProvider))
+  , m_missSpanName(fmt::format("{}.tileCacheMiss", name))
+{
+    if (m_pStatsProvider)
+    {
+        m_pHitCounter = m_pStatsProvider->getCounter(fmt::format("{}.tileCacheHits", name));
+        m_pMissCounter = m_pStatsProvider->getCounter(fmt::format("{}.tileCacheMisses", name));
+        m_pEvictionCounter = m_pStatsProvider->getCounter(fmt::format("{}.tileCacheEvictions", name));
+        m_pTileCountGauge = m_pStatsProvider->getGauge(fmt::format("{}.tileCacheTiles", name));
+        m_pByteSizeGauge = m_pStatsProvider->getGauge(fmt::format("{}.tileCacheBytes", name));
+    }
+}
+
+auto HeightMapTileCache::getOrLoad(const TileID& rTileID, const function<HeightMapTile()>& rLoad)
+    -> shared_ptr<const HeightMapTile>
+{
+    {
+        lock_guard lk(m_mutex);
+        if (auto itFind = m_tileIDToTile.find(rTileID); itFind != m_tileIDToTile.end())
+        {
+            m_hitCount++;
+            m_pTilesByRecentUse.splice(m_pTilesByRecentUse.begin(), m_pTilesByRecentUse, itFind->second);
+            this->incrementCounter(m_pHitCounter.get());
+            return *itFind->second;
+        }
+        m_missCount++;
+    }
+
+    // Load outside of the lock so that other threads can use the cache meanwhile:
+    shared_ptr<const HeightMapTile> pTile;
+    {
+        auto pMissSpan = m_pStatsProvider ? m_pStatsProvider->startScopedSpan(m_missSpanName) : nullptr;
+        this->incrementCounter(m_pMissCounter.get());
+        pTile = make_shared<const HeightMapTile>(rLoad());
+    }
+
+    const auto tileByteSize = pTile->getByteSize();
+    if (tileByteSize > m_byteBudget)
+    {
+        return pTile;
+    }
+
+    lock_guard lk(m_mutex);
+    if (auto itFind = m_tileIDToTile.find(rTileID); itFind != m_tileIDToTile.end())
+    {
+        // Another thread loaded the same tile in the meantime:
+        return *itFind->second;
+    }
+
+    while (m_byteSize + tileByteSize > m_byteBudget)
+    {
+        auto& rpEvictedTile = m_pTilesByRecentUse.back();
+        m_byteSize -= rpEvictedTile->getByteSize();
+        m_tileIDToTile.erase(rpEvictedTile->tileID);
+        m_pTilesByRecentUse.pop_back();
+        m_evictionCount++;
+        this->incrementCounter(m_pEvictionCounter.get());
+    }
+
+    m_pTilesByRecentUse.emplace_front(pTile);
+    m_tileIDToTile.emplace(rTileID, m_pTilesByRecentUse.begin());
+    m_byteSize += tileByteSize;
+    this->updateGauges();
+    return pTile;
+}
+
+void HeightMapTileCache::clear()
+{
+    lock_guard lk(m_mutex);
+    m_pTilesByRecentUse.clear();
+    m_tileIDToTile.clear();
+    m_byteSize = 0U;
+    this->updateGauges();
+}
+
+auto HeightMapTileCache::getByteSize() const -> size_t
+{
+    lock_guard lk(m_mutex);
+    return m_byteSize;
+}
+
+auto HeightMapTileCache::getTileCount() const -> size_t
+{
+    lock_guard lk(m_mutex);
+    return m_pTilesByRecentUse.size();
+}
+
+auto HeightMapTileCache::getHitCount() const -> uint64_t
+{
+    lock_guard lk(m_mutex);
+    return m_hitCount;
+}
+
+auto HeightMapTileCache::getMissCount() const -> uint64_t
+{
+    lock_guard lk(m_mutex);
+    return m_missCount;
+}
+
+auto HeightMapTileCache::getEvictionCount() const -> uint64_t
+{
+    lock_guard lk(m_mutex);
+    return m_evictionCount;
+}
+
+void HeightMapTileCache::incrementCounter(Counter* pCounter) const
+{
+    if (pCounter)
+    {
+        pCounter->add();
+    }
+}
+
+void HeightMapTileCache::updateGauges() const
+{
+    if (m_pStatsProvider)
+    {
+        m_pTileCountGauge->set(static_cast<int64_t>(m_pTilesByRecentUse.size()));
+        m_pByteSizeGauge->set(static_cast<int64_t>(m_byteSize));
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "height_map_tile.h"
+
+#include <im3e/utils/math_utils.h>
+#include <im3e/utils/stats.h>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace im3e {
+
+/// @brief Least-recently-used cache of decoded height map tiles, bounded by a byte budget.
+/// The cache is thread-safe. Hits, misses and evictions are counted by metrics of the optional stats provider, along
+/// with gauges of the cached tiles and bytes. Misses are also reported as spans covering the time spent loading the
+/// tile.
+class HeightMapTileCache
+{
+public:
+    HeightMapTileCache(std::string_view name, size_t byteBudget, std::shared_ptr<IStatsProvider> pStatsProvider);
+
+    /// @brief Return the cached tile with the given ID or load it with the given function on a miss.
+    /// The loaded tile is inserted in the cache and least recently used tiles are evicted to fit within the budget.
+    /// A tile larger than the whole budget is returned without being cached.
+    auto getOrLoad(const TileID& rTileID, const std::function<HeightMapTile()>& rLoad)
+        -> std::shared_ptr<const HeightMapTile>;
+
+    void clear();
+
+    auto getByteBudget() const -> size_t { return m_byteBudget; }
+    auto getByteSize() const -> size_t;
+    auto getTileCount() const -> size_t;
+
+    auto getHitCount() const -> uint64_t;
+    auto getMissCount() const -> uint64_t;
+    auto getEvictionCount() const -> uint64_t;
+
+private:
+    void incrementCounter(Counter* pCounter) const;
+    void updateGauges() const;
+
+    const size_t m_byteBudget;
+    const std::shared_ptr<IStatsProvider> m_pStatsProvider;
+    const std::string m_missSpanName;
+
+    // Metrics of the stats provider, null without provider:
+    std::shared_ptr<Counter> m_pHitCounter;
+    std::shared_ptr<Counter> m_pMissCounter;
+    std::shared_ptr<Counter> m_pEvictionCounter;
+    std::shared_ptr<Gauge> m_pTileCountGauge;
+    std::shared_ptr<Gauge> m_pByteSizeGauge;
+
+    mutable std::mutex m_mutex;
+    std::list<std::shared_ptr<const HeightMapTile>> m_pTilesByRecentUse;
+    std::unordered_map<TileID, std::list<std::shared_ptr<const HeightMapTile>>::iterator> m_tileIDToTile;
+    size_t m_byteSize{};
+
+    uint64_t m_hitCount{};
+    uint64_t m_missCount{};
+    uint64_t m_evictionCount{};
+};
+
+}  // namespace im3e
@@ -0,0 +1,227 @@
+#include "height_map_tile_ranges.h"
+
+#include <im3e/utils/core/throw_utils.h>
+#include <im3e/utils/thread_pool.h>
+
+#include <fmt/format.h>
+#include <fmt/std.h>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <mutex>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+constexpr uint64_t TileRangesMagic = 0x3130524d48453349U;  // "I3EHMR01"
+constexpr uint32_t TileRangesVersion = 1U;
+
+struct TileRangesHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t lodCount;
+};
+
+auto mergeHeightRanges(const glm::vec2& rRangeA, const glm::vec2& rRangeB)
+{
+    return glm::vec2{min(rRangeA.x, rRangeB.x), max(rRangeA.y, rRangeB.y)};
+}
+
+auto computeTileHeightRange(IHeightMap& rHeightMap, const TileID& rTileID)
+{
+    auto pSampler = rHeightMap.getTileSampler(rTileID);
+    const auto size = pSampler->getSize();
+    const auto sampleCount = static_cast<size_t>(size.x) * size.y;
+
+    vector<float> heights(sampleCount);
+    vector<uint8_t> mask(sampleCount);
+    pSampler->copyRows(0U, size.y, heights);
+    pSampler->copyMaskRows(0U, size.y, mask);
+    return computeHeightRange(heights, mask);
+}
+
+}  // namespace
+
+HeightMapTileRanges::HeightMapTileRanges(vector<glm::u32vec2> tileCounts)
+  : m_tileCounts(move(tileCounts))
+{
+    size_t tileCount{};
+    m_firstTileIndices.reserve(m_tileCounts.size());
+    for (const auto& rLodTileCount : m_tileCounts)
+    {
+        m_firstTileIndices.emplace_back(tileCount);
+        tileCount += static_cast<size_t>(rLodTileCount.x) * rLodTileCount.y;
+    }
+    m_ranges.resize(tileCount, EmptyHeightRange);
+}
+
+auto HeightMapTileRanges::contains(const TileID& rTileID) const -> bool
+{
+    return rTileID.z < m_tileCounts.size() && rTileID.x < m_tileCounts[rTileID.z].x &&
+           rTileID.y < m_tileCounts[rTileID.z].y;
+}
+
+auto HeightMapTileRanges::getIndex(const TileID& rTileID) const -> size_t
+{
+    throwIfFalse<out_of_range>(this->contains(rTileID),
+                               fmt::format("No height range for tile ({}; {}; {})", rTileID.x, rTileID.y, rTileID.z));
+    return m_firstTileIndices[rTileID.z] + static_cast<size_t>(rTileID.y) * m_tileCounts[rTileID.z].x + rTileID.x;
+}
+
+auto im3e::computeHeightRange(span<const float> heights, span<const uint8_t> mask) -> glm::vec2
+{
+    throwIfFalse<invalid_argument>(heights.size() == mask.size(),
+                                   "Cannot compute height range with mask of different size than heights");
+
+    // Invalid samples are replaced by the neutral element of each reduction, keeping the loop free of branches:
+    float minHeight = EmptyHeightRange.x;
+    float maxHeight = EmptyHeightRange.y;
+    for (size_t i = 0U; i < heights.size(); i++)
+    {
+        const bool isValid = mask[i] != 0U;
+        minHeight = min(minHeight, isValid ? heights[i] : EmptyHeightRange.x);
+        maxHeight = max(maxHeight, isValid ? heights[i] : EmptyHeightRange.y);
+    }
+    return glm::vec2{minHeight, maxHeight};
+}
+
+auto im3e::computeHeightMapTileRanges(IHeightMap& rHeightMap) -> HeightMapTileRanges
+{
+    const auto lodCount = rHeightMap.getLodCount();
+    vector<glm::u32vec2> tileCounts;
+    tileCounts.reserve(lodCount);
+    for (uint32_t lod = 0U; lod < lodCount; lod++)
+    {
+        tileCounts.emplace_back(rHeightMap.getTileCount(lod));
+    }
+    HeightMapTileRanges tileRanges(tileCounts);
+
+    // Every task writes the range of a different tile, only errors need to be synchronized:
+    mutex exceptionMutex;
+    exception_ptr pFirstException;
+    {
+        ThreadPool threadPool;
+        for (uint32_t y = 0U; y < tileCounts[0].y; y++)
+        {
+            for (uint32_t x = 0U; x < tileCounts[0].x; x++)
+            {
+                threadPool.submit([&, tileID = TileID{x, y, 0U}] {
+                    try
+                    {
+                        tileRanges.set(tileID, computeTileHeightRange(rHeightMap, tileID));
+                    }
+                    catch (...)
+                    {
+                        lock_guard lk(exceptionMutex);
+                        pFirstException = pFirstException ? pFirstException : current_exception();
+                    }
+                });
+            }
+        }
+        threadPool.waitIdle();
+    }
+    if (pFirstException)
+    {
+        rethrow_exception(pFirstException);
+    }
+
+    for (uint32_t lod = 1U; lod < lodCount; lod++)
+    {
+        const auto& rChildTileCount = tileCounts[lod - 1U];
+        for (uint32_t y = 0U; y < tileCounts[lod].y; y++)
+        {
+            for (uint32_t x = 0U; x < tileCounts[lod].x; x++)
+            {
+                auto range = EmptyHeightRange;
+                for (uint32_t childY = 2U * y; childY < min(2U * y + 2U, rChildTileCount.y); childY++)
+                {
+                    for (uint32_t childX = 2U * x; childX < min(2U * x + 2U, rChildTileCount.x); childX++)
+                    {
+                        range = mergeHeightRanges(range, tileRanges.get(TileID{childX, childY, lod - 1U}));
+                    }
+                }
+                tileRanges.set(TileID{x, y, lod}, range);
+            }
+        }
+    }
+    return tileRanges;
+}
+
+auto im3e::getHeightMapTileRangesPath(const filesystem::path& rHeightMapPath) -> filesystem::path
+{
+    auto path = rHeightMapPath;
+    path += HeightMapTileRangesExtension;
+    return path;
+}
+
+void im3e::saveHeightMapTileRanges(const HeightMapTileRanges& rTileRanges, const filesystem::path& rPath)
+{
+    const TileRangesHeader header{
+        .magic = TileRangesMagic,
+        .version = TileRangesVersion,
+        .lodCount = rTileRanges.getLodCount(),
+    };
+    const auto& rTileCounts = rTileRanges.getTileCounts();
+    const auto ranges = rTileRanges.getRanges();
+
+    ofstream file(rPath, ios::binary | ios::trunc);
+    throwIfFalse<runtime_error>(file.is_open(), fmt::format("Failed to create tile ranges file \"{}\"", rPath));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(rTileCounts.data()), rTileCounts.size() * sizeof(glm::u32vec2));
+    file.write(reinterpret_cast<const char*>(ranges.data()), ranges.size_bytes());
+    throwIfFalse<runtime_error>(file.good(), fmt::format("Failed to write tile ranges file \"{}\"", rPath));
+}
+
+auto im3e::loadHeightMapTileRanges(const filesystem::path& rPath) -> optional<HeightMapTileRanges>
+{
+    ifstream file(rPath, ios::binary);
+    if (!file.is_open())
+    {
+        return nullopt;
+    }
+
+    TileRangesHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file.good() || header.magic != TileRangesMagic || header.version != TileRangesVersion)
+    {
+        return nullopt;
+    }
+
+    // Level of details are halved until reaching a single tile: the count is far below this limit for valid files.
+    constexpr uint32_t MaxLodCount = 32U;
+    if (header.lodCount > MaxLodCount)
+    {
+        return nullopt;
+    }
+    vector<glm::u32vec2> tileCounts(header.lodCount);
+    file.read(reinterpret_cast<char*>(tileCounts.data()), tileCounts.size() * sizeof(glm::u32vec2));
+    if (!file.good())
+    {
+        return nullopt;
+    }
+
+    // Check the size of the file before allocating the ranges to not trust corrupted tile counts:
+    uint64_t tileCount{};
+    for (const auto& rLodTileCount : tileCounts)
+    {
+        tileCount += static_cast<uint64_t>(rLodTileCount.x) * rLodTileCount.y;
+    }
+    const auto rangesByteSize = filesystem::file_size(rPath) - static_cast<uint64_t>(file.tellg());
+    if (rangesByteSize != tileCount * sizeof(glm::vec2))
+    {
+        return nullopt;
+    }
+
+    HeightMapTileRanges tileRanges(move(tileCounts));
+    auto ranges = tileRanges.getRanges();
+    file.read(reinterpret_cast<char*>(ranges.data()), ranges.size_bytes());
+    if (!file.good())
+    {
+        return nullopt;
+    }
+    return tileRanges;
+}
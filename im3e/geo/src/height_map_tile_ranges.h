@@ -0,0 +1,70 @@
+#pragma once
+
+#include <im3e/api/height_map.h>
+#include <im3e/utils/math_utils.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace im3e {
+
+/// @brief Extension appended to the path of a height map file to get the path of its tile height ranges sidecar file.
+constexpr std::string_view HeightMapTileRangesExtension = ".imhr";
+
+/// @brief Minimum and maximum heights of every tile of every level of details of a height map.
+/// Ranges are stored as (min, max) pairs, level of details after level of details, with the tiles of each level
+/// sorted row by row.
+class HeightMapTileRanges
+{
+public:
+    HeightMapTileRanges() = default;
+
+    /// @brief Create ranges for levels of details with the given tile counts, all tiles starting without valid sample.
+    explicit HeightMapTileRanges(std::vector<glm::u32vec2> tileCounts);
+
+    auto contains(const TileID& rTileID) const -> bool;
+    auto get(const TileID& rTileID) const -> glm::vec2 { return m_ranges[this->getIndex(rTileID)]; }
+    void set(const TileID& rTileID, const glm::vec2& rRange) { m_ranges[this->getIndex(rTileID)] = rRange; }
+
+    auto getLodCount() const -> uint32_t { return static_cast<uint32_t>(m_tileCounts.size()); }
+    auto getTileCounts() const -> const std::vector<glm::u32vec2>& { return m_tileCounts; }
+
+    auto getRanges() const -> std::span<const glm::vec2> { return m_ranges; }
+    auto getRanges() -> std::span<glm::vec2> { return m_ranges; }
+
+private:
+    auto getIndex(const TileID& rTileID) const -> size_t;
+
+    std::vector<glm::u32vec2> m_tileCounts;
+    std::vector<size_t> m_firstTileIndices;
+    std::vector<glm::vec2> m_ranges;
+};
+
+/// @brief Range of a tile without any valid sample, neutral element when merging ranges.
+constexpr glm::vec2 EmptyHeightRange{std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+
+/// @brief Compute the (min, max) heights of the valid samples among the given heights.
+/// @param[in] heights Heights to inspect
+/// @param[in] mask Validity of each height, 0 meaning invalid
+auto computeHeightRange(std::span<const float> heights, std::span<const uint8_t> mask) -> glm::vec2;
+
+/// @brief Compute the ranges of all tiles of the given height map in parallel.
+/// Only the tiles of the highest level of details are read: lower levels of details are downsampled from higher
+/// ones, so that their ranges are merged from the ranges of the tiles they cover.
+auto computeHeightMapTileRanges(IHeightMap& rHeightMap) -> HeightMapTileRanges;
+
+auto getHeightMapTileRangesPath(const std::filesystem::path& rHeightMapPath) -> std::filesystem::path;
+void saveHeightMapTileRanges(const HeightMapTileRanges& rTileRanges, const std::filesystem::path& rPath);
+
+/// @brief Load tile ranges saved with saveHeightMapTileRanges.
+/// @return Loaded tile ranges or nothing if the file does not exist or is not a valid tile ranges file.
+auto loadHeightMapTileRanges(const std::filesystem::path& rPath) -> std::optional<HeightMapTileRanges>;
+
+}  // namespace im3e
@@ -0,0 +1,319 @@
+#include "native_height_map.h"
+
+#include "height_map_tile.h"
+
+#include <im3e/utils/core/throw_utils.h>
+#include <im3e/utils/math_utils.h>
+
+#include <fmt/format.h>
+#include <fmt/std.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <span>
+
+using namespace im3e;
+using namespace im3e::native_height_map;
+using namespace std;
+
+static_assert(sizeof(Header) + sizeof(LodInfo) <= PageSize);
+
+namespace {
+
+auto calculateMaskByteSize(const glm::u32vec2& rTileSize) -> uint32_t
+{
+    return (rTileSize.x * rTileSize.y + 7U) / 8U;
+}
+
+auto calculateTileStride(const glm::u32vec2& rTileSize) -> uint32_t
+{
+    const auto tileByteSize = static_cast<uint32_t>(rTileSize.x * rTileSize.y * sizeof(float));
+    return alignUp(tileByteSize + calculateMaskByteSize(rTileSize), PageSize);
+}
+
+auto mapFile(const filesystem::path& rPath, size_t& rFileSize) -> UniquePtrWithDeleter<const byte>
+{
+    const int fd = open(rPath.c_str(), O_RDONLY);
+    throwIfFalse<runtime_error>(fd >= 0, fmt::format("Failed to open native height map file \"{}\"", rPath));
+
+    struct stat fileStat{};
+    const bool statSucceeded = fstat(fd, &fileStat) == 0;
+    rFileSize = statSucceeded ? static_cast<size_t>(fileStat.st_size) : 0U;
+
+    // The mapping remains valid after the file descriptor is closed:
+    auto pData = (rFileSize >= PageSize) ? mmap(nullptr, rFileSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    throwIfFalse<runtime_error>(pData != MAP_FAILED, fmt::format("Failed to map native height map file \"{}\"", rPath));
+
+    const auto fileSize = rFileSize;
+    return UniquePtrWithDeleter<const byte>(reinterpret_cast<const byte*>(pData), [fileSize](const byte* pData) {
+        munmap(const_cast<byte*>(pData), fileSize);
+    });
+}
+
+auto validateHeader(const byte* pFileData, size_t fileSize, const filesystem::path& rPath) -> const Header*
+{
+    auto pHeader = reinterpret_cast<const Header*>(pFileData);
+    throwIfFalse<runtime_error>(pHeader->magic == Magic,
+                                fmt::format("\"{}\" is not a native height map file", rPath));
+    throwIfFalse<runtime_error>(pHeader->version == Version,
+                                fmt::format("Unsupported native height map version {}, expected {}",
+                                            pHeader->version, Version));
+    throwIfFalse<runtime_error>(pHeader->pageSize == PageSize && pHeader->lodCount > 0U &&
+                                    pHeader->lodCount <= MaxLodCount &&
+                                    pHeader->tileStride == calculateTileStride(pHeader->tileSize),
+                                fmt::format("Corrupted native height map header in \"{}\"", rPath));
+
+    auto pLodInfos = reinterpret_cast<const LodInfo*>(pFileData + sizeof(Header));
+    uint64_t tileCount{};
+    for (uint32_t lod = 0U; lod < pHeader->lodCount; lod++)
+    {
+        const auto& rLodInfo = pLodInfos[lod];
+        const auto lodTileCount = static_cast<uint64_t>(rLodInfo.tileCount.x) * rLodInfo.tileCount.y;
+        throwIfFalse<runtime_error>(rLodInfo.firstTileOffset + lodTileCount * pHeader->tileStride <= fileSize,
+                                    fmt::format("Truncated native height map file \"{}\"", rPath));
+        tileCount += lodTileCount;
+    }
+    throwIfFalse<runtime_error>(pHeader->tileRangesOffset + tileCount * sizeof(glm::vec2) <= fileSize,
+                                fmt::format("Truncated native height map file \"{}\"", rPath));
+    return pHeader;
+}
+
+auto readTileRanges(const byte* pFileData, const Header& rHeader, const LodInfo* pLodInfos) -> HeightMapTileRanges
+{
+    vector<glm::u32vec2> tileCounts;
+    for (uint32_t lod = 0U; lod < rHeader.lodCount; lod++)
+    {
+        tileCounts.emplace_back(pLodInfos[lod].tileCount);
+    }
+    HeightMapTileRanges tileRanges(move(tileCounts));
+    auto ranges = tileRanges.getRanges();
+    memcpy(ranges.data(), pFileData + rHeader.tileRangesOffset, ranges.size_bytes());
+    return tileRanges;
+}
+
+class NativeHeightMapTileSampler : public IHeightMapTileSampler
+{
+public:
+    NativeHeightMapTileSampler(const byte* pTileData, const Header& rHeader, const LodInfo& rLodInfo,
+                               const TileID& rTileID)
+      : m_tileID(rTileID)
+      , m_size(rHeader.tileSize)
+      , m_actualSize(glm::min(m_size, rLodInfo.size - glm::u32vec2(m_tileID.xy()) * m_size))
+      , m_scale(static_cast<float>(pow(2.0F, m_tileID.z)))
+      , m_pHeights(reinterpret_cast<const float*>(pTileData))
+      , m_pMask(reinterpret_cast<const uint8_t*>(m_pHeights + m_size.x * m_size.y))
+    {
+    }
+
+    auto at(uint32_t x, uint32_t y) const -> float override { return m_pHeights[y * m_size.x + x]; }
+    auto at(const glm::u32vec2& rPos) const -> float override { return this->at(rPos.x, rPos.y); }
+
+    auto isValid(uint32_t x, uint32_t y) const -> bool override
+    {
+        const auto index = y * m_size.x + x;
+        return x < m_actualSize.x && y < m_actualSize.y && (m_pMask[index / 8U] & (1U << (index % 8U))) != 0U;
+    }
+
+    void copyRows(uint32_t firstRow, uint32_t rowCount, span<float> dst) const override
+    {
+        checkCopyRowsArgs(m_size, firstRow, rowCount, dst.size());
+        memcpy(dst.data(), m_pHeights + firstRow * m_size.x, static_cast<size_t>(rowCount) * m_size.x * sizeof(float));
+    }
+
+    void copyMaskRows(uint32_t firstRow, uint32_t rowCount, span<uint8_t> dst) const override
+    {
+        checkCopyRowsArgs(m_size, firstRow, rowCount, dst.size());
+
+        // Expand the bitmap to one byte per sample, branchless so that the compiler vectorizes it:
+        const auto firstIndex = firstRow * m_size.x;
+        const auto sampleCount = rowCount * m_size.x;
+        const auto pDst = dst.data();
+        for (uint32_t i = 0U; i < sampleCount; i++)
+        {
+            const auto index = firstIndex + i;
+            pDst[i] = static_cast<uint8_t>((m_pMask[index / 8U] >> (index % 8U)) & 1U);
+        }
+
+        // Clear samples outside of the actual size of the tile:
+        for (uint32_t row = 0U; row < rowCount; row++)
+        {
+            const auto pDstRow = pDst + row * m_size.x;
+            const auto validCount = (firstRow + row < m_actualSize.y) ? m_actualSize.x : 0U;
+            fill(pDstRow + validCount, pDstRow + m_size.x, uint8_t{});
+        }
+    }
+
+    auto getTileID() const -> const TileID& override { return m_tileID; }
+    auto getPos() const -> glm::u32vec2 override { return m_tileID.xy(); }
+    auto getSize() const -> const glm::u32vec2& override { return m_size; }
+    auto getActualSize() const -> const glm::u32vec2& override { return m_actualSize; }
+    auto getScale() const -> float override { return m_scale; }
+
+private:
+    const TileID m_tileID;
+    const glm::u32vec2 m_size;
+    const glm::u32vec2 m_actualSize;
+    const float m_scale;
+
+    const float* m_pHeights;
+    const uint8_t* m_pMask;
+};
+
+}  // namespace
+
+NativeHeightMap::NativeHeightMap(const ILogger& rLogger, HeightMapFileConfig config)
+  : m_pLogger(rLogger.createChild(config.path.filename().string()))
+  , m_config(move(config))
+  , m_pFileData(mapFile(m_config.path, m_fileSize))
+  , m_pHeader(validateHeader(m_pFileData.get(), m_fileSize, m_config.path))
+  , m_pLodInfos(reinterpret_cast<const LodInfo*>(m_pFileData.get() + sizeof(Header)))
+  , m_tileRanges(readTileRanges(m_pFileData.get(), *m_pHeader, m_pLodInfos))
+{
+    if (!m_config.readOnly)
+    {
+        m_pLogger->warning("Native height maps are always opened in read-only mode");
+    }
+
+    m_pLogger->verbose(fmt::format("Information for file:"));
+    m_pLogger->verbose(fmt::format("\t- Size: {}x{}", m_pHeader->size.x, m_pHeader->size.y));
+    m_pLogger->verbose(fmt::format("\t- Tile size: {}x{}", m_pHeader->tileSize.x, m_pHeader->tileSize.y));
+    m_pLogger->verbose(fmt::format("\t- Level of details count: {}", m_pHeader->lodCount));
+    m_pLogger->verbose(fmt::format("\t- Minimum: {}", m_pHeader->minHeight));
+    m_pLogger->verbose(fmt::format("\t- Maximum: {}", m_pHeader->maxHeight));
+    m_pLogger->info("Successfully loaded file");
+}
+
+void NativeHeightMap::rebuildPyramid()
+{
+    throw logic_error("Cannot rebuild pyramid of a native height map, the pyramid is written when converting to it");
+}
+
+auto NativeHeightMap::getTileSampler(const TileID& rTileID) -> unique_ptr<IHeightMapTileSampler>
+{
+    throwIfFalse<invalid_argument>(rTileID.z < m_pHeader->lodCount,
+                                   fmt::format("Invalid input LOD: {} > max {}", rTileID.z, m_pHeader->lodCount));
+    const auto& rLodInfo = m_pLodInfos[rTileID.z];
+    throwIfFalse<invalid_argument>(rTileID.x < rLodInfo.tileCount.x && rTileID.y < rLodInfo.tileCount.y,
+                                   fmt::format("Invalid tile position: ({}; {}) >= ({}; {})", rTileID.x, rTileID.y,
+                                               rLodInfo.tileCount.x, rLodInfo.tileCount.y));
+
+    const auto tileIndex = static_cast<uint64_t>(rTileID.y) * rLodInfo.tileCount.x + rTileID.x;
+    auto pTileData = m_pFileData.get() + rLodInfo.firstTileOffset + tileIndex * m_pHeader->tileStride;
+    return make_unique<NativeHeightMapTileSampler>(pTileData, *m_pHeader, rLodInfo, rTileID);
+}
+
+auto NativeHeightMap::getTileSampler(const glm::u32vec2& rTilePos, uint32_t lod) -> unique_ptr<IHeightMapTileSampler>
+{
+    return this->getTileSampler(TileID{rTilePos.x, rTilePos.y, lod});
+}
+
+auto NativeHeightMap::getTileCount(uint32_t lod) const -> glm::u32vec2
+{
+    throwIfFalse<invalid_argument>(lod < m_pHeader->lodCount,
+                                   fmt::format("Invalid input LOD: {} > max {}", lod, m_pHeader->lodCount));
+    return m_pLodInfos[lod].tileCount;
+}
+
+void im3e::convertToNativeHeightMap(const ILogger& rLogger, IHeightMap& rSrcHeightMap,
+                                    const filesystem::path& rDstPath)
+{
+    const auto tileSize = rSrcHeightMap.getTileSize();
+    const auto lodCount = rSrcHeightMap.getLodCount();
+    throwIfFalse<invalid_argument>(lodCount <= MaxLodCount,
+                                   fmt::format("Too many levels of details: {} > max {}", lodCount, MaxLodCount));
+
+    Header header{
+        .magic = Magic,
+        .version = Version,
+        .pageSize = PageSize,
+        .size = rSrcHeightMap.getSize(),
+        .tileSize = tileSize,
+        .lodCount = lodCount,
+        .minHeight = rSrcHeightMap.getMinHeight(),
+        .maxHeight = rSrcHeightMap.getMaxHeight(),
+        .tileStride = calculateTileStride(tileSize),
+    };
+
+    vector<LodInfo> lodInfos(lodCount);
+    uint64_t nextTileOffset = PageSize;
+    for (uint32_t lod = 0U; lod < lodCount; lod++)
+    {
+        const auto tileCount = rSrcHeightMap.getTileCount(lod);
+        lodInfos[lod] = LodInfo{
+            .size = {},  // Determined from the actual size of the tiles while converting them
+            .tileCount = tileCount,
+            .firstTileOffset = nextTileOffset,
+        };
+        nextTileOffset += static_cast<uint64_t>(tileCount.x) * tileCount.y * header.tileStride;
+    }
+    header.tileRangesOffset = nextTileOffset;
+
+    vector<glm::u32vec2> tileCounts;
+    for (const auto& rLodInfo : lodInfos)
+    {
+        tileCounts.emplace_back(rLodInfo.tileCount);
+    }
+    HeightMapTileRanges tileRanges(move(tileCounts));
+
+    ofstream file(rDstPath, ios::binary | ios::trunc);
+    throwIfFalse<runtime_error>(file.is_open(),
+                                fmt::format("Failed to create native height map file \"{}\"", rDstPath));
+
+    // The first page is written last, once the size of each level of details is known:
+    vector<byte> page(PageSize);
+    file.write(reinterpret_cast<const char*>(page.data()), page.size());
+
+    const auto sampleCount = tileSize.x * tileSize.y;
+    vector<uint8_t> validity(sampleCount);
+    vector<byte> tileData(header.tileStride);
+    auto pHeights = reinterpret_cast<float*>(tileData.data());
+    auto pMask = reinterpret_cast<uint8_t*>(pHeights + tileSize.x * tileSize.y);
+    for (uint32_t lod = 0U; lod < lodCount; lod++)
+    {
+        auto& rLodInfo = lodInfos[lod];
+        rLogger.info(fmt::format("Converting level of details {}: {}x{} tiles", lod, rLodInfo.tileCount.x,
+                                 rLodInfo.tileCount.y));
+
+        for (uint32_t y = 0U; y < rLodInfo.tileCount.y; y++)
+        {
+            for (uint32_t x = 0U; x < rLodInfo.tileCount.x; x++)
+            {
+                ranges::fill(tileData, byte{});
+
+                auto pSampler = rSrcHeightMap.getTileSampler(TileID{x, y, lod});
+                throwIfFalse<runtime_error>(pSampler->getSize() == tileSize,
+                                            "Cannot convert height map with tiles of different sizes");
+                const auto actualSize = pSampler->getActualSize();
+                rLodInfo.size = glm::max(rLodInfo.size, glm::u32vec2{x, y} * tileSize + actualSize);
+
+                pSampler->copyRows(0U, tileSize.y, span<float>(pHeights, sampleCount));
+                pSampler->copyMaskRows(0U, tileSize.y, validity);
+                for (uint32_t index = 0U; index < sampleCount; index++)
+                {
+                    pMask[index / 8U] |= static_cast<uint8_t>(validity[index] << (index % 8U));
+                }
+                const auto tileRange = computeHeightRange(span<const float>(pHeights, sampleCount), validity);
+                tileRanges.set(TileID{x, y, lod}, tileRange);
+                file.write(reinterpret_cast<const char*>(tileData.data()), tileData.size());
+            }
+        }
+    }
+
+    const auto ranges = tileRanges.getRanges();
+    file.write(reinterpret_cast<const char*>(ranges.data()), ranges.size_bytes());
+
+    memcpy(page.data(), &header, sizeof(Header));
+    memcpy(page.data() + sizeof(Header), lodInfos.data(), lodInfos.size() * sizeof(LodInfo));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(page.data()), page.size());
+    throwIfFalse<runtime_error>(file.good(), fmt::format("Failed to write native height map file \"{}\"", rDstPath));
+    rLogger.info(fmt::format("Successfully converted height map to \"{}\"", rDstPath));
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "geo.h"
+#include "height_map_tile_ranges.h"
+
+#include <im3e/api/height_map.h>
+#include <im3e/utils/core/types.h>
+#include <im3e/utils/loggers.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace im3e {
+
+/// @brief Layout of the im3e native height map file.
+/// The file starts with a header followed by the description of every level of details, all contained in the first
+/// page. Tiles of each level of details follow, sorted row by row. Each tile starts on a page boundary and contains
+/// its heights as floats followed by its validity mask stored as a bitmap with one bit per sample. Tiles always
+/// contain a full tile worth of samples, even at the edges of the height map. The (min, max) heights of every tile
+/// follow the last tile, in the same order as the tiles.
+namespace native_height_map {
+
+constexpr uint64_t Magic = 0x3130504d48453349U;  // "I3EHMP01"
+constexpr uint32_t Version = 2U;
+constexpr uint32_t PageSize = 4096U;
+
+struct Header
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t pageSize;
+    glm::u32vec2 size;
+    glm::u32vec2 tileSize;
+    uint32_t lodCount;
+    float minHeight;
+    float maxHeight;
+    uint32_t tileStride;
+    uint64_t tileRangesOffset;
+};
+
+struct LodInfo
+{
+    glm::u32vec2 size;
+    glm::u32vec2 tileCount;
+    uint64_t firstTileOffset;
+};
+
+constexpr uint32_t MaxLodCount = (PageSize - sizeof(Header)) / sizeof(LodInfo);
+
+}  // namespace native_height_map
+
+/// @brief Height map backed by a memory-mapped im3e native height map file.
+/// Tile samplers read directly from the file mapping: loading a tile does not decode nor copy anything.
+class NativeHeightMap : public IHeightMap
+{
+public:
+    NativeHeightMap(const ILogger& rLogger, HeightMapFileConfig config);
+
+    void rebuildPyramid() override;
+
+    auto getTileSampler(const TileID& rTileID) -> std::unique_ptr<IHeightMapTileSampler> override;
+    auto getTileSampler(const glm::u32vec2& rTilePos, uint32_t lod)
+        -> std::unique_ptr<IHeightMapTileSampler> override;
+
+    auto getName() const -> std::string override { return m_config.path.stem().string(); }
+    auto getSize() const -> glm::u32vec2 override { return m_pHeader->size; }
+    auto getTileSize() const -> glm::u32vec2 override { return m_pHeader->tileSize; }
+    auto getTileCount(uint32_t lod) const -> glm::u32vec2 override;
+    auto getLodCount() const -> uint32_t override { return m_pHeader->lodCount; }
+    auto getMinHeight() const -> float override { return m_pHeader->minHeight; }
+    auto getMaxHeight() const -> float override { return m_pHeader->maxHeight; }
+    auto getTileHeightRange(const TileID& rTileID) const -> glm::vec2 override { return m_tileRanges.get(rTileID); }
+
+private:
+    std::unique_ptr<ILogger> m_pLogger;
+    const HeightMapFileConfig m_config;
+
+    size_t m_fileSize{};
+    UniquePtrWithDeleter<const std::byte> m_pFileData;
+
+    const native_height_map::Header* m_pHeader;
+    const native_height_map::LodInfo* m_pLodInfos;
+
+    HeightMapTileRanges m_tileRanges;
+};
+
+}  // namespace im3e
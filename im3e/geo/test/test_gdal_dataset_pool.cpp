@@ -0,0 +1,105 @@
+#include "src/gdal_dataset_pool.h"
+#include "src/gdal_instance.h"
+
+#include <im3e/test_utils/test_utils.h>
+#include <im3e/utils/mock/mock_logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <set>
+#include <stdexcept>
+
+using namespace im3e;
+using namespace std;
+
+struct GdalDatasetPoolTest : public Test
+{
+    auto createPool(uint32_t maxDatasetCount)
+    {
+        return make_unique<GdalDatasetPool>(
+            [this] {
+                m_openCount++;
+                auto pDriver = GetGDALDriverManager()->GetDriverByName("MEM");
+                return GDALDatasetUniquePtr(pDriver->Create("", 4, 4, 1, GDT_Float32, nullptr));
+            },
+            maxDatasetCount);
+    }
+
+    NiceMock<MockLogger> m_mockLogger;
+    shared_ptr<IGdalInstance> m_pGdalInstance = getGdalInstance(m_mockLogger);
+    atomic<uint32_t> m_openCount{};
+};
+
+TEST_F(GdalDatasetPoolTest, acquireReusesReleasedDatasets)
+{
+    auto pPool = createPool(4U);
+    GDALDataset* pFirstDataset{};
+    {
+        auto pDataset = pPool->acquire();
+        ASSERT_THAT(pDataset, NotNull());
+        pFirstDataset = pDataset.get();
+    }
+    auto pDataset = pPool->acquire();
+    EXPECT_THAT(pDataset.get(), Eq(pFirstDataset));
+    EXPECT_THAT(m_openCount.load(), Eq(1U));
+    EXPECT_THAT(pPool->getDatasetCount(), Eq(1U));
+}
+
+TEST_F(GdalDatasetPoolTest, acquireOpensOneDatasetPerConcurrentUser)
+{
+    auto pPool = createPool(4U);
+    vector<GdalDatasetPool::DatasetHandle> pDatasets;
+    set<GDALDataset*> distinctDatasets;
+    for (uint32_t i = 0U; i < 3U; i++)
+    {
+        pDatasets.emplace_back(pPool->acquire());
+        distinctDatasets.insert(pDatasets.back().get());
+    }
+    EXPECT_THAT(distinctDatasets.size(), Eq(3U));
+    EXPECT_THAT(m_openCount.load(), Eq(3U));
+
+    pDatasets.clear();
+    EXPECT_THAT(pPool->getDatasetCount(), Eq(3U));
+}
+
+TEST_F(GdalDatasetPoolTest, acquireWaitsForReleaseAtMaxDatasetCount)
+{
+    auto pPool = createPool(1U);
+    auto pDataset = pPool->acquire();
+
+    auto acquired = async(launch::async, [&] { return pPool->acquire().get(); });
+    EXPECT_THAT(acquired.wait_for(50ms), Eq(future_status::timeout));
+
+    auto pFirstDataset = pDataset.get();
+    pDataset.reset();
+    EXPECT_THAT(acquired.get(), Eq(pFirstDataset));
+    EXPECT_THAT(m_openCount.load(), Eq(1U));
+}
+
+TEST_F(GdalDatasetPoolTest, clear)
+{
+    auto pPool = createPool(4U);
+    auto pUsedDataset = pPool->acquire();
+    pPool->acquire().reset();
+    EXPECT_THAT(pPool->getDatasetCount(), Eq(2U));
+
+    // Idle datasets are closed right away, datasets in use once released:
+    pPool->clear();
+    EXPECT_THAT(pPool->getDatasetCount(), Eq(1U));
+    pUsedDataset.reset();
+    EXPECT_THAT(pPool->getDatasetCount(), Eq(0U));
+
+    pPool->acquire();
+    EXPECT_THAT(m_openCount.load(), Eq(3U));
+}
+
+TEST_F(GdalDatasetPoolTest, acquireThrowsWhenOpeningFails)
+{
+    GdalDatasetPool pool([] { return GDALDatasetUniquePtr(); }, 1U);
+    EXPECT_THROW(pool.acquire(), runtime_error);
+
+    // The failed dataset does not count towards the maximum:
+    EXPECT_THAT(pool.getDatasetCount(), Eq(0U));
+    EXPECT_THROW(pool.acquire(), runtime_error);
+}
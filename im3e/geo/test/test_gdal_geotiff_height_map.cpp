@@ -0,0 +1,213 @@
+#include "src/gdal_geotiff_height_map.h"
+
+#include <im3e/test_utils/test_utils.h>
+#include <im3e/utils/mock/mock_logger.h>
+#include <im3e/utils/thread_pool.h>
+
+#include <fmt/format.h>
+
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+constexpr glm::u32vec2 TestTileSize{256U, 256U};
+
+auto getTestHeight(uint32_t x, uint32_t y)
+{
+    return 100.0F * sin(0.01F * static_cast<float>(x)) * cos(0.02F * static_cast<float>(y)) +
+           static_cast<float>((x * 7U + y * 13U) % 11U);
+}
+
+/// @brief Write a tiled and compressed GeoTIFF, so that reading a tile decodes it.
+void writeTestGeoTiff(const filesystem::path& rPath, const glm::u32vec2& rTileCount)
+{
+    const auto size = rTileCount * TestTileSize;
+    auto pDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
+    ASSERT_THAT(pDriver, NotNull());
+
+    const auto blockXSizeOption = fmt::format("BLOCKXSIZE={}", TestTileSize.x);
+    const auto blockYSizeOption = fmt::format("BLOCKYSIZE={}", TestTileSize.y);
+    array<const char*, 5U> options{"TILED=YES", "COMPRESS=DEFLATE", blockXSizeOption.c_str(),
+                                   blockYSizeOption.c_str(), nullptr};
+    GDALDatasetUniquePtr pDataset(pDriver->Create(rPath.c_str(), static_cast<int>(size.x), static_cast<int>(size.y),
+                                                  1, GDT_Float32, const_cast<char**>(options.data())));
+    ASSERT_THAT(pDataset, NotNull());
+
+    vector<float> heights(static_cast<size_t>(size.x) * size.y);
+    for (uint32_t y = 0U; y < size.y; y++)
+    {
+        for (uint32_t x = 0U; x < size.x; x++)
+        {
+            heights[static_cast<size_t>(y) * size.x + x] = getTestHeight(x, y);
+        }
+    }
+    const auto writeCode = pDataset->GetRasterBand(1)->RasterIO(GF_Write, 0, 0, size.x, size.y, heights.data(), size.x,
+                                                                size.y, GDT_Float32, 0, 0, nullptr);
+    ASSERT_THAT(writeCode, Eq(CE_None));
+}
+
+}  // namespace
+
+struct GdalGeoTiffHeightMapTest : public Test
+{
+    ~GdalGeoTiffHeightMapTest() override
+    {
+        filesystem::remove(m_path);
+        filesystem::remove(getHeightMapTileRangesPath(m_path));
+    }
+
+    auto loadTestHeightMap(const glm::u32vec2& rTileCount, uint32_t maxConcurrentReadCount,
+                           shared_ptr<IStatsProvider> pStatsProvider = nullptr)
+    {
+        writeTestGeoTiff(m_path, rTileCount);
+
+        // Without cache, every tile sampler reads its tile from the file:
+        return make_unique<GdalGeoTiffHeightMap>(m_mockLogger, HeightMapFileConfig{
+                                                                   .path = m_path,
+                                                                   .tileCacheByteBudget = 0U,
+                                                                   .pStatsProvider = move(pStatsProvider),
+                                                                   .maxConcurrentReadCount = maxConcurrentReadCount,
+                                                               });
+    }
+
+    auto loadWritableTestHeightMap(const glm::u32vec2& rTileCount, uint32_t maxConcurrentReadCount)
+    {
+        writeTestGeoTiff(m_path, rTileCount);
+        return make_unique<GdalGeoTiffHeightMap>(m_mockLogger, HeightMapFileConfig{
+                                                                   .path = m_path,
+                                                                   .readOnly = false,
+                                                                   .tileCacheByteBudget = 0U,
+                                                                   .maxConcurrentReadCount = maxConcurrentReadCount,
+                                                               });
+    }
+
+    /// @brief Read every tile once, from the given number of threads, and return the duration of the reads.
+    static auto readAllTiles(GdalGeoTiffHeightMap& rHeightMap, uint32_t threadCount)
+    {
+        const auto tileCount = rHeightMap.getTileCount(0U);
+        atomic<uint32_t> checkedTileCount{};
+
+        const auto start = chrono::steady_clock::now();
+        {
+            ThreadPool threadPool(threadCount);
+            for (uint32_t y = 0U; y < tileCount.y; y++)
+            {
+                for (uint32_t x = 0U; x < tileCount.x; x++)
+                {
+                    threadPool.submit([&, x, y] {
+                        auto pSampler = rHeightMap.getTileSampler(glm::u32vec2{x, y}, 0U);
+                        const auto origin = glm::u32vec2{x, y} * TestTileSize;
+                        if (pSampler->at(7U, 3U) == getTestHeight(origin.x + 7U, origin.y + 3U))
+                        {
+                            checkedTileCount++;
+                        }
+                    });
+                }
+            }
+            threadPool.waitIdle();
+        }
+        EXPECT_THAT(checkedTileCount.load(), Eq(tileCount.x * tileCount.y));
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start);
+    }
+
+    NiceMock<MockLogger> m_mockLogger;
+    shared_ptr<IGdalInstance> m_pGdalInstance = getGdalInstance(m_mockLogger);
+    const filesystem::path m_path = filesystem::temp_directory_path() /
+                                    fmt::format("test_gdal_geotiff_height_map_{}.tif", getpid());
+};
+
+TEST_F(GdalGeoTiffHeightMapTest, getTileSamplerFromSeveralThreads)
+{
+    auto pHeightMap = loadTestHeightMap(glm::u32vec2{4U, 3U}, 4U);
+    EXPECT_THAT(pHeightMap->getTileSize(), Eq(TestTileSize));
+
+    readAllTiles(*pHeightMap, 4U);
+
+    // Datasets are opened on demand and reused, never more than the maximum:
+    EXPECT_THAT(pHeightMap->getDatasetPool().getDatasetCount(), Ge(1U));
+    EXPECT_THAT(pHeightMap->getDatasetPool().getDatasetCount(), Le(4U));
+}
+
+TEST_F(GdalGeoTiffHeightMapTest, metricsArePublishedToStatsProvider)
+{
+    auto pStatsProvider = createStatsProvider();
+    auto pHeightMap = loadTestHeightMap(glm::u32vec2{4U, 3U}, 4U, pStatsProvider);
+
+    readAllTiles(*pHeightMap, 4U);
+
+    const auto name = pHeightMap->getName();
+    EXPECT_THAT(pStatsProvider->getCounter(fmt::format("{}.tileReads", name))->getValue(), Eq(12));
+    EXPECT_THAT(pStatsProvider->getCounter(fmt::format("{}.tileReadBytes", name))->getValue(),
+                Ge(12 * static_cast<int64_t>(TestTileSize.x * TestTileSize.y * sizeof(float))));
+    EXPECT_THAT(pStatsProvider->getGauge(fmt::format("{}.openDatasets", name))->getValue(), AllOf(Ge(1), Le(4)));
+}
+
+TEST_F(GdalGeoTiffHeightMapTest, DISABLED_benchmarkConcurrentTileReads)
+{
+    const auto threadCount = ThreadPool::getDefaultThreadCount();
+    auto pHeightMap = loadTestHeightMap(glm::u32vec2{threadCount, 16U}, threadCount);
+
+    // Warm up the datasets and the file system cache, GDAL block cache is disabled to measure decoding:
+    GDALSetCacheMax64(0);
+    readAllTiles(*pHeightMap, threadCount);
+
+    const auto serialDuration = readAllTiles(*pHeightMap, 1U);
+    const auto concurrentDuration = readAllTiles(*pHeightMap, threadCount);
+    EXPECT_THAT(concurrentDuration.count(), Le(2.0 * serialDuration.count() / threadCount));
+
+    cout << fmt::format("Reading {} tiles of {}x{} samples:\n"
+                        "\t- 1 thread: {:.1f} ms\n"
+                        "\t- {} threads: {:.1f} ms ({:.1f}x faster)\n",
+                        threadCount * 16U, TestTileSize.x, TestTileSize.y, serialDuration.count(), threadCount,
+                        concurrentDuration.count(), serialDuration.count() / concurrentDuration.count());
+}
+
+TEST_F(GdalGeoTiffHeightMapTest, rebuildPyramidFromSeveralThreads)
+{
+    auto pHeightMap = loadWritableTestHeightMap(glm::u32vec2{4U, 3U}, 4U);
+    pHeightMap->rebuildPyramid();
+    ASSERT_THAT(pHeightMap->getLodCount(), Eq(3U));
+
+    // Samples of a level are the average of the 2x2 samples they cover in the level above:
+    auto pSampler = pHeightMap->getTileSampler(glm::u32vec2{0U, 0U}, 1U);
+    for (const auto& rPos : {glm::u32vec2{0U, 0U}, glm::u32vec2{37U, 121U}, glm::u32vec2{100U, 90U}})
+    {
+        const auto srcPos = rPos * 2U;
+        const auto expectedHeight = (getTestHeight(srcPos.x, srcPos.y) + getTestHeight(srcPos.x + 1U, srcPos.y) +
+                                     getTestHeight(srcPos.x, srcPos.y + 1U) +
+                                     getTestHeight(srcPos.x + 1U, srcPos.y + 1U)) /
+                                    4.0F;
+        EXPECT_THAT(pSampler->at(rPos.x, rPos.y), FloatNear(expectedHeight, 1.0e-3F));
+    }
+}
+
+TEST_F(GdalGeoTiffHeightMapTest, DISABLED_benchmarkRebuildPyramid)
+{
+    // Source tiles decoded through a single dataset, i.e. serialized, then through one dataset per thread:
+    const auto threadCount = ThreadPool::getDefaultThreadCount();
+    const auto measureRebuild = [&](uint32_t maxConcurrentReadCount) {
+        auto pHeightMap = loadWritableTestHeightMap(glm::u32vec2{16U, 16U}, maxConcurrentReadCount);
+        const auto start = chrono::steady_clock::now();
+        pHeightMap->rebuildPyramid();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start);
+    };
+    const auto serialReadDuration = measureRebuild(1U);
+    const auto concurrentReadDuration = measureRebuild(threadCount);
+    EXPECT_THAT(concurrentReadDuration.count(), Lt(serialReadDuration.count()));
+
+    cout << fmt::format("Rebuilding the pyramid of {}x{} tiles of {}x{} samples with {} threads:\n"
+                        "\t- serialized source reads: {:.1f} ms\n"
+                        "\t- concurrent source reads: {:.1f} ms ({:.1f}x faster)\n",
+                        16U, 16U, TestTileSize.x, TestTileSize.y, threadCount, serialReadDuration.count(),
+                        concurrentReadDuration.count(), serialReadDuration.count() / concurrentReadDuration.count());
+}
@@ -0,0 +1,53 @@
+#include "src/height_map_mosaic_index.h"
+
+#include <im3e/test_utils/glm.h>
+#include <im3e/test_utils/test_utils.h>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+auto createTestIndex()
+{
+    // 3 files of 100x100 samples side by side, a 4th one overlapping the first 2 and a 5th one below them:
+    return HeightMapMosaicIndex(
+        {
+            HeightMapMosaicFootprint{.offset = glm::u32vec2{0U, 0U}, .size = glm::u32vec2{100U, 100U}},
+            HeightMapMosaicFootprint{.offset = glm::u32vec2{100U, 0U}, .size = glm::u32vec2{100U, 100U}},
+            HeightMapMosaicFootprint{.offset = glm::u32vec2{200U, 0U}, .size = glm::u32vec2{100U, 100U}},
+            HeightMapMosaicFootprint{.offset = glm::u32vec2{50U, 50U}, .size = glm::u32vec2{100U, 100U}},
+            HeightMapMosaicFootprint{.offset = glm::u32vec2{0U, 150U}, .size = glm::u32vec2{100U, 50U}},
+        },
+        glm::u32vec2{100U, 100U});
+}
+
+}  // namespace
+
+TEST(HeightMapMosaicIndexTest, constructor)
+{
+    const auto index = createTestIndex();
+    EXPECT_THAT(index.getFootprintCount(), Eq(5U));
+    EXPECT_THAT(index.getSize(), Eq(glm::u32vec2{300U, 200U}));
+    EXPECT_THAT(index.getFootprint(3U).offset, Eq(glm::u32vec2{50U, 50U}));
+}
+
+TEST(HeightMapMosaicIndexTest, findIntersecting)
+{
+    const auto index = createTestIndex();
+    EXPECT_THAT(index.findIntersecting(glm::u32vec2{0U, 0U}, glm::u32vec2{10U, 10U}), ElementsAre(0U));
+    EXPECT_THAT(index.findIntersecting(glm::u32vec2{90U, 40U}, glm::u32vec2{20U, 20U}), ElementsAre(0U, 1U, 3U));
+    EXPECT_THAT(index.findIntersecting(glm::u32vec2{0U, 0U}, glm::u32vec2{300U, 200U}),
+                ElementsAre(0U, 1U, 2U, 3U, 4U));
+
+    // Footprints sharing a cell with the region without intersecting it are skipped:
+    EXPECT_THAT(index.findIntersecting(glm::u32vec2{150U, 100U}, glm::u32vec2{50U, 50U}), IsEmpty());
+    EXPECT_THAT(index.findIntersecting(glm::u32vec2{100U, 140U}, glm::u32vec2{50U, 20U}), ElementsAre(3U));
+}
+
+TEST(HeightMapMosaicIndexTest, findIntersectingOutsideOfMosaic)
+{
+    const auto index = createTestIndex();
+    EXPECT_THAT(index.findIntersecting(glm::u32vec2{300U, 0U}, glm::u32vec2{10U, 10U}), IsEmpty());
+    EXPECT_THAT(index.findIntersecting(glm::u32vec2{0U, 0U}, glm::u32vec2{0U, 10U}), IsEmpty());
+}
@@ -0,0 +1,68 @@
+#include "src/height_map_pyramid.h"
+
+#include <im3e/test_utils/test_utils.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace im3e;
+using namespace std;
+
+TEST(HeightMapPyramidTest, downsampleHeightsAveragesValidSamples)
+{
+    // clang-format off
+    const vector<float> srcHeights{
+        1.0F, 3.0F,   10.0F, 20.0F,   7.0F, 1.0F,
+        5.0F, 7.0F,   30.0F, 40.0F,   2.0F, 3.0F,
+
+        2.0F, 4.0F,   0.0F,  0.0F,    9.0F, 9.0F,
+        6.0F, 8.0F,   0.0F,  0.0F,    9.0F, 9.0F,
+    };
+    const vector<uint8_t> srcMask{
+        255U, 255U,   255U, 0U,       255U, 255U,
+        255U, 255U,   0U,   255U,     255U, 255U,
+
+        0U,   255U,   0U,   0U,       255U, 255U,
+        0U,   0U,     0U,   0U,       255U, 255U,
+    };
+    // clang-format on
+
+    const glm::u32vec2 dstSize{3U, 2U};
+    vector<float> dstHeights(dstSize.x * dstSize.y, -1.0F);
+    vector<uint8_t> dstMask(dstSize.x * dstSize.y, 128U);
+    downsampleHeights(srcHeights.data(), srcMask.data(), 6U, dstHeights.data(), dstMask.data(), dstSize);
+
+    EXPECT_THAT(dstHeights, ElementsAre(FloatEq(4.0F), FloatEq(25.0F), FloatEq(3.25F),  //
+                                        FloatEq(4.0F), FloatEq(0.0F), FloatEq(9.0F)));
+    EXPECT_THAT(dstMask, ElementsAre(255U, 255U, 255U, 255U, 0U, 255U));
+}
+
+TEST(HeightMapPyramidTest, downsampleHeightsIgnoresInvalidNaNSamples)
+{
+    const auto nan = numeric_limits<float>::quiet_NaN();
+    const vector<float> srcHeights{nan, 2.0F, nan, nan, nan, 4.0F, nan, nan};
+    const vector<uint8_t> srcMask{0U, 255U, 0U, 0U, 0U, 255U, 0U, 0U};
+
+    const glm::u32vec2 dstSize{2U, 1U};
+    vector<float> dstHeights(2U);
+    vector<uint8_t> dstMask(2U);
+    downsampleHeights(srcHeights.data(), srcMask.data(), 4U, dstHeights.data(), dstMask.data(), dstSize);
+
+    EXPECT_THAT(dstHeights, ElementsAre(FloatEq(3.0F), FloatEq(0.0F)));
+    EXPECT_THAT(dstMask, ElementsAre(255U, 0U));
+}
+
+TEST(HeightMapPyramidTest, downsampleHeightsUsesSourceStride)
+{
+    // Last column of each row is padding that must not be read:
+    const vector<float> srcHeights{1.0F, 2.0F, 100.0F, 3.0F, 4.0F, 100.0F};
+    const vector<uint8_t> srcMask{255U, 255U, 255U, 255U, 255U, 255U};
+
+    float dstHeight{};
+    uint8_t dstMask{};
+    downsampleHeights(srcHeights.data(), srcMask.data(), 3U, &dstHeight, &dstMask, glm::u32vec2{1U, 1U});
+
+    EXPECT_THAT(dstHeight, FloatEq(2.5F));
+    EXPECT_THAT(dstMask, Eq(255U));
+}
@@ -1,4 +1,5 @@
 #include "geo.h"
+#include "src/height_map_tile_ranges.h"
 
 #include <im3e/mock/mock_height_map.h>
 #include <im3e/test_utils/glm.h>
@@ -6,36 +7,43 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numbers>
+#include <memory>
+#include <utility>
+
 using namespace im3e;
 
 namespace {
 
-void expectTreesEqual(HeightMapQuadTreeNode& rParent, HeightMapQuadTreeNode& rExpectedParent)
+void expectNodesEqual(const HeightMapQuadTree& rTree, const std::vector<HeightMapQuadTreeNode>& rExpectedNodes)
 {
-    const auto errorMessage = fmt::format("Tree Node at Tile ID ({}, {}, {})", rExpectedParent.tileID.x,
-                                          rExpectedParent.tileID.y, rExpectedParent.tileID.z);
-
-    EXPECT_THAT(rParent.tileID, Eq(rExpectedParent.tileID)) << errorMessage;
-    EXPECT_THAT(rParent.minWorldPos, FloatEq(rExpectedParent.minWorldPos)) << errorMessage;
-    EXPECT_THAT(rParent.maxWorldPos, FloatEq(rExpectedParent.maxWorldPos)) << errorMessage;
-    for (auto i = 0U; i < 4U; i++)
+    ASSERT_THAT(rTree.getNodeCount(), Eq(rExpectedNodes.size()));
+    for (uint32_t i = 0U; i < rTree.getNodeCount(); i++)
     {
-        const auto childErrorMessage = fmt::format("Child {} of {}", i, errorMessage);
-        if (!rExpectedParent.pChildren[i])
-        {
-            EXPECT_THAT(rParent.pChildren[i], IsNull()) << childErrorMessage;
-        }
-        else
+        const auto node = rTree.getNode(i);
+        const auto& rExpectedNode = rExpectedNodes[i];
+        const auto errorMessage = fmt::format("Tree Node {} at Tile ID ({}, {}, {})", i, rExpectedNode.tileID.x,
+                                              rExpectedNode.tileID.y, rExpectedNode.tileID.z);
+
+        EXPECT_THAT(node.tileID, Eq(rExpectedNode.tileID)) << errorMessage;
+        if (rExpectedNode.minWorldPos.y > rExpectedNode.maxWorldPos.y)
         {
-            ASSERT_THAT(rParent.pChildren[i], NotNull()) << childErrorMessage;
-            expectTreesEqual(*rParent.pChildren[i], *rExpectedParent.pChildren[i]);
+            EXPECT_THAT(node.minWorldPos.y > node.maxWorldPos.y, IsTrue()) << errorMessage << " should be empty";
+            continue;
         }
+        EXPECT_THAT(node.minWorldPos, FloatEq(rExpectedNode.minWorldPos)) << errorMessage;
+        EXPECT_THAT(node.maxWorldPos, FloatEq(rExpectedNode.maxWorldPos)) << errorMessage;
     }
 }
 
 }  // namespace
 
-TEST(HeightMapQuadTreeTest, generateHeightMapQuadTree)
+TEST(HeightMapQuadTreeTest, constructor)
 {
     constexpr glm::u32vec2 TestSize{520U, 1050U};
     constexpr glm::u32vec2 TestTileSize{512U, 512U};
@@ -43,66 +51,29 @@ TEST(HeightMapQuadTreeTest, generateHeightMapQuadTree)
     constexpr auto TestMinHeight{-20.0F};
     constexpr auto TestMaxHeight{4809.0F};
 
-    // Expected Level 2: a single tile
-    auto pExpectedRoot = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-        .tileID = TileID{0U, 0U, 2U},
-        .minWorldPos = glm::vec3{0.0F, TestMinHeight, 0.0F},
-        .maxWorldPos = glm::vec3{520.0F, TestMaxHeight, 1050.0F},
-    });
+    // Children of each node are grouped by 4, with empty nodes for the children outside of the height map:
+    const glm::vec3 EmptyPos{0.0F, EmptyHeightRange.x, 0.0F};
+    const glm::vec3 EmptyMaxPos{0.0F, EmptyHeightRange.y, 0.0F};
+    const std::vector<HeightMapQuadTreeNode> expectedNodes{
+        // Level 2: a single tile
+        {TileID{0U, 0U, 2U}, glm::vec3{0.0F, TestMinHeight, 0.0F}, glm::vec3{520.0F, TestMaxHeight, 1050.0F}},
 
-    // Expected Level 1: 2x1 tiles
-    {
-        pExpectedRoot->pChildren[0] = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-            .tileID = TileID{0U, 0U, 1U},
-            .minWorldPos = glm::vec3{0.0F, TestMinHeight, 0.0F},
-            .maxWorldPos = glm::vec3{520.0F, TestMaxHeight, 1024.0F},
-        });
-        pExpectedRoot->pChildren[1] = nullptr;
-        pExpectedRoot->pChildren[2] = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-            .tileID = TileID{0U, 1U, 1U},
-            .minWorldPos = glm::vec3{0.0F, TestMinHeight, 1024.0F},
-            .maxWorldPos = glm::vec3{520.0F, TestMaxHeight, 1050.0F},
-        });
-        pExpectedRoot->pChildren[3] = nullptr;
-    }
+        // Level 1: 1x2 tiles
+        {TileID{0U, 0U, 1U}, glm::vec3{0.0F, TestMinHeight, 0.0F}, glm::vec3{520.0F, TestMaxHeight, 1024.0F}},
+        {TileID{1U, 0U, 1U}, EmptyPos, EmptyMaxPos},
+        {TileID{0U, 1U, 1U}, glm::vec3{0.0F, TestMinHeight, 1024.0F}, glm::vec3{520.0F, TestMaxHeight, 1050.0F}},
+        {TileID{1U, 1U, 1U}, EmptyPos, EmptyMaxPos},
 
-    // Expected Level 0: 2x3 tiles
-    {
-        auto pChild0L1 = pExpectedRoot->pChildren[0];
-        pChild0L1->pChildren[0] = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-            .tileID = TileID{0U, 0U, 0U},
-            .minWorldPos = glm::vec3{0.0F, TestMinHeight, 0.0F},
-            .maxWorldPos = glm::vec3{512.0F, TestMaxHeight, 512.0F},
-        });
-        pChild0L1->pChildren[1] = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-            .tileID = TileID{1U, 0U, 0U},
-            .minWorldPos = glm::vec3{512.0F, TestMinHeight, 0.0F},
-            .maxWorldPos = glm::vec3{520.0F, TestMaxHeight, 512.0F},
-        });
-        pChild0L1->pChildren[2] = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-            .tileID = TileID{0U, 1U, 0U},
-            .minWorldPos = glm::vec3{0.0F, TestMinHeight, 512.0F},
-            .maxWorldPos = glm::vec3{512.0F, TestMaxHeight, 1024.0F},
-        });
-        pChild0L1->pChildren[3] = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-            .tileID = TileID{1U, 1U, 0U},
-            .minWorldPos = glm::vec3{512.0F, TestMinHeight, 512.0F},
-            .maxWorldPos = glm::vec3{520.0F, TestMaxHeight, 1024.0F},
-        });
-        auto pChild1L1 = pExpectedRoot->pChildren[2];
-        pChild1L1->pChildren[0] = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-            .tileID = TileID{0U, 2U, 0U},
-            .minWorldPos = glm::vec3{0.0F, TestMinHeight, 1024.0F},
-            .maxWorldPos = glm::vec3{512.0F, TestMaxHeight, 1050.0F},
-        });
-        pChild1L1->pChildren[1] = std::make_shared<HeightMapQuadTreeNode>(HeightMapQuadTreeNode{
-            .tileID = TileID{1U, 2U, 0U},
-            .minWorldPos = glm::vec3{512.0F, TestMinHeight, 1024.0F},
-            .maxWorldPos = glm::vec3{520.0F, TestMaxHeight, 1050.0F},
-        });
-        pChild1L1->pChildren[2] = nullptr;
-        pChild1L1->pChildren[3] = nullptr;
-    }
+        // Level 0: 2x3 tiles
+        {TileID{0U, 0U, 0U}, glm::vec3{0.0F, TestMinHeight, 0.0F}, glm::vec3{512.0F, TestMaxHeight, 512.0F}},
+        {TileID{1U, 0U, 0U}, glm::vec3{512.0F, TestMinHeight, 0.0F}, glm::vec3{520.0F, TestMaxHeight, 512.0F}},
+        {TileID{0U, 1U, 0U}, glm::vec3{0.0F, TestMinHeight, 512.0F}, glm::vec3{512.0F, TestMaxHeight, 1024.0F}},
+        {TileID{1U, 1U, 0U}, glm::vec3{512.0F, TestMinHeight, 512.0F}, glm::vec3{520.0F, TestMaxHeight, 1024.0F}},
+        {TileID{0U, 2U, 0U}, glm::vec3{0.0F, TestMinHeight, 1024.0F}, glm::vec3{512.0F, TestMaxHeight, 1050.0F}},
+        {TileID{1U, 2U, 0U}, glm::vec3{512.0F, TestMinHeight, 1024.0F}, glm::vec3{520.0F, TestMaxHeight, 1050.0F}},
+        {TileID{0U, 3U, 0U}, EmptyPos, EmptyMaxPos},
+        {TileID{1U, 3U, 0U}, EmptyPos, EmptyMaxPos},
+    };
 
     StrictMock<MockHeightMap> heightMap;
     EXPECT_CALL(heightMap, getSize()).WillRepeatedly(Return(TestSize));
@@ -110,10 +81,15 @@ TEST(HeightMapQuadTreeTest, generateHeightMapQuadTree)
     EXPECT_CALL(heightMap, getLodCount()).WillRepeatedly(Return(TestLodCount));
     EXPECT_CALL(heightMap, getMinHeight()).WillRepeatedly(Return(TestMinHeight));
     EXPECT_CALL(heightMap, getMaxHeight()).WillRepeatedly(Return(TestMaxHeight));
+    EXPECT_CALL(heightMap, getTileHeightRange(_)).WillRepeatedly(Return(glm::vec2{TestMinHeight, TestMaxHeight}));
 
-    const auto pTreeRoot = generateHeightMapQuadTree(heightMap);
-    ASSERT_THAT(pTreeRoot, NotNull());
-    expectTreesEqual(*pTreeRoot, *pExpectedRoot);
+    HeightMapQuadTree tree(heightMap);
+    expectNodesEqual(tree, expectedNodes);
+    EXPECT_THAT(tree.getFirstChildIndex(0U), Eq(1U));
+    EXPECT_THAT(tree.getFirstChildIndex(1U), Eq(5U));
+    EXPECT_THAT(tree.getFirstChildIndex(2U), Eq(0U));
+    EXPECT_THAT(tree.getFirstChildIndex(3U), Eq(9U));
+    EXPECT_THAT(tree.getFirstChildIndex(5U), Eq(0U));
 }
 
 TEST(HeightMapQuadTreeTest, findVisible)
@@ -130,6 +106,7 @@ TEST(HeightMapQuadTreeTest, findVisible)
     EXPECT_CALL(heightMap, getLodCount()).WillRepeatedly(Return(TestLodCount));
     EXPECT_CALL(heightMap, getMinHeight()).WillRepeatedly(Return(TestMinHeight));
     EXPECT_CALL(heightMap, getMaxHeight()).WillRepeatedly(Return(TestMaxHeight));
+    EXPECT_CALL(heightMap, getTileHeightRange(_)).WillRepeatedly(Return(glm::vec2{TestMinHeight, TestMaxHeight}));
 
     const ViewFrustum::PerspectiveConfig viewConfig{
         .near = 0.1F,
@@ -140,12 +117,438 @@ TEST(HeightMapQuadTreeTest, findVisible)
         .right = glm::vec3{1.0F, 0.0F, 0.0F},
     };
 
-    const auto pTreeRoot = generateHeightMapQuadTree(heightMap);
-    EXPECT_THAT(pTreeRoot->findVisible(viewConfig, 2U), ContainerEq(std::vector<TileID>{TileID{0U, 0U, 2U}}));
-    EXPECT_THAT(pTreeRoot->findVisible(viewConfig, 0U), ContainerEq(std::vector<TileID>{
-                                                            TileID{0U, 0U, 0U},
-                                                            TileID{1U, 0U, 0U},
-                                                            TileID{0U, 1U, 0U},
-                                                            TileID{1U, 1U, 0U},
-                                                        }));
-}
\ No newline at end of file
+    HeightMapQuadTree tree(heightMap);
+    EXPECT_THAT(tree.findVisible(viewConfig, 2U), ContainerEq(std::vector<TileID>{TileID{0U, 0U, 2U}}));
+    EXPECT_THAT(tree.findVisible(viewConfig, 0U), ContainerEq(std::vector<TileID>{
+                                                       TileID{0U, 0U, 0U},
+                                                       TileID{1U, 0U, 0U},
+                                                       TileID{0U, 1U, 0U},
+                                                       TileID{1U, 1U, 0U},
+                                                   }));
+    EXPECT_THROW(tree.findVisible(viewConfig, 3U), std::invalid_argument);
+}
+
+namespace {
+
+constexpr glm::u32vec2 TestTwoTilesSize{1024U, 512U};
+constexpr glm::u32vec2 TestTwoTilesTileSize{512U, 512U};
+
+void setTwoTilesExpectations(StrictMock<MockHeightMap>& rHeightMap, const glm::vec2& rTile0Range,
+                             const glm::vec2& rTile1Range)
+{
+    EXPECT_CALL(rHeightMap, getSize()).WillRepeatedly(Return(TestTwoTilesSize));
+    EXPECT_CALL(rHeightMap, getTileSize()).WillRepeatedly(Return(TestTwoTilesTileSize));
+    EXPECT_CALL(rHeightMap, getLodCount()).WillRepeatedly(Return(2U));
+    EXPECT_CALL(rHeightMap, getMinHeight()).WillRepeatedly(Return(0.0F));
+    EXPECT_CALL(rHeightMap, getMaxHeight()).WillRepeatedly(Return(1000.0F));
+    EXPECT_CALL(rHeightMap, getTileHeightRange(Eq(TileID{0U, 0U, 0U}))).WillRepeatedly(Return(rTile0Range));
+    EXPECT_CALL(rHeightMap, getTileHeightRange(Eq(TileID{1U, 0U, 0U}))).WillRepeatedly(Return(rTile1Range));
+}
+
+}  // namespace
+
+TEST(HeightMapQuadTreeTest, constructorUsesTileHeightRanges)
+{
+    StrictMock<MockHeightMap> heightMap;
+    setTwoTilesExpectations(heightMap, glm::vec2{0.0F, 10.0F}, glm::vec2{100.0F, 200.0F});
+
+    HeightMapQuadTree tree(heightMap);
+    ASSERT_THAT(tree.getNodeCount(), Eq(5U));
+    EXPECT_THAT(tree.getNode(0U).minWorldPos, FloatEq(glm::vec3{0.0F, 0.0F, 0.0F}));
+    EXPECT_THAT(tree.getNode(0U).maxWorldPos, FloatEq(glm::vec3{1024.0F, 200.0F, 512.0F}));
+
+    EXPECT_THAT(tree.getNode(1U).minWorldPos, FloatEq(glm::vec3{0.0F, 0.0F, 0.0F}));
+    EXPECT_THAT(tree.getNode(1U).maxWorldPos, FloatEq(glm::vec3{512.0F, 10.0F, 512.0F}));
+
+    EXPECT_THAT(tree.getNode(2U).minWorldPos, FloatEq(glm::vec3{512.0F, 100.0F, 0.0F}));
+    EXPECT_THAT(tree.getNode(2U).maxWorldPos, FloatEq(glm::vec3{1024.0F, 200.0F, 512.0F}));
+}
+
+TEST(HeightMapQuadTreeTest, findVisibleCullsTilesOutsideOfTheirHeightRange)
+{
+    StrictMock<MockHeightMap> heightMap;
+    setTwoTilesExpectations(heightMap, glm::vec2{0.0F, 10.0F}, glm::vec2{100.0F, 200.0F});
+
+    // Looking down with a far plane that does not reach the heights of the first tile:
+    const ViewFrustum::PerspectiveConfig viewConfig{
+        .near = 0.1F,
+        .far = 950.0F,
+        .position = glm::vec3{512.0F, 1000.0F, 256.0F},
+        .direction = glm::vec3{0.0F, -1.0F, 0.0F},
+        .up = glm::vec3{0.0F, 0.0F, -1.0F},
+        .right = glm::vec3{1.0F, 0.0F, 0.0F},
+    };
+
+    HeightMapQuadTree tree(heightMap);
+    EXPECT_THAT(tree.findVisible(viewConfig, 1U), ContainerEq(std::vector<TileID>{TileID{0U, 0U, 1U}}));
+    EXPECT_THAT(tree.findVisible(viewConfig, 0U), ContainerEq(std::vector<TileID>{TileID{1U, 0U, 0U}}));
+}
+
+TEST(HeightMapQuadTreeTest, findVisibleSkipsTilesWithoutValidSample)
+{
+    StrictMock<MockHeightMap> heightMap;
+    setTwoTilesExpectations(heightMap, glm::vec2{0.0F, 10.0F}, EmptyHeightRange);
+
+    const ViewFrustum::PerspectiveConfig viewConfig{
+        .near = 0.1F,
+        .far = 10000.0F,
+        .position = glm::vec3{512.0F, 1000.0F, 256.0F},
+        .direction = glm::vec3{0.0F, -1.0F, 0.0F},
+        .up = glm::vec3{0.0F, 0.0F, -1.0F},
+        .right = glm::vec3{1.0F, 0.0F, 0.0F},
+    };
+
+    HeightMapQuadTree tree(heightMap);
+    EXPECT_THAT(tree.getNode(0U).maxWorldPos.y, FloatEq(10.0F));
+    EXPECT_THAT(tree.findVisible(viewConfig, 0U), ContainerEq(std::vector<TileID>{TileID{0U, 0U, 0U}}));
+}
+
+namespace {
+
+/// @brief Quad tree with heap-allocated nodes, as used before HeightMapQuadTree. Kept as a reference for the results
+/// and the performance of the flat quad tree.
+struct ReferenceQuadTreeNode
+{
+    TileID tileID;
+    glm::vec3 minWorldPos;
+    glm::vec3 maxWorldPos;
+    std::array<std::shared_ptr<ReferenceQuadTreeNode>, 4U> pChildren;
+};
+
+void generateReferenceChildren(const IHeightMap& rHeightMap, ReferenceQuadTreeNode& rParentNode,
+                               const glm::vec3& rParentTileWorldSize)
+{
+    if (rParentNode.tileID.z == 0U)
+    {
+        const auto heightRange = rHeightMap.getTileHeightRange(rParentNode.tileID);
+        rParentNode.minWorldPos.y = heightRange.x;
+        rParentNode.maxWorldPos.y = heightRange.y;
+        return;
+    }
+    const auto childLod = rParentNode.tileID.z - 1U;
+    const auto childTileWorldSize = glm::vec3{glm::ceil(rParentTileWorldSize.x / 2.0F), rParentTileWorldSize.y,
+                                              glm::ceil(rParentTileWorldSize.z / 2.0F)};
+
+    auto heightRange = EmptyHeightRange;
+    for (uint16_t y = 0U; y < 2U; y++)
+    {
+        for (uint16_t x = 0U; x < 2U; x++)
+        {
+            const auto childMinWorldPos = rParentNode.minWorldPos + glm::vec3{x, 0.0F, y} * childTileWorldSize;
+            const auto childMaxWorldPos = glm::min(childMinWorldPos + childTileWorldSize, rParentNode.maxWorldPos);
+            if (childMaxWorldPos.x <= childMinWorldPos.x || childMaxWorldPos.z <= childMinWorldPos.z)
+            {
+                continue;
+            }
+            auto pChildNode = std::make_shared<ReferenceQuadTreeNode>(ReferenceQuadTreeNode{
+                .tileID = TileID{uint16_t{2U} * rParentNode.tileID.xy() + glm::u16vec2{x, y}, childLod},
+                .minWorldPos = childMinWorldPos,
+                .maxWorldPos = childMaxWorldPos,
+            });
+            rParentNode.pChildren[y * 2U + x] = pChildNode;
+            generateReferenceChildren(rHeightMap, *pChildNode, childTileWorldSize);
+            heightRange = glm::vec2{std::min(heightRange.x, pChildNode->minWorldPos.y),
+                                    std::max(heightRange.y, pChildNode->maxWorldPos.y)};
+        }
+    }
+    rParentNode.minWorldPos.y = heightRange.x;
+    rParentNode.maxWorldPos.y = heightRange.y;
+}
+
+auto generateReferenceQuadTree(const IHeightMap& rHeightMap)
+{
+    const auto size = rHeightMap.getSize();
+    const auto tileSize = rHeightMap.getTileSize();
+    const auto maxTileCount = std::ceil(std::max(static_cast<float>(size.x) / static_cast<float>(tileSize.x),
+                                                 static_cast<float>(size.y) / static_cast<float>(tileSize.y)));
+    const auto lodCount = static_cast<uint32_t>(std::ceil(std::log2(maxTileCount))) + 1U;
+
+    auto pRoot = std::make_shared<ReferenceQuadTreeNode>(ReferenceQuadTreeNode{
+        .tileID = TileID{0U, 0U, lodCount - 1U},
+        .minWorldPos = glm::vec3{0.0F, rHeightMap.getMinHeight(), 0.0F},
+        .maxWorldPos = glm::vec3{size.x, rHeightMap.getMaxHeight(), size.y},
+    });
+    const auto tileSizeAtMaxLevel = glm::vec2{tileSize} * static_cast<float>(std::pow(2U, pRoot->tileID.z));
+    generateReferenceChildren(rHeightMap, *pRoot,
+                              glm::vec3{tileSizeAtMaxLevel.x, pRoot->maxWorldPos.y - pRoot->minWorldPos.y,
+                                        tileSizeAtMaxLevel.y});
+    return pRoot;
+}
+
+void findVisibleInReferenceQuadTree(const ReferenceQuadTreeNode& rNode, const ViewFrustum& rViewFrustum,
+                                    uint32_t lod, std::vector<TileID>& rVisibleTileIDs)
+{
+    if (rNode.minWorldPos.y > rNode.maxWorldPos.y || !rViewFrustum.isAABBInside(rNode.minWorldPos, rNode.maxWorldPos))
+    {
+        return;
+    }
+    if (rNode.tileID.z == lod)
+    {
+        rVisibleTileIDs.emplace_back(rNode.tileID);
+        return;
+    }
+    for (const auto& rpChild : rNode.pChildren)
+    {
+        if (rpChild)
+        {
+            findVisibleInReferenceQuadTree(*rpChild, rViewFrustum, lod, rVisibleTileIDs);
+        }
+    }
+}
+
+void setLargeHeightMapExpectations(NiceMock<MockHeightMap>& rHeightMap, const glm::u32vec2& rTileCount)
+{
+    constexpr glm::u32vec2 TileSize{256U, 256U};
+    ON_CALL(rHeightMap, getSize()).WillByDefault(Return(rTileCount * TileSize - glm::u32vec2{100U, 30U}));
+    ON_CALL(rHeightMap, getTileSize()).WillByDefault(Return(TileSize));
+    ON_CALL(rHeightMap, getLodCount()).WillByDefault(Return(
+        static_cast<uint32_t>(std::ceil(std::log2(std::max(rTileCount.x, rTileCount.y)))) + 1U));
+    ON_CALL(rHeightMap, getMinHeight()).WillByDefault(Return(0.0F));
+    ON_CALL(rHeightMap, getMaxHeight()).WillByDefault(Return(2000.0F));
+    ON_CALL(rHeightMap, getTileHeightRange(_)).WillByDefault(Invoke([](const TileID& rTileID) {
+        // Rolling hills, with a hole every few tiles:
+        if ((rTileID.x * 7U + rTileID.y * 3U) % 23U == 0U)
+        {
+            return EmptyHeightRange;
+        }
+        const auto base = 500.0F + 400.0F * std::sin(rTileID.x * 0.1F) * std::cos(rTileID.y * 0.07F);
+        return glm::vec2{base, base + 100.0F + static_cast<float>((rTileID.x + rTileID.y) % 5U) * 50.0F};
+    }));
+}
+
+auto getTestViewConfigs(const glm::vec2& rWorldSize)
+{
+    std::vector<ViewFrustum::PerspectiveConfig> viewConfigs;
+    for (const auto& rRelativePos : {glm::vec2{0.1F, 0.2F}, glm::vec2{0.5F, 0.5F}, glm::vec2{0.9F, 0.7F}})
+    {
+        const glm::vec3 position{rRelativePos.x * rWorldSize.x, 3000.0F, rRelativePos.y * rWorldSize.y};
+
+        // Looking down, then tilted towards the horizon:
+        viewConfigs.emplace_back(ViewFrustum::PerspectiveConfig{
+            .far = 20000.0F,
+            .position = position,
+            .direction = glm::vec3{0.0F, -1.0F, 0.0F},
+            .up = glm::vec3{0.0F, 0.0F, -1.0F},
+            .right = glm::vec3{1.0F, 0.0F, 0.0F},
+        });
+        viewConfigs.emplace_back(ViewFrustum::PerspectiveConfig{
+            .far = 50000.0F,
+            .position = position,
+            .direction = glm::normalize(glm::vec3{0.0F, -1.0F, -2.0F}),
+            .up = glm::normalize(glm::vec3{0.0F, 2.0F, -1.0F}),
+            .right = glm::vec3{1.0F, 0.0F, 0.0F},
+        });
+    }
+    return viewConfigs;
+}
+
+}  // namespace
+
+TEST(HeightMapQuadTreeTest, findVisibleMatchesReferenceQuadTree)
+{
+    const glm::u32vec2 tileCount{37U, 22U};
+    NiceMock<MockHeightMap> heightMap;
+    setLargeHeightMapExpectations(heightMap, tileCount);
+
+    HeightMapQuadTree tree(heightMap);
+    const auto pReferenceRoot = generateReferenceQuadTree(heightMap);
+    for (const auto& rViewConfig : getTestViewConfigs(glm::vec2{heightMap.getSize()}))
+    {
+        for (uint32_t lod = 0U; lod <= pReferenceRoot->tileID.z; lod++)
+        {
+            std::vector<TileID> expectedTileIDs;
+            findVisibleInReferenceQuadTree(*pReferenceRoot, rViewConfig, lod, expectedTileIDs);
+            EXPECT_THAT(tree.findVisible(rViewConfig, lod), ContainerEq(expectedTileIDs))
+                << fmt::format("lod {}, position ({}; {}; {})", lod, rViewConfig.position.x, rViewConfig.position.y,
+                               rViewConfig.position.z);
+        }
+    }
+}
+
+/// Benchmark comparing the traversal of the flat quad tree with the reference one on a height map of 100k tiles.
+/// Disabled by default, run with --gtest_also_run_disabled_tests --gtest_filter=*benchmarkFindVisible on an optimized
+/// build.
+TEST(HeightMapQuadTreeTest, DISABLED_benchmarkFindVisible)
+{
+    const glm::u32vec2 tileCount{400U, 250U};
+    NiceMock<MockHeightMap> heightMap;
+    setLargeHeightMapExpectations(heightMap, tileCount);
+
+    HeightMapQuadTree tree(heightMap);
+    const auto pReferenceRoot = generateReferenceQuadTree(heightMap);
+
+    std::vector<ViewFrustum> viewFrustums;
+    for (const auto& rViewConfig : getTestViewConfigs(glm::vec2{heightMap.getSize()}))
+    {
+        viewFrustums.emplace_back(rViewConfig);
+    }
+
+    constexpr uint32_t IterationCount = 100U;
+    auto measure = [&](auto findVisible) {
+        size_t visibleTileCount{};
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0U; i < IterationCount; i++)
+        {
+            for (const auto& rViewFrustum : viewFrustums)
+            {
+                visibleTileCount += findVisible(rViewFrustum).size();
+            }
+        }
+        const auto duration = std::chrono::steady_clock::now() - start;
+        const auto traversalCount = IterationCount * viewFrustums.size();
+        return std::pair{std::chrono::duration<double, std::micro>(duration).count() / traversalCount,
+                         visibleTileCount / traversalCount};
+    };
+
+    const auto [flatDuration, flatVisibleCount] = measure([&](const ViewFrustum& rViewFrustum) {
+        return tree.findVisible(rViewFrustum, 0U);
+    });
+    const auto [referenceDuration, referenceVisibleCount] = measure([&](const ViewFrustum& rViewFrustum) {
+        std::vector<TileID> visibleTileIDs;
+        findVisibleInReferenceQuadTree(*pReferenceRoot, rViewFrustum, 0U, visibleTileIDs);
+        return visibleTileIDs;
+    });
+    EXPECT_THAT(flatVisibleCount, Eq(referenceVisibleCount));
+
+    std::cout << fmt::format("findVisible over {} tiles, {} visible on average:\n"
+                             "\t- flat quad tree: {:.1f} us\n"
+                             "\t- reference quad tree: {:.1f} us\n",
+                             tileCount.x * tileCount.y, flatVisibleCount, flatDuration, referenceDuration);
+}
+
+namespace {
+
+auto isAncestor(const TileID& rAncestorTileID, const TileID& rTileID)
+{
+    if (rAncestorTileID.z <= rTileID.z)
+    {
+        return false;
+    }
+    const auto scale = static_cast<uint16_t>(1U << (rAncestorTileID.z - rTileID.z));
+    return rTileID.xy() / scale == rAncestorTileID.xy();
+}
+
+auto createObliqueViewFrustum()
+{
+    // Close to the ground at a corner of the height map, looking across it:
+    const auto direction = glm::normalize(glm::vec3{1.0F, -0.5F, 1.0F});
+    const auto right = glm::normalize(glm::cross(direction, glm::vec3{0.0F, 1.0F, 0.0F}));
+    return ViewFrustum{ViewFrustum::PerspectiveConfig{
+        .far = 50000.0F,
+        .position = glm::vec3{200.0F, 1000.0F, 200.0F},
+        .direction = direction,
+        .up = glm::normalize(glm::cross(right, direction)),
+        .right = right,
+    }};
+}
+
+auto createObliqueSelectionConfig()
+{
+    return HeightMapTileSelectionConfig{
+        .viewPosition = glm::vec3{200.0F, 1000.0F, 200.0F},
+        .projectionScale = 1000.0F / (2.0F * std::tan(std::numbers::pi_v<float> / 6.0F)),
+        .maxScreenSpaceError = 2.0F,
+        .maxTileCount = 1000U,
+    };
+}
+
+}  // namespace
+
+TEST(HeightMapQuadTreeTest, selectTilesFromMixedLevelsOfDetails)
+{
+    NiceMock<MockHeightMap> heightMap;
+    setLargeHeightMapExpectations(heightMap, glm::u32vec2{32U, 32U});
+    HeightMapQuadTree tree(heightMap);
+
+    const auto selection = tree.selectTiles(createObliqueViewFrustum(), createObliqueSelectionConfig());
+    EXPECT_THAT(selection.missingTileIDs, IsEmpty());
+    ASSERT_THAT(selection.tileIDs, Not(IsEmpty()));
+
+    // Tiles close to the camera are refined more than distant ones:
+    EXPECT_THAT(selection.tileIDs, Contains(Field(&TileID::z, Eq(0U))));
+    EXPECT_THAT(selection.tileIDs, Contains(Field(&TileID::z, Ge(2U))));
+
+    // Selected tiles never overlap:
+    for (const auto& rTileID : selection.tileIDs)
+    {
+        for (const auto& rOtherTileID : selection.tileIDs)
+        {
+            EXPECT_THAT(isAncestor(rTileID, rOtherTileID), IsFalse());
+        }
+    }
+}
+
+TEST(HeightMapQuadTreeTest, selectTilesWithinTileBudget)
+{
+    NiceMock<MockHeightMap> heightMap;
+    setLargeHeightMapExpectations(heightMap, glm::u32vec2{32U, 32U});
+    HeightMapQuadTree tree(heightMap);
+
+    auto config = createObliqueSelectionConfig();
+    const auto unboundedSelection = tree.selectTiles(createObliqueViewFrustum(), config);
+    ASSERT_THAT(unboundedSelection.tileIDs.size(), Gt(10U));
+
+    config.maxTileCount = 10U;
+    const auto selection = tree.selectTiles(createObliqueViewFrustum(), config);
+    EXPECT_THAT(selection.tileIDs.size(), AllOf(Gt(0U), Le(10U)));
+}
+
+TEST(HeightMapQuadTreeTest, selectTilesKeepsParentsWhileChildrenAreNotReady)
+{
+    NiceMock<MockHeightMap> heightMap;
+    setLargeHeightMapExpectations(heightMap, glm::u32vec2{32U, 32U});
+    HeightMapQuadTree tree(heightMap);
+
+    auto config = createObliqueSelectionConfig();
+    config.isTileReady = [](const TileID& rTileID) { return rTileID.z > 0U; };
+    const auto selection = tree.selectTiles(createObliqueViewFrustum(), config);
+
+    EXPECT_THAT(selection.tileIDs, Each(Field(&TileID::z, Gt(0U))));
+    ASSERT_THAT(selection.missingTileIDs, Not(IsEmpty()));
+    for (const auto& rMissingTileID : selection.missingTileIDs)
+    {
+        EXPECT_THAT(rMissingTileID.z, Eq(0U));
+        const TileID parentTileID{rMissingTileID.xy() / uint16_t{2U}, 1U};
+        EXPECT_THAT(selection.tileIDs, Contains(parentTileID));
+    }
+}
+
+TEST(HeightMapQuadTreeTest, selectTilesReturnsRootWithLargeScreenSpaceError)
+{
+    NiceMock<MockHeightMap> heightMap;
+    setLargeHeightMapExpectations(heightMap, glm::u32vec2{32U, 32U});
+    HeightMapQuadTree tree(heightMap);
+
+    auto config = createObliqueSelectionConfig();
+    config.maxScreenSpaceError = 1.0e6F;
+    const auto selection = tree.selectTiles(createObliqueViewFrustum(), config);
+    EXPECT_THAT(selection.tileIDs, ContainerEq(std::vector<TileID>{tree.getNode(0U).tileID}));
+}
+
+TEST(HeightMapQuadTreeTest, selectTilesOnlyFromLevelsOfDetailsOfTheHeightMap)
+{
+    // Height map without overviews, e.g. a GeoTIFF file whose pyramid was not built:
+    NiceMock<MockHeightMap> heightMap;
+    setLargeHeightMapExpectations(heightMap, glm::u32vec2{8U, 8U});
+    ON_CALL(heightMap, getLodCount()).WillByDefault(Return(1U));
+    HeightMapQuadTree tree(heightMap);
+    ASSERT_THAT(tree.getNode(0U).tileID.z, Gt(0U));
+
+    auto config = createObliqueSelectionConfig();
+    config.maxScreenSpaceError = 1.0e6F;
+    config.maxTileCount = 4U;
+    config.isTileReady = [](const TileID&) { return false; };
+    const auto selection = tree.selectTiles(createObliqueViewFrustum(), config);
+    ASSERT_THAT(selection.tileIDs, Not(IsEmpty()));
+    EXPECT_THAT(selection.tileIDs, Each(Field(&TileID::z, Eq(0U))));
+    EXPECT_THAT(selection.missingTileIDs, Each(Field(&TileID::z, Eq(0U))));
+
+    // The coarsest level of details provided by the height map is selected when the error allows it:
+    ON_CALL(heightMap, getLodCount()).WillByDefault(Return(2U));
+    HeightMapQuadTree twoLodTree(heightMap);
+    config.maxTileCount = 1000U;
+    config.isTileReady = [](const TileID&) { return true; };
+    const auto twoLodSelection = twoLodTree.selectTiles(createObliqueViewFrustum(), config);
+    ASSERT_THAT(twoLodSelection.tileIDs, Not(IsEmpty()));
+    EXPECT_THAT(twoLodSelection.tileIDs, Each(Field(&TileID::z, Eq(1U))));
+}
@@ -0,0 +1,86 @@
+#include "src/height_map_tile.h"
+
+#include <im3e/test_utils/test_utils.h>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+auto createTestTile()
+{
+    // 3x2 tile with an actual size of 2x1:
+    return make_shared<HeightMapTile>(HeightMapTile{
+        .tileID = TileID{1U, 2U, 3U},
+        .size = glm::u32vec2{3U, 2U},
+        .actualSize = glm::u32vec2{2U, 1U},
+        .scale = 8.0F,
+        .heights = vector<float>{1.0F, 2.0F, 3.0F, 4.0F, 5.0F, 6.0F},
+        .mask = vector<uint8_t>{255U, 0U, 255U, 255U, 255U, 255U},
+    });
+}
+
+}  // namespace
+
+TEST(HeightMapTileSamplerTest, constructorThrowsWithoutTile)
+{
+    EXPECT_THROW(HeightMapTileSampler(nullptr), invalid_argument);
+}
+
+TEST(HeightMapTileSamplerTest, at)
+{
+    HeightMapTileSampler sampler(createTestTile());
+    EXPECT_THAT(sampler.at(0U, 0U), FloatEq(1.0F));
+    EXPECT_THAT(sampler.at(glm::u32vec2{2U, 1U}), FloatEq(6.0F));
+}
+
+TEST(HeightMapTileSamplerTest, isValid)
+{
+    HeightMapTileSampler sampler(createTestTile());
+    EXPECT_THAT(sampler.isValid(0U, 0U), IsTrue());
+    EXPECT_THAT(sampler.isValid(1U, 0U), IsFalse());
+    EXPECT_THAT(sampler.isValid(2U, 0U), IsFalse());  // Valid in mask but outside of actual size
+    EXPECT_THAT(sampler.isValid(0U, 1U), IsFalse());
+}
+
+TEST(HeightMapTileSamplerTest, copyRows)
+{
+    HeightMapTileSampler sampler(createTestTile());
+
+    vector<float> heights(6U);
+    sampler.copyRows(0U, 2U, heights);
+    EXPECT_THAT(heights, ElementsAre(1.0F, 2.0F, 3.0F, 4.0F, 5.0F, 6.0F));
+
+    vector<float> secondRow(3U);
+    sampler.copyRows(1U, 1U, secondRow);
+    EXPECT_THAT(secondRow, ElementsAre(4.0F, 5.0F, 6.0F));
+}
+
+TEST(HeightMapTileSamplerTest, copyRowsThrowsWithInvalidArgs)
+{
+    HeightMapTileSampler sampler(createTestTile());
+
+    vector<float> heights(6U);
+    EXPECT_THROW(sampler.copyRows(1U, 2U, heights), out_of_range);
+    EXPECT_THROW(sampler.copyRows(0U, 2U, span<float>(heights.data(), 5U)), invalid_argument);
+}
+
+TEST(HeightMapTileSamplerTest, copyMaskRows)
+{
+    HeightMapTileSampler sampler(createTestTile());
+
+    vector<uint8_t> validity(6U, 42U);
+    sampler.copyMaskRows(0U, 2U, validity);
+    EXPECT_THAT(validity, ElementsAre(1U, 0U, 0U, 0U, 0U, 0U));
+}
+
+TEST(HeightMapTileSamplerTest, copyMaskRowsWithoutMask)
+{
+    auto pTile = createTestTile();
+    pTile->mask.clear();
+    HeightMapTileSampler sampler(pTile);
+
+    vector<uint8_t> validity(3U, 42U);
+    sampler.copyMaskRows(0U, 1U, validity);
+    EXPECT_THAT(validity, ElementsAre(0U, 0U, 0U));
+}
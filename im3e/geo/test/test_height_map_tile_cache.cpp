@@ -0,0 +1,144 @@
+#include "src/height_map_tile_cache.h"
+
+#include <im3e/test_utils/test_utils.h>
+#include <im3e/utils/mock/mock_stats.h>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+constexpr glm::u32vec2 TestTileSize{4U, 4U};
+
+auto createTestTile(const TileID& rTileID)
+{
+    return HeightMapTile{
+        .tileID = rTileID,
+        .size = TestTileSize,
+        .actualSize = TestTileSize,
+        .heights = vector<float>(TestTileSize.x * TestTileSize.y, static_cast<float>(rTileID.x)),
+        .mask = vector<uint8_t>(TestTileSize.x * TestTileSize.y, 255U),
+    };
+}
+
+const size_t TestTileByteSize = createTestTile(TileID{}).getByteSize();
+
+}  // namespace
+
+TEST(HeightMapTileCacheTest, getOrLoadLoadsOnMiss)
+{
+    HeightMapTileCache cache("test", 10U * TestTileByteSize, nullptr);
+
+    MockFunction<HeightMapTile()> mockLoad;
+    EXPECT_CALL(mockLoad, Call()).WillOnce(Return(createTestTile(TileID{3U, 0U, 0U})));
+
+    auto pTile = cache.getOrLoad(TileID{3U, 0U, 0U}, mockLoad.AsStdFunction());
+    ASSERT_THAT(pTile, NotNull());
+    EXPECT_THAT(pTile->heights.front(), FloatEq(3.0F));
+    EXPECT_THAT(cache.getMissCount(), Eq(1U));
+    EXPECT_THAT(cache.getHitCount(), Eq(0U));
+    EXPECT_THAT(cache.getTileCount(), Eq(1U));
+    EXPECT_THAT(cache.getByteSize(), Eq(TestTileByteSize));
+}
+
+TEST(HeightMapTileCacheTest, getOrLoadDoesNotLoadOnHit)
+{
+    HeightMapTileCache cache("test", 10U * TestTileByteSize, nullptr);
+    auto pTile = cache.getOrLoad(TileID{1U, 2U, 0U}, [] { return createTestTile(TileID{1U, 2U, 0U}); });
+
+    MockFunction<HeightMapTile()> mockLoad;
+    EXPECT_CALL(mockLoad, Call()).Times(0);
+    EXPECT_THAT(cache.getOrLoad(TileID{1U, 2U, 0U}, mockLoad.AsStdFunction()), Eq(pTile));
+    EXPECT_THAT(cache.getHitCount(), Eq(1U));
+    EXPECT_THAT(cache.getMissCount(), Eq(1U));
+}
+
+TEST(HeightMapTileCacheTest, getOrLoadEvictsLeastRecentlyUsed)
+{
+    HeightMapTileCache cache("test", 2U * TestTileByteSize, nullptr);
+    const TileID tileID0{0U, 0U, 0U};
+    const TileID tileID1{1U, 0U, 0U};
+    const TileID tileID2{2U, 0U, 0U};
+
+    cache.getOrLoad(tileID0, [&] { return createTestTile(tileID0); });
+    cache.getOrLoad(tileID1, [&] { return createTestTile(tileID1); });
+    cache.getOrLoad(tileID0, [&] { return createTestTile(tileID0); });  // tile 1 is now the least recently used
+    cache.getOrLoad(tileID2, [&] { return createTestTile(tileID2); });
+    EXPECT_THAT(cache.getEvictionCount(), Eq(1U));
+    EXPECT_THAT(cache.getTileCount(), Eq(2U));
+    EXPECT_THAT(cache.getByteSize(), Eq(2U * TestTileByteSize));
+
+    MockFunction<HeightMapTile()> mockLoad;
+    EXPECT_CALL(mockLoad, Call()).WillOnce(Return(createTestTile(tileID1)));
+    cache.getOrLoad(tileID0, mockLoad.AsStdFunction());
+    cache.getOrLoad(tileID2, mockLoad.AsStdFunction());
+    cache.getOrLoad(tileID1, mockLoad.AsStdFunction());
+}
+
+TEST(HeightMapTileCacheTest, getOrLoadDoesNotCacheWithoutBudget)
+{
+    HeightMapTileCache cache("test", 0U, nullptr);
+
+    MockFunction<HeightMapTile()> mockLoad;
+    EXPECT_CALL(mockLoad, Call()).Times(2).WillRepeatedly(Return(createTestTile(TileID{})));
+    EXPECT_THAT(cache.getOrLoad(TileID{}, mockLoad.AsStdFunction()), NotNull());
+    EXPECT_THAT(cache.getOrLoad(TileID{}, mockLoad.AsStdFunction()), NotNull());
+    EXPECT_THAT(cache.getTileCount(), Eq(0U));
+    EXPECT_THAT(cache.getMissCount(), Eq(2U));
+}
+
+TEST(HeightMapTileCacheTest, clear)
+{
+    HeightMapTileCache cache("test", 10U * TestTileByteSize, nullptr);
+    cache.getOrLoad(TileID{}, [] { return createTestTile(TileID{}); });
+
+    cache.clear();
+    EXPECT_THAT(cache.getTileCount(), Eq(0U));
+    EXPECT_THAT(cache.getByteSize(), Eq(0U));
+}
+
+TEST(HeightMapTileCacheTest, eventsArePublishedToStatsProvider)
+{
+    auto pMockStatsReceiver = make_shared<NiceMock<MockStatsReceiver>>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pMockStatsReceiver);
+
+    vector<Metric> metrics;
+    EXPECT_CALL(*pMockStatsReceiver, onMetricsUpdated(_)).WillRepeatedly(SaveArg<0>(&metrics));
+
+    HeightMapTileCache cache("test", TestTileByteSize, pStatsProvider);
+    cache.getOrLoad(TileID{0U, 0U, 0U}, [] { return createTestTile(TileID{0U, 0U, 0U}); });
+    cache.getOrLoad(TileID{0U, 0U, 0U}, [] { return createTestTile(TileID{0U, 0U, 0U}); });
+    cache.getOrLoad(TileID{1U, 0U, 0U}, [] { return createTestTile(TileID{1U, 0U, 0U}); });
+    pStatsProvider->flush();
+    pStatsProvider->removeReceiver(pMockStatsReceiver);
+
+    const auto isCounter = [](string_view name, int64_t value) {
+        return AllOf(Field(&Metric::name, Eq(name)), Field(&Metric::type, Eq(MetricType::Counter)),
+                     Field(&Metric::value, Eq(value)));
+    };
+    EXPECT_THAT(metrics, IsSupersetOf({isCounter("test.tileCacheHits", 1), isCounter("test.tileCacheMisses", 2),
+                                       isCounter("test.tileCacheEvictions", 1)}));
+}
+
+TEST(HeightMapTileCacheTest, metricsArePublishedToStatsProvider)
+{
+    auto pStatsProvider = createStatsProvider();
+    HeightMapTileCache cache("test", TestTileByteSize * 2U, pStatsProvider);
+
+    cache.getOrLoad(TileID{0U, 0U, 0U}, [] { return createTestTile(TileID{0U, 0U, 0U}); });
+    cache.getOrLoad(TileID{0U, 0U, 0U}, [] { return createTestTile(TileID{0U, 0U, 0U}); });
+    cache.getOrLoad(TileID{1U, 0U, 0U}, [] { return createTestTile(TileID{1U, 0U, 0U}); });
+    cache.getOrLoad(TileID{2U, 0U, 0U}, [] { return createTestTile(TileID{2U, 0U, 0U}); });
+
+    EXPECT_THAT(pStatsProvider->getCounter("test.tileCacheHits")->getValue(), Eq(1));
+    EXPECT_THAT(pStatsProvider->getCounter("test.tileCacheMisses")->getValue(), Eq(3));
+    EXPECT_THAT(pStatsProvider->getCounter("test.tileCacheEvictions")->getValue(), Eq(1));
+    EXPECT_THAT(pStatsProvider->getGauge("test.tileCacheTiles")->getValue(), Eq(2));
+    EXPECT_THAT(pStatsProvider->getGauge("test.tileCacheBytes")->getValue(),
+                Eq(static_cast<int64_t>(TestTileByteSize * 2U)));
+
+    cache.clear();
+    EXPECT_THAT(pStatsProvider->getGauge("test.tileCacheTiles")->getValue(), Eq(0));
+    EXPECT_THAT(pStatsProvider->getGauge("test.tileCacheBytes")->getValue(), Eq(0));
+}
@@ -0,0 +1,137 @@
+#include "src/height_map_tile.h"
+#include "src/height_map_tile_ranges.h"
+
+#include <im3e/mock/mock_height_map.h>
+#include <im3e/test_utils/glm.h>
+#include <im3e/test_utils/test_utils.h>
+
+#include <fmt/format.h>
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+constexpr glm::u32vec2 TestTileSize{2U, 2U};
+
+auto getTestTileCount(uint32_t lod)
+{
+    // 3x2 tiles at the highest level of details:
+    return (glm::u32vec2{3U, 2U} + (1U << lod) - 1U) / (1U << lod);
+}
+
+auto createTestTile(const TileID& rTileID)
+{
+    // Heights increase with the tile position, the tile (2; 1) has no valid sample:
+    const auto baseHeight = static_cast<float>(rTileID.y * 10U + rTileID.x);
+    const uint8_t validity = (rTileID == TileID{2U, 1U, 0U}) ? 0U : 255U;
+    return make_shared<HeightMapTile>(HeightMapTile{
+        .tileID = rTileID,
+        .size = TestTileSize,
+        .actualSize = TestTileSize,
+        .heights = vector<float>{baseHeight, baseHeight + 0.5F, baseHeight + 0.25F, baseHeight - 0.5F},
+        .mask = vector<uint8_t>(4U, validity),
+    });
+}
+
+}  // namespace
+
+TEST(HeightMapTileRangesTest, computeHeightRangeIgnoresInvalidSamples)
+{
+    const vector<float> heights{5.0F, -100.0F, 2.0F, 100.0F, 3.0F};
+    const vector<uint8_t> mask{255U, 0U, 1U, 0U, 255U};
+
+    const auto range = computeHeightRange(heights, mask);
+    EXPECT_THAT(range.x, FloatEq(2.0F));
+    EXPECT_THAT(range.y, FloatEq(5.0F));
+}
+
+TEST(HeightMapTileRangesTest, computeHeightRangeWithoutValidSample)
+{
+    const vector<float> heights{5.0F, -100.0F};
+    const vector<uint8_t> mask{0U, 0U};
+
+    EXPECT_THAT(computeHeightRange(heights, mask), FloatEq(EmptyHeightRange));
+}
+
+TEST(HeightMapTileRangesTest, computeHeightRangeThrowsWithMismatchingMask)
+{
+    const vector<float> heights{5.0F, -100.0F};
+    const vector<uint8_t> mask{0U};
+
+    EXPECT_THROW(computeHeightRange(heights, mask), invalid_argument);
+}
+
+TEST(HeightMapTileRangesTest, getThrowsWithInvalidTile)
+{
+    HeightMapTileRanges tileRanges({glm::u32vec2{3U, 2U}, glm::u32vec2{2U, 1U}});
+    EXPECT_THAT(tileRanges.contains(TileID{1U, 0U, 1U}), IsTrue());
+    EXPECT_THAT(tileRanges.contains(TileID{0U, 1U, 1U}), IsFalse());
+    EXPECT_THAT(tileRanges.contains(TileID{0U, 0U, 2U}), IsFalse());
+    EXPECT_THROW(tileRanges.get(TileID{0U, 1U, 1U}), out_of_range);
+}
+
+TEST(HeightMapTileRangesTest, computeHeightMapTileRanges)
+{
+    NiceMock<MockHeightMap> mockHeightMap;
+    ON_CALL(mockHeightMap, getLodCount()).WillByDefault(Return(3U));
+    ON_CALL(mockHeightMap, getTileCount(_)).WillByDefault(Invoke(getTestTileCount));
+    ON_CALL(mockHeightMap, getTileSampler(An<const TileID&>()))
+        .WillByDefault(Invoke([](const TileID& rTileID) -> unique_ptr<IHeightMapTileSampler> {
+            return make_unique<HeightMapTileSampler>(createTestTile(rTileID));
+        }));
+
+    // Only tiles of the highest level of details are read:
+    EXPECT_CALL(mockHeightMap, getTileSampler(An<const TileID&>())).Times(6);
+
+    const auto tileRanges = computeHeightMapTileRanges(mockHeightMap);
+    ASSERT_THAT(tileRanges.getLodCount(), Eq(3U));
+    EXPECT_THAT(tileRanges.get(TileID{0U, 0U, 0U}), FloatEq(glm::vec2{-0.5F, 0.5F}));
+    EXPECT_THAT(tileRanges.get(TileID{1U, 1U, 0U}), FloatEq(glm::vec2{10.5F, 11.5F}));
+    EXPECT_THAT(tileRanges.get(TileID{2U, 1U, 0U}), FloatEq(EmptyHeightRange));
+
+    EXPECT_THAT(tileRanges.get(TileID{0U, 0U, 1U}), FloatEq(glm::vec2{-0.5F, 11.5F}));
+    EXPECT_THAT(tileRanges.get(TileID{1U, 0U, 1U}), FloatEq(glm::vec2{1.5F, 2.5F}));
+    EXPECT_THAT(tileRanges.get(TileID{0U, 0U, 2U}), FloatEq(glm::vec2{-0.5F, 11.5F}));
+}
+
+TEST(HeightMapTileRangesTest, saveAndLoad)
+{
+    const auto path = filesystem::temp_directory_path() / fmt::format("test_height_map_tile_ranges_{}", getpid());
+    const auto tileRangesPath = getHeightMapTileRangesPath(path);
+    EXPECT_THAT(tileRangesPath.string(), Eq(path.string() + string(HeightMapTileRangesExtension)));
+
+    HeightMapTileRanges tileRanges({glm::u32vec2{2U, 1U}, glm::u32vec2{1U, 1U}});
+    tileRanges.set(TileID{0U, 0U, 0U}, glm::vec2{-1.0F, 3.0F});
+    tileRanges.set(TileID{1U, 0U, 0U}, glm::vec2{2.0F, 5.0F});
+    tileRanges.set(TileID{0U, 0U, 1U}, glm::vec2{-1.0F, 5.0F});
+    saveHeightMapTileRanges(tileRanges, tileRangesPath);
+
+    const auto loadedTileRanges = loadHeightMapTileRanges(tileRangesPath);
+    ASSERT_THAT(loadedTileRanges.has_value(), IsTrue());
+    EXPECT_THAT(loadedTileRanges->getTileCounts(), ContainerEq(tileRanges.getTileCounts()));
+    EXPECT_THAT(loadedTileRanges->get(TileID{0U, 0U, 0U}), FloatEq(glm::vec2{-1.0F, 3.0F}));
+    EXPECT_THAT(loadedTileRanges->get(TileID{1U, 0U, 0U}), FloatEq(glm::vec2{2.0F, 5.0F}));
+    EXPECT_THAT(loadedTileRanges->get(TileID{0U, 0U, 1U}), FloatEq(glm::vec2{-1.0F, 5.0F}));
+
+    filesystem::remove(tileRangesPath);
+}
+
+TEST(HeightMapTileRangesTest, loadReturnsNothingWithInvalidFile)
+{
+    const auto path = filesystem::temp_directory_path() / fmt::format("test_height_map_tile_ranges_{}.imhr", getpid());
+    EXPECT_THAT(loadHeightMapTileRanges(path).has_value(), IsFalse());
+
+    {
+        ofstream file(path, ios::binary);
+        file << "not a tile ranges file";
+    }
+    EXPECT_THAT(loadHeightMapTileRanges(path).has_value(), IsFalse());
+
+    filesystem::remove(path);
+}
@@ -0,0 +1,199 @@
+#include "src/height_map_tile.h"
+#include "src/native_height_map.h"
+
+#include <im3e/mock/mock_height_map.h>
+#include <im3e/test_utils/test_utils.h>
+#include <im3e/utils/mock/mock_logger.h>
+
+#include <fmt/format.h>
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+
+using namespace im3e;
+using namespace std;
+
+namespace {
+
+constexpr glm::u32vec2 TestSize{10U, 6U};
+constexpr glm::u32vec2 TestTileSize{4U, 4U};
+
+auto getTestLodSize(uint32_t lod)
+{
+    return (TestSize + (1U << lod) - 1U) / (1U << lod);
+}
+
+auto getTestTileCount(uint32_t lod)
+{
+    return (getTestLodSize(lod) + TestTileSize - 1U) / TestTileSize;
+}
+
+auto getTestHeight(const TileID& rTileID, uint32_t x, uint32_t y)
+{
+    return static_cast<float>(rTileID.z * 1000U + rTileID.y * 100U + rTileID.x * 10U) + 0.1F * x + 0.01F * y;
+}
+
+auto isTestSampleValid(uint32_t x, uint32_t y)
+{
+    return (x + y) % 3U != 0U;
+}
+
+auto createTestTile(const TileID& rTileID)
+{
+    const auto actualSize = glm::min(TestTileSize,
+                                     getTestLodSize(rTileID.z) - glm::u32vec2(rTileID.xy()) * TestTileSize);
+
+    HeightMapTile tile{
+        .tileID = rTileID,
+        .size = TestTileSize,
+        .actualSize = actualSize,
+        .scale = static_cast<float>(1U << rTileID.z),
+        .heights = vector<float>(TestTileSize.x * TestTileSize.y),
+        .mask = vector<uint8_t>(TestTileSize.x * TestTileSize.y),
+    };
+    for (uint32_t y = 0U; y < actualSize.y; y++)
+    {
+        for (uint32_t x = 0U; x < actualSize.x; x++)
+        {
+            tile.heights[y * TestTileSize.x + x] = getTestHeight(rTileID, x, y);
+            tile.mask[y * TestTileSize.x + x] = isTestSampleValid(x, y) ? 255U : 0U;
+        }
+    }
+    return tile;
+}
+
+}  // namespace
+
+struct NativeHeightMapTest : public Test
+{
+    NativeHeightMapTest()
+    {
+        ON_CALL(m_mockSrcHeightMap, getSize()).WillByDefault(Return(TestSize));
+        ON_CALL(m_mockSrcHeightMap, getTileSize()).WillByDefault(Return(TestTileSize));
+        ON_CALL(m_mockSrcHeightMap, getLodCount()).WillByDefault(Return(3U));
+        ON_CALL(m_mockSrcHeightMap, getMinHeight()).WillByDefault(Return(-5.0F));
+        ON_CALL(m_mockSrcHeightMap, getMaxHeight()).WillByDefault(Return(2500.0F));
+        ON_CALL(m_mockSrcHeightMap, getTileCount(_)).WillByDefault(Invoke(getTestTileCount));
+        ON_CALL(m_mockSrcHeightMap, getTileSampler(An<const TileID&>()))
+            .WillByDefault(Invoke([](const TileID& rTileID) -> unique_ptr<IHeightMapTileSampler> {
+                return make_unique<HeightMapTileSampler>(make_shared<HeightMapTile>(createTestTile(rTileID)));
+            }));
+    }
+
+    ~NativeHeightMapTest() override { filesystem::remove(m_path); }
+
+    NiceMock<MockLogger> m_mockLogger;
+    NiceMock<MockHeightMap> m_mockSrcHeightMap;
+    const filesystem::path m_path = filesystem::temp_directory_path() /
+                                    fmt::format("test_native_height_map_{}.imhm", getpid());
+};
+
+TEST_F(NativeHeightMapTest, convertAndLoad)
+{
+    convertToNativeHeightMap(m_mockLogger, m_mockSrcHeightMap, m_path);
+
+    auto pHeightMap = loadHeightMapFromFile(m_mockLogger, HeightMapFileConfig{.path = m_path});
+    ASSERT_THAT(pHeightMap, NotNull());
+    EXPECT_THAT(pHeightMap->getSize(), Eq(TestSize));
+    EXPECT_THAT(pHeightMap->getTileSize(), Eq(TestTileSize));
+    EXPECT_THAT(pHeightMap->getLodCount(), Eq(3U));
+    EXPECT_THAT(pHeightMap->getMinHeight(), FloatEq(-5.0F));
+    EXPECT_THAT(pHeightMap->getMaxHeight(), FloatEq(2500.0F));
+
+    for (uint32_t lod = 0U; lod < 3U; lod++)
+    {
+        const auto tileCount = pHeightMap->getTileCount(lod);
+        EXPECT_THAT(tileCount, Eq(getTestTileCount(lod)));
+        for (uint32_t tileY = 0U; tileY < tileCount.y; tileY++)
+        {
+            for (uint32_t tileX = 0U; tileX < tileCount.x; tileX++)
+            {
+                const TileID tileID{tileX, tileY, lod};
+                const auto expectedTile = createTestTile(tileID);
+
+                auto pSampler = pHeightMap->getTileSampler(tileID);
+                ASSERT_THAT(pSampler, NotNull());
+                EXPECT_THAT(pSampler->getTileID(), Eq(tileID));
+                EXPECT_THAT(pSampler->getSize(), Eq(TestTileSize));
+                EXPECT_THAT(pSampler->getActualSize(), Eq(expectedTile.actualSize));
+                EXPECT_THAT(pSampler->getScale(), FloatEq(expectedTile.scale));
+                for (uint32_t y = 0U; y < TestTileSize.y; y++)
+                {
+                    for (uint32_t x = 0U; x < TestTileSize.x; x++)
+                    {
+                        const bool isInside = x < expectedTile.actualSize.x && y < expectedTile.actualSize.y;
+                        EXPECT_THAT(pSampler->isValid(x, y), Eq(isInside && isTestSampleValid(x, y)));
+                        if (isInside)
+                        {
+                            EXPECT_THAT(pSampler->at(x, y), FloatEq(getTestHeight(tileID, x, y)));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(NativeHeightMapTest, copyRows)
+{
+    convertToNativeHeightMap(m_mockLogger, m_mockSrcHeightMap, m_path);
+    NativeHeightMap heightMap(m_mockLogger, HeightMapFileConfig{.path = m_path});
+
+    // Bottom-right tile only has 2x2 actual samples:
+    const TileID tileID{2U, 1U, 0U};
+    auto pSampler = heightMap.getTileSampler(tileID);
+
+    vector<float> heights(2U * TestTileSize.x);
+    pSampler->copyRows(1U, 2U, heights);
+    EXPECT_THAT(heights[0U], FloatEq(getTestHeight(tileID, 0U, 1U)));
+    EXPECT_THAT(heights[1U], FloatEq(getTestHeight(tileID, 1U, 1U)));
+
+    vector<uint8_t> validity(2U * TestTileSize.x, 42U);
+    pSampler->copyMaskRows(1U, 2U, validity);
+    EXPECT_THAT(validity, ElementsAre(isTestSampleValid(0U, 1U), isTestSampleValid(1U, 1U), 0U, 0U,  //
+                                      0U, 0U, 0U, 0U));
+
+    EXPECT_THROW(pSampler->copyRows(3U, 2U, heights), out_of_range);
+}
+
+TEST_F(NativeHeightMapTest, getTileHeightRange)
+{
+    convertToNativeHeightMap(m_mockLogger, m_mockSrcHeightMap, m_path);
+    NativeHeightMap heightMap(m_mockLogger, HeightMapFileConfig{.path = m_path});
+
+    // Bottom-right tile only has 2x2 actual samples, of which (1; 0), (0; 1) and (1; 1) are valid:
+    const TileID tileID{2U, 1U, 0U};
+    const auto heightRange = heightMap.getTileHeightRange(tileID);
+    EXPECT_THAT(heightRange.x, FloatEq(getTestHeight(tileID, 0U, 1U)));
+    EXPECT_THAT(heightRange.y, FloatEq(getTestHeight(tileID, 1U, 1U)));
+
+    EXPECT_THROW(heightMap.getTileHeightRange(TileID{3U, 0U, 0U}), out_of_range);
+}
+
+TEST_F(NativeHeightMapTest, getTileSamplerThrowsWithInvalidTile)
+{
+    convertToNativeHeightMap(m_mockLogger, m_mockSrcHeightMap, m_path);
+    NativeHeightMap heightMap(m_mockLogger, HeightMapFileConfig{.path = m_path});
+
+    EXPECT_THROW(heightMap.getTileSampler(TileID{0U, 0U, 3U}), invalid_argument);
+    EXPECT_THROW(heightMap.getTileSampler(TileID{3U, 0U, 0U}), invalid_argument);
+}
+
+TEST_F(NativeHeightMapTest, constructorThrowsWithInvalidFile)
+{
+    {
+        ofstream file(m_path, ios::binary);
+        const vector<char> garbage(native_height_map::PageSize, 'x');
+        file.write(garbage.data(), garbage.size());
+    }
+    EXPECT_THROW(NativeHeightMap(m_mockLogger, HeightMapFileConfig{.path = m_path}), runtime_error);
+}
+
+TEST_F(NativeHeightMapTest, rebuildPyramidThrows)
+{
+    convertToNativeHeightMap(m_mockLogger, m_mockSrcHeightMap, m_path);
+    NativeHeightMap heightMap(m_mockLogger, HeightMapFileConfig{.path = m_path});
+    EXPECT_THROW(heightMap.rebuildPyramid(), logic_error);
+}
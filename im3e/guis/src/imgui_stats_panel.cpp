@@ -8,16 +8,13 @@
 #include <fmt/format.h>
 #include <imgui.h>
 
+#include <algorithm>
 #include <limits>
 
 using namespace im3e;
 using namespace std;
 using namespace std::chrono;
 
-namespace {
-
-}
-
 ImguiStatsPanel::ImguiStatsPanel(string_view name, shared_ptr<IStatsProvider> pStatsProvider)
   : m_name(name)
   , m_pStatsProvider(throwIfArgNull(std::move(pStatsProvider), "ImGui stats panel requires a stats provider"))
@@ -33,69 +30,140 @@ ImguiStatsPanel::~ImguiStatsPanel()
 
 void ImguiStatsPanel::draw(const ICommandBuffer&)
 {
+    // Percentiles are recomputed a few times per second rather than every frame:
+    constexpr auto SummaryPeriod = 100ms;
+    const auto time = steady_clock::now();
+    const auto summariesOutdated = time - m_lastSummaryTime >= SummaryPeriod;
+    if (summariesOutdated)
+    {
+        m_lastSummaryTime = time;
+    }
+
+    if (auto tabBarScope = ImguiScope(ImGui::BeginTabBar("Stats"), &ImGui::EndTabBar))
+    {
+        if (auto tabScope = ImguiScope(ImGui::BeginTabItem("Spans"), &ImGui::EndTabItem))
+        {
+            this->drawSpans(time, summariesOutdated);
+        }
+        if (auto tabScope = ImguiScope(ImGui::BeginTabItem("Metrics"), &ImGui::EndTabItem))
+        {
+            this->drawMetrics();
+        }
+    }
+}
+
+void ImguiStatsPanel::drawSpans(steady_clock::time_point time, bool summariesOutdated)
+{
+    lock_guard lk(m_spanStatsMutex);
+    if (m_selectedSpanPath.empty() && !m_pSpanStats.empty())
+    {
+        m_selectedSpanPath = m_pSpanStats.begin()->first;
+    }
+
+    // Scrolling graph of the most recent durations of the selected span:
+    if (auto itSpanStats = m_pSpanStats.find(m_selectedSpanPath); itSpanStats != m_pSpanStats.end())
+    {
+        auto& rSpanStats = *itSpanStats->second;
+        const auto recentDurationCount = rSpanStats.recentDurationCount.load(memory_order_acquire);
+        const auto durationCount = static_cast<uint32_t>(min<uint64_t>(recentDurationCount, RecentDurationCount));
+
+        array<float, RecentDurationCount> recentDurationsMs{};
+        for (uint32_t i = 0U; i < durationCount; i++)
+        {
+            const auto durationIndex = (recentDurationCount - durationCount + i) % RecentDurationCount;
+            recentDurationsMs[i] = rSpanStats.recentDurationsMs[durationIndex].load(memory_order_relaxed);
+        }
+        const auto overlayText = fmt::format("{}: {:.2f}ms", m_selectedSpanPath.generic_string(),
+                                             durationCount ? recentDurationsMs[durationCount - 1U] : 0.0F);
+        ImGui::PlotLines("##RecentDurations", recentDurationsMs.data(), static_cast<int>(durationCount), 0,
+                         overlayText.c_str(), 0.0F, numeric_limits<float>::max(), ImVec2(-1.0F, 80.0F));
+    }
+
     constexpr ImGuiTableFlags TableFlags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH |
                                            ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg;
-    if (auto tableScope = ImguiScope(ImGui::BeginTable("Spans", 6, TableFlags), &ImGui::EndTable))
+    if (auto tableScope = ImguiScope(ImGui::BeginTable("Spans", 8, TableFlags), &ImGui::EndTable))
     {
         ImGui::TableSetupColumn("Span");
         ImGui::TableSetupColumn("Current");
-        ImGui::TableSetupColumn("Min");
         ImGui::TableSetupColumn("Average");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p95");
+        ImGui::TableSetupColumn("p99");
         ImGui::TableSetupColumn("Max");
         ImGui::TableSetupColumn("Frequency");
         ImGui::TableHeadersRow();
 
-        lock_guard lk(m_mutex);
-
-        for (auto& [rSpanPath, rSpanStats] : m_spanStats)
+        const auto formatDuration = [](duration<double, milli> durationMs) {
+            return fmt::format("{:.2f}ms", durationMs.count());
+        };
+        for (auto& [rSpanPath, rpSpanStats] : m_pSpanStats)
         {
+            auto& rSummary = rpSpanStats->summary;
+            if (summariesOutdated)
+            {
+                rSummary = rpSpanStats->histogram.summarize(time);
+            }
+
             ImGui::TableNextRow();
             ImGui::TableNextColumn();
-            ImGui::Text("%s", rSpanPath.c_str());
-
-            microseconds curDuration{};
-            microseconds minDuration{numeric_limits<microseconds::rep>::max()};
-            microseconds totalDuration{};
-            microseconds maxDuration{};
-            float frequency{};
-
-            constexpr auto TimeWindow = 1s;
-            auto& rDurations = rSpanStats.durations;
-
-            auto lowerBound = steady_clock::now() - TimeWindow;
-            auto itLowerBound = rDurations.lower_bound(lowerBound);
-            if (itLowerBound != rDurations.begin())
+            if (ImGui::Selectable(rSpanPath.c_str(), rSpanPath == m_selectedSpanPath,
+                                  ImGuiSelectableFlags_SpanAllColumns))
             {
-                itLowerBound--;
-                rDurations.erase(rDurations.begin(), itLowerBound);
+                m_selectedSpanPath = rSpanPath;
             }
 
-            if (!rDurations.empty())
+            float curDurationMs{};
+            if (const auto recentDurationCount = rpSpanStats->recentDurationCount.load(memory_order_acquire))
             {
-                curDuration = rDurations.rbegin()->second;
-
-                for (auto& [rTimestamp, rDuration] : rDurations)
-                {
-                    minDuration = min(minDuration, rDuration);
-                    totalDuration += rDuration;
-                    maxDuration = max(maxDuration, rDuration);
-                }
-
-                const auto curTimeWindow = duration_cast<milliseconds>(rDurations.rbegin()->first -
-                                                                       rDurations.begin()->first);
-                frequency = rDurations.size() / (curTimeWindow.count() / 1.0e3F);
+                const auto durationIndex = (recentDurationCount - 1U) % RecentDurationCount;
+                curDurationMs = rpSpanStats->recentDurationsMs[durationIndex].load(memory_order_relaxed);
             }
 
             ImGui::TableNextColumn();
-            ImGui::Text("%s", fmt::format("{:.2f}ms", curDuration.count() / 1000.0).c_str());
+            ImGui::Text("%s", fmt::format("{:.2f}ms", curDurationMs).c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", formatDuration(rSummary.average).c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", formatDuration(rSummary.p50).c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", formatDuration(rSummary.p95).c_str());
             ImGui::TableNextColumn();
-            ImGui::Text("%s", fmt::format("{:.2f}ms", minDuration.count() / 1000.0).c_str());
+            ImGui::Text("%s", formatDuration(rSummary.p99).c_str());
             ImGui::TableNextColumn();
-            ImGui::Text("%s", fmt::format("{:.2f}ms", totalDuration.count() / (rDurations.size() * 1000.0)).c_str());
+            ImGui::Text("%s", formatDuration(rSummary.max).c_str());
             ImGui::TableNextColumn();
-            ImGui::Text("%s", fmt::format("{:.2f}ms", maxDuration.count() / 1000.0).c_str());
+            ImGui::Text("%s", fmt::format("{:.2f}", rSummary.frequency).c_str());
+        }
+    }
+}
+
+void ImguiStatsPanel::drawMetrics()
+{
+    lock_guard lk(m_metricStatsMutex);
+
+    constexpr ImGuiTableFlags TableFlags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH |
+                                           ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg;
+    if (auto tableScope = ImguiScope(ImGui::BeginTable("Metrics", 4, TableFlags), &ImGui::EndTable))
+    {
+        ImGui::TableSetupColumn("Metric");
+        ImGui::TableSetupColumn("Type");
+        ImGui::TableSetupColumn("Value");
+        ImGui::TableSetupColumn("Rate");
+        ImGui::TableHeadersRow();
+
+        for (auto& [rMetric, rate] : m_metricStats)
+        {
+            const auto isCounter = rMetric.type == MetricType::Counter;
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", rMetric.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", isCounter ? "Counter" : "Gauge");
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", fmt::format("{}", rMetric.value).c_str());
             ImGui::TableNextColumn();
-            ImGui::Text("%s", fmt::format("{:.2f}", frequency).c_str());
+            ImGui::Text("%s", isCounter ? fmt::format("{:.2f}/s", rate).c_str() : "");
         }
     }
 }
@@ -107,9 +175,52 @@ ImguiStatsPanel::StatsReceiver::StatsReceiver(ImguiStatsPanel& rPanel)
 
 void ImguiStatsPanel::StatsReceiver::onSpanAdded(Span span)
 {
-    lock_guard lk(m_rPanel.m_mutex);
-    auto& rSpanStats = m_rPanel.m_spanStats[span.path];
-    rSpanStats.durations.emplace(steady_clock::now(), duration_cast<microseconds>(span.endTime - span.startTime));
+    auto& rpSpanStats = m_pSpanStats[span.path];
+    if (!rpSpanStats)
+    {
+        lock_guard lk(m_rPanel.m_spanStatsMutex);
+        auto& rpPanelSpanStats = m_rPanel.m_pSpanStats[span.path];
+        if (!rpPanelSpanStats)
+        {
+            rpPanelSpanStats = make_unique<SpanStats>();
+        }
+        rpSpanStats = rpPanelSpanStats.get();
+    }
+
+    const auto spanDuration = span.endTime - span.startTime;
+    rpSpanStats->histogram.record(span.endTime, spanDuration);
+
+    const auto recentDurationCount = rpSpanStats->recentDurationCount.load(memory_order_relaxed);
+    rpSpanStats->recentDurationsMs[recentDurationCount % RecentDurationCount].store(
+        duration<float, milli>(spanDuration).count(), memory_order_relaxed);
+    rpSpanStats->recentDurationCount.store(recentDurationCount + 1U, memory_order_release);
+}
+
+void ImguiStatsPanel::StatsReceiver::onMetricsUpdated(vector<Metric> metrics)
+{
+    const auto time = steady_clock::now();
+    const auto elapsedTime = duration<double>(time - m_previousMetricsTime);
+
+    vector<MetricStats> metricStats;
+    metricStats.reserve(metrics.size());
+    for (auto& rMetric : metrics)
+    {
+        double rate{};
+        if (rMetric.type == MetricType::Counter)
+        {
+            auto [itPrevious, inserted] = m_previousCounterValues.try_emplace(rMetric.name, rMetric.value);
+            if (!inserted && elapsedTime.count() > 0.0)
+            {
+                rate = static_cast<double>(rMetric.value - itPrevious->second) / elapsedTime.count();
+                itPrevious->second = rMetric.value;
+            }
+        }
+        metricStats.emplace_back(MetricStats{.metric = move(rMetric), .rate = rate});
+    }
+    m_previousMetricsTime = time;
+
+    lock_guard lk(m_rPanel.m_metricStatsMutex);
+    m_rPanel.m_metricStats = move(metricStats);
 }
 
 auto im3e::createImguiStatsPanel(string_view name, shared_ptr<IStatsProvider> pStatsProvider) -> shared_ptr<IGuiPanel>
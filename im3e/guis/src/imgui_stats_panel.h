@@ -1,13 +1,21 @@
 #pragma once
 
 #include <im3e/api/gui.h>
+#include <im3e/utils/duration_histogram.h>
 #include <im3e/utils/stats.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace im3e {
 
+/// @brief Panel displaying the span durations of a stats provider in a "Spans" tab and its metrics in a "Metrics" tab.
 class ImguiStatsPanel : public IGuiPanel
 {
 public:
@@ -19,16 +27,42 @@ public:
     auto getName() const -> std::string override { return m_name; }
 
 private:
+    void drawSpans(std::chrono::steady_clock::time_point time, bool summariesOutdated);
+    void drawMetrics();
+
     const std::string m_name;
     std::shared_ptr<IStatsProvider> m_pStatsProvider;
 
-    std::mutex m_mutex;
+    static constexpr uint32_t RecentDurationCount = 256U;
 
+    /// @brief Stats of the spans of a path, recorded without locking and read by the panel when drawn.
     struct SpanStats
     {
-        std::map<std::chrono::steady_clock::time_point, std::chrono::microseconds> durations;
+        DurationHistogram histogram;
+
+        // Ring buffer of the most recent durations, in milliseconds, drawn by the duration graph:
+        std::array<std::atomic<float>, RecentDurationCount> recentDurationsMs{};
+        std::atomic<uint64_t> recentDurationCount{};
+
+        // Displayed summary of the histogram, refreshed periodically:
+        DurationHistogram::Summary summary;
     };
-    std::map<std::filesystem::path, SpanStats> m_spanStats;
+    // Stats are never removed, the mutex only protects the insertion of new paths:
+    std::mutex m_spanStatsMutex;
+    std::map<std::filesystem::path, std::unique_ptr<SpanStats>> m_pSpanStats;
+
+    std::chrono::steady_clock::time_point m_lastSummaryTime;
+    std::filesystem::path m_selectedSpanPath;
+
+    /// @brief Latest value of a metric, along with its rate of change per second for counters.
+    struct MetricStats
+    {
+        Metric metric;
+        double rate;
+    };
+    // Replaced by the receiver with each metrics snapshot:
+    std::mutex m_metricStatsMutex;
+    std::vector<MetricStats> m_metricStats;
 
     class StatsReceiver : public IStatsReceiver
     {
@@ -36,9 +70,17 @@ private:
         StatsReceiver(ImguiStatsPanel& rPanel);
 
         void onSpanAdded(Span span) override;
+        void onMetricsUpdated(std::vector<Metric> metrics) override;
 
     private:
         ImguiStatsPanel& m_rPanel;
+
+        // Stats already known by the receiver, looked up without locking:
+        std::map<std::filesystem::path, SpanStats*> m_pSpanStats;
+
+        // Previous counter values, from which counter rates are computed:
+        std::map<std::string, int64_t, std::less<>> m_previousCounterValues;
+        std::chrono::steady_clock::time_point m_previousMetricsTime;
     };
     std::shared_ptr<IStatsReceiver> m_pStatsReceiver;
 };
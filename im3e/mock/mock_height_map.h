@@ -17,6 +17,11 @@ public:
 
     MOCK_METHOD(bool, isValid, (uint32_t x, uint32_t y), (const, override));
 
+    MOCK_METHOD(void, copyRows, (uint32_t firstRow, uint32_t rowCount, std::span<float> dst), (const, override));
+    MOCK_METHOD(void, copyMaskRows, (uint32_t firstRow, uint32_t rowCount, std::span<uint8_t> dst),
+                (const, override));
+
+    MOCK_METHOD(const TileID&, getTileID, (), (const, override));
     MOCK_METHOD(glm::u32vec2, getPos, (), (const, override));
     MOCK_METHOD(const glm::u32vec2&, getSize, (), (const, override));
     MOCK_METHOD(const glm::u32vec2&, getActualSize, (), (const, override));
@@ -42,6 +47,7 @@ public:
     MOCK_METHOD(uint32_t, getLodCount, (), (const, override));
     MOCK_METHOD(float, getMinHeight, (), (const, override));
     MOCK_METHOD(float, getMaxHeight, (), (const, override));
+    MOCK_METHOD(glm::vec2, getTileHeightRange, (const TileID& rTileID), (const, override));
 };
 
 }  // namespace im3e
\ No newline at end of file
@@ -6,15 +6,22 @@ namespace im3e {
 
 using ::testing::_;
 using ::testing::AllOf;
+using ::testing::An;
 using ::testing::AnyNumber;
 using ::testing::ByRef;
 using ::testing::Const;
 using ::testing::ContainerEq;
+using ::testing::Contains;
 using ::testing::DoAll;
+using ::testing::Each;
+using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::Field;
 using ::testing::FloatEq;
+using ::testing::FloatNear;
 using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::HasSubstr;
 using ::testing::InSequence;
 using ::testing::Invoke;
 using ::testing::InvokeWithoutArgs;
@@ -24,15 +31,22 @@ using ::testing::IsNull;
 using ::testing::IsSubsetOf;
 using ::testing::IsSupersetOf;
 using ::testing::IsTrue;
+using ::testing::Le;
+using ::testing::Lt;
 using ::testing::Mock;
 using ::testing::MockFunction;
 using ::testing::Ne;
 using ::testing::NiceMock;
+using ::testing::Not;
 using ::testing::NotNull;
+using ::testing::Optional;
 using ::testing::Pointee;
 using ::testing::Return;
 using ::testing::ReturnRef;
+using ::testing::ReturnRefOfCopy;
+using ::testing::SaveArg;
 using ::testing::SetArgPointee;
+using ::testing::SizeIs;
 using ::testing::StrEq;
 using ::testing::StrictMock;
 using ::testing::Test;
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace im3e {
+
+/// @brief Histogram of the durations recorded over a rolling time window, with a fixed memory footprint.
+/// Durations are counted in logarithmic buckets (HDR histogram style): each power of two is split in 16 linear
+/// sub-buckets, percentiles being precise to ~6%. The window is made of time slices recycled as time passes.
+/// Recording is lock-free and never allocates. Samples recorded while their slice is recycled by another thread may be
+/// lost.
+class DurationHistogram
+{
+public:
+    explicit DurationHistogram(std::chrono::milliseconds windowDuration = std::chrono::seconds(1));
+
+    DurationHistogram(const DurationHistogram&) = delete;
+    DurationHistogram& operator=(const DurationHistogram&) = delete;
+
+    /// @brief Record a duration ending at the given time. Durations older than the window are ignored.
+    void record(std::chrono::steady_clock::time_point time, std::chrono::nanoseconds duration);
+
+    struct Summary
+    {
+        uint64_t count{};
+        float frequency{};  ///< recorded durations per second over the window
+        std::chrono::nanoseconds average{};
+        std::chrono::nanoseconds p50{};
+        std::chrono::nanoseconds p95{};
+        std::chrono::nanoseconds p99{};
+        std::chrono::nanoseconds max{};
+    };
+
+    /// @brief Summarize the durations recorded in the window ending at the given time.
+    auto summarize(std::chrono::steady_clock::time_point time) const -> Summary;
+
+    auto getWindowDuration() const -> std::chrono::nanoseconds { return m_slicePeriod * SliceCount; }
+
+    /// @brief Index of the bucket counting the given duration, and lowest duration counted by a bucket.
+    static auto getBucketIndex(std::chrono::nanoseconds duration) -> uint32_t;
+    static auto getBucketLowerBound(uint32_t bucketIndex) -> std::chrono::nanoseconds;
+
+    static constexpr uint32_t SubBucketBits = 4U;
+    static constexpr uint32_t SubBucketCount = 1U << SubBucketBits;
+    // Durations up to 2^36ns (~68s) have their own buckets, longer ones are counted in the last bucket:
+    static constexpr uint32_t MaxDurationBits = 36U;
+    static constexpr uint32_t BucketCount = (MaxDurationBits - SubBucketBits + 1U) * SubBucketCount;
+
+private:
+    static constexpr uint32_t SliceCount = 10U;
+
+    struct Slice
+    {
+        std::atomic<int64_t> epoch{-1};  ///< index of the slice period the slice counts durations for
+        std::atomic<uint64_t> count{};
+        std::atomic<uint64_t> totalNs{};
+        std::atomic<uint64_t> maxNs{};
+        std::array<std::atomic<uint32_t>, BucketCount> bucketCounts{};
+    };
+    auto getEpoch(std::chrono::steady_clock::time_point time) const -> int64_t;
+
+    const std::chrono::nanoseconds m_slicePeriod;
+    std::array<Slice, SliceCount> m_slices;
+};
+
+}  // namespace im3e
@@ -12,6 +12,7 @@ public:
     ~MockStatsReceiver() override;
 
     MOCK_METHOD(void, onSpanAdded, (Span span), (override));
+    MOCK_METHOD(void, onMetricsUpdated, (std::vector<Metric> metrics), (override));
 };
 
 class MockStatsProvider : public IStatsProvider
@@ -22,6 +23,9 @@ public:
 
     MOCK_METHOD(void, addReceiver, (std::shared_ptr<IStatsReceiver> pReceiver), (override));
     MOCK_METHOD(void, removeReceiver, (std::shared_ptr<IStatsReceiver> pReceiver), (override));
+    MOCK_METHOD(void, flush, (), (override));
+    MOCK_METHOD(std::shared_ptr<Counter>, getCounter, (std::string_view name), (override));
+    MOCK_METHOD(std::shared_ptr<Gauge>, getGauge, (std::string_view name), (override));
 
     MOCK_METHOD(std::unique_ptr<IScopedSpan>, startScopedSpan, (std::string_view name), (override));
 
@@ -18,6 +18,9 @@ public:
 
     void addReceiver(shared_ptr<IStatsReceiver> pReceiver) override { m_rMock.addReceiver(move(pReceiver)); }
     void removeReceiver(shared_ptr<IStatsReceiver> pReceiver) override { m_rMock.removeReceiver(move(pReceiver)); }
+    void flush() override { m_rMock.flush(); }
+    auto getCounter(string_view name) -> shared_ptr<Counter> override { return m_rMock.getCounter(name); }
+    auto getGauge(string_view name) -> shared_ptr<Gauge> override { return m_rMock.getGauge(name); }
 
     auto startScopedSpan(string_view name) -> unique_ptr<IScopedSpan> override { return m_rMock.startScopedSpan(name); }
 
@@ -27,7 +30,12 @@ private:
 
 }  // namespace
 
-MockStatsProvider::MockStatsProvider() = default;
+MockStatsProvider::MockStatsProvider()
+{
+    // Metrics are updated by the code under test, they must exist even when not checked:
+    ON_CALL(*this, getCounter(_)).WillByDefault(Invoke([](Unused) { return make_shared<Counter>(); }));
+    ON_CALL(*this, getGauge(_)).WillByDefault(Invoke([](Unused) { return make_shared<Gauge>(); }));
+}
 MockStatsProvider::~MockStatsProvider() = default;
 
 auto MockStatsProvider::createMockProxy() -> unique_ptr<IStatsProvider>
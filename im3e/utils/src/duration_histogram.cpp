@@ -0,0 +1,144 @@
+#include "duration_histogram.h"
+
+#include <im3e/utils/core/throw_utils.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace im3e;
+using namespace std;
+using namespace std::chrono;
+
+DurationHistogram::DurationHistogram(milliseconds windowDuration)
+  : m_slicePeriod(duration_cast<nanoseconds>(windowDuration) / SliceCount)
+{
+    throwIfFalse<invalid_argument>(m_slicePeriod.count() > 0,
+                                   fmt::format("Invalid duration histogram window: {}ms", windowDuration.count()));
+}
+
+void DurationHistogram::record(steady_clock::time_point time, nanoseconds duration)
+{
+    const auto epoch = this->getEpoch(time);
+    auto& rSlice = m_slices[static_cast<size_t>(epoch) % SliceCount];
+
+    // The first duration of a new period recycles the slice, which counted durations one window earlier:
+    auto sliceEpoch = rSlice.epoch.load(memory_order_acquire);
+    if (sliceEpoch < epoch)
+    {
+        if (rSlice.epoch.compare_exchange_strong(sliceEpoch, epoch, memory_order_acq_rel))
+        {
+            rSlice.count.store(0U, memory_order_relaxed);
+            rSlice.totalNs.store(0U, memory_order_relaxed);
+            rSlice.maxNs.store(0U, memory_order_relaxed);
+            for (auto& rBucketCount : rSlice.bucketCounts)
+            {
+                rBucketCount.store(0U, memory_order_relaxed);
+            }
+            sliceEpoch = epoch;
+        }
+    }
+    if (sliceEpoch != epoch)
+    {
+        return;
+    }
+
+    const auto durationNs = static_cast<uint64_t>(max(duration.count(), nanoseconds::rep{}));
+    rSlice.bucketCounts[getBucketIndex(nanoseconds(durationNs))].fetch_add(1U, memory_order_relaxed);
+    rSlice.totalNs.fetch_add(durationNs, memory_order_relaxed);
+    auto maxNs = rSlice.maxNs.load(memory_order_relaxed);
+    while (durationNs > maxNs && !rSlice.maxNs.compare_exchange_weak(maxNs, durationNs, memory_order_relaxed))
+    {
+    }
+    rSlice.count.fetch_add(1U, memory_order_release);
+}
+
+auto DurationHistogram::summarize(steady_clock::time_point time) const -> Summary
+{
+    const auto epoch = this->getEpoch(time);
+
+    Summary summary{};
+    uint64_t totalNs{};
+    uint64_t maxNs{};
+    array<uint64_t, BucketCount> bucketCounts{};
+    for (auto& rSlice : m_slices)
+    {
+        const auto sliceEpoch = rSlice.epoch.load(memory_order_acquire);
+        if (sliceEpoch > epoch || sliceEpoch <= epoch - static_cast<int64_t>(SliceCount))
+        {
+            continue;
+        }
+        summary.count += rSlice.count.load(memory_order_acquire);
+        totalNs += rSlice.totalNs.load(memory_order_relaxed);
+        maxNs = max(maxNs, rSlice.maxNs.load(memory_order_relaxed));
+        for (uint32_t bucketIndex = 0U; bucketIndex < BucketCount; bucketIndex++)
+        {
+            bucketCounts[bucketIndex] += rSlice.bucketCounts[bucketIndex].load(memory_order_relaxed);
+        }
+    }
+    if (summary.count == 0U)
+    {
+        return summary;
+    }
+
+    // The current slice only covers the time elapsed since the start of its period:
+    const auto windowDuration = m_slicePeriod * (SliceCount - 1U) + (time.time_since_epoch() - m_slicePeriod * epoch);
+    summary.frequency = static_cast<float>(summary.count / duration<double>(windowDuration).count());
+    summary.average = nanoseconds(totalNs / summary.count);
+    summary.max = nanoseconds(maxNs);
+
+    // Percentiles are reported as the middle of the bucket containing them:
+    const auto findPercentile = [&](double percentile) {
+        const auto rank = max(static_cast<uint64_t>(ceil(percentile * summary.count)), uint64_t{1U});
+        uint64_t cumulatedCount{};
+        for (uint32_t bucketIndex = 0U; bucketIndex < BucketCount; bucketIndex++)
+        {
+            cumulatedCount += bucketCounts[bucketIndex];
+            if (cumulatedCount >= rank)
+            {
+                const auto lowerBound = getBucketLowerBound(bucketIndex);
+                const auto upperBound = bucketIndex + 1U < BucketCount ? getBucketLowerBound(bucketIndex + 1U)
+                                                                        : lowerBound;
+                return min((lowerBound + upperBound) / 2, summary.max);
+            }
+        }
+        return summary.max;
+    };
+    summary.p50 = findPercentile(0.5);
+    summary.p95 = findPercentile(0.95);
+    summary.p99 = findPercentile(0.99);
+    return summary;
+}
+
+auto DurationHistogram::getBucketIndex(nanoseconds duration) -> uint32_t
+{
+    const auto durationNs = static_cast<uint64_t>(max(duration.count(), nanoseconds::rep{}));
+    if (durationNs < SubBucketCount)
+    {
+        return static_cast<uint32_t>(durationNs);
+    }
+
+    // Durations are bucketed by their highest bit, then by the SubBucketBits bits that follow it:
+    const auto highestBit = static_cast<uint32_t>(bit_width(durationNs)) - 1U;
+    const auto subBucketIndex = static_cast<uint32_t>(durationNs >> (highestBit - SubBucketBits)) - SubBucketCount;
+    const auto bucketIndex = (highestBit - SubBucketBits + 1U) * SubBucketCount + subBucketIndex;
+    return min(bucketIndex, BucketCount - 1U);
+}
+
+auto DurationHistogram::getBucketLowerBound(uint32_t bucketIndex) -> nanoseconds
+{
+    if (bucketIndex < SubBucketCount)
+    {
+        return nanoseconds(bucketIndex);
+    }
+    const auto highestBit = bucketIndex / SubBucketCount + SubBucketBits - 1U;
+    const auto subBucketIndex = bucketIndex % SubBucketCount;
+    return nanoseconds(static_cast<int64_t>(uint64_t{SubBucketCount + subBucketIndex} << (highestBit - SubBucketBits)));
+}
+
+auto DurationHistogram::getEpoch(steady_clock::time_point time) const -> int64_t
+{
+    return time.time_since_epoch() / m_slicePeriod;
+}
@@ -2,12 +2,22 @@
 
 #include <im3e/utils/core/throw_utils.h>
 
+#include <fmt/format.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
 #include <mutex>
-#include <optional>
+#include <new>
 #include <set>
-#include <stack>
+#include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
 using namespace im3e;
@@ -16,14 +26,166 @@ using namespace std::chrono;
 
 namespace {
 
-class StatsProvider : public IStatsProvider, public enable_shared_from_this<StatsProvider>
+// Spans are recorded by ID, each ID identifying the path of a span i.e. the name of the span and the ID of its parent:
+using SpanID = uint32_t;
+constexpr SpanID RootSpanID = 0U;
+
+struct SpanRecord
+{
+    SpanID spanID;
+    steady_clock::time_point startTime;
+    steady_clock::time_point endTime;
+};
+
+/// @brief Lock-free ring buffer of the spans completed by a thread, drained by the collector.
+/// There is a single producer, the thread recording the spans, and a single consumer at a time.
+class SpanRing
+{
+public:
+    /// @return False if the ring is full, in which case the span is dropped rather than blocking the recording thread.
+    auto push(const SpanRecord& rRecord) -> bool
+    {
+        // The tail written by the consumer is only reloaded when the ring looks full, sparing the producer a cache miss:
+        const auto head = m_head.load(memory_order_relaxed);
+        if (head - m_cachedTail == Capacity)
+        {
+            m_cachedTail = m_tail.load(memory_order_acquire);
+            if (head - m_cachedTail == Capacity)
+            {
+                return false;
+            }
+        }
+        m_records[head & (Capacity - 1U)] = rRecord;
+        m_head.store(head + 1U, memory_order_release);
+        return true;
+    }
+
+    void popAll(vector<SpanRecord>& rRecords)
+    {
+        const auto tail = m_tail.load(memory_order_relaxed);
+        const auto head = m_head.load(memory_order_acquire);
+        for (auto index = tail; index != head; index++)
+        {
+            rRecords.emplace_back(m_records[index & (Capacity - 1U)]);
+        }
+        m_tail.store(head, memory_order_release);
+    }
+
+private:
+    // Enough for the spans of a thread recording a million spans per second between two collections:
+    static constexpr size_t Capacity = 16U * 1024U;
+
+    array<SpanRecord, Capacity> m_records;
+    alignas(64) atomic<size_t> m_head{};
+    size_t m_cachedTail{};
+    alignas(64) atomic<size_t> m_tail{};
+};
+
+/// @brief Recording state of a thread for a given provider, only accessed by that thread except for its ring.
+struct ThreadState
+{
+    SpanRing ring;
+    vector<SpanID> activeSpanIDs{RootSpanID};
+
+    // Span IDs already interned by this thread, by parent ID and name:
+    struct NameKey
+    {
+        SpanID parentID;
+        string name;
+
+        auto operator==(const NameKey&) const -> bool = default;
+    };
+    struct NameKeyHash
+    {
+        auto operator()(const NameKey& rKey) const -> size_t
+        {
+            return hash<string>{}(rKey.name) ^ static_cast<size_t>(rKey.parentID);
+        }
+    };
+    unordered_map<NameKey, SpanID, NameKeyHash> internedSpanIDs;
+
+    // Direct-mapped cache of the interned span IDs, indexed by the address of the name so that looking up a span
+    // recorded with the same name as before neither hashes nor allocates. Names are still compared on lookup since
+    // different names may be stored at the same address over time:
+    struct CachedSpan
+    {
+        const char* pNameData{};
+        const NameKey* pKey{};
+        SpanID spanID = RootSpanID;
+    };
+    static constexpr size_t SpanCacheSize = 64U;
+    array<CachedSpan, SpanCacheSize> spanCache{};
+
+    // Storage of the spans being recorded, by depth, since the spans of a thread end in the reverse order they started.
+    // Deeper spans are allocated on the heap:
+    static constexpr size_t SpanSlotSize = 32U;
+    static constexpr size_t SpanSlotCount = 32U;
+    struct SpanSlot
+    {
+        alignas(max_align_t) byte data[SpanSlotSize];
+    };
+    array<SpanSlot, SpanSlotCount> spanSlots;
+
+    const thread::id threadId{this_thread::get_id()};
+    atomic_bool threadExited{};
+};
+
+/// @brief Recording states of the calling thread, by provider ID.
+/// States are owned by their provider, which frees them when destroyed. Provider IDs are never reused so states of
+/// destroyed providers are never looked up again, their expired entries are removed when a state is added.
+struct ThreadStates
+{
+    ~ThreadStates()
+    {
+        for (auto& [rProviderID, rpThreadState] : pThreadStates)
+        {
+            if (auto pThreadState = rpThreadState.lock())
+            {
+                pThreadState->threadExited = true;
+            }
+        }
+    }
+
+    unordered_map<uint64_t, weak_ptr<ThreadState>> pThreadStates;
+};
+thread_local ThreadStates t_threadStates;
+
+// State of the provider used last by the calling thread, looked up first. Kept apart from t_threadStates since thread
+// locals without destructor are accessed without checking that they are initialized:
+struct LastThreadState
+{
+    uint64_t providerID{};
+    ThreadState* pThreadState{};
+};
+constinit thread_local LastThreadState t_lastThreadState;
+
+class StatsProvider : public IStatsProvider
 {
 public:
+    StatsProvider()
+      : m_providerID(s_nextProviderID++)
+      , m_collectorThread([this] { this->runCollector(); })
+    {
+    }
+
+    ~StatsProvider() override
+    {
+        {
+            lock_guard lk(m_collectorMutex);
+            m_stopping = true;
+        }
+        m_collectorWakeUp.notify_one();
+        m_collectorThread.join();
+
+        // Deliver the spans completed before the provider was destroyed:
+        this->flush();
+    }
+
     void addReceiver(shared_ptr<IStatsReceiver> pReceiver) override
     {
         throwIfArgNull(pReceiver, "Cannot add null receiver to stats provider");
 
-        lock_guard lk(m_mutex);
+        lock_guard lk(m_receiversMutex);
         m_pReceivers.emplace(move(pReceiver));
     }
 
@@ -31,57 +193,277 @@ public:
     {
         throwIfArgNull(pReceiver, "Cannot remove null receiver from stats provider");
 
-        lock_guard lk(m_mutex);
+        lock_guard lk(m_receiversMutex);
         m_pReceivers.erase(pReceiver);
     }
 
-    class ScopedSpan : public IScopedSpan
+    void flush() override
+    {
+        this->deliverSpans();
+        this->deliverMetrics();
+    }
+
+    auto getCounter(string_view name) -> shared_ptr<Counter> override { return this->getMetric<Counter>(name); }
+    auto getGauge(string_view name) -> shared_ptr<Gauge> override { return this->getMetric<Gauge>(name); }
+
+    class ScopedSpan final : public IScopedSpan
     {
     public:
-        ScopedSpan(shared_ptr<StatsProvider> pProvider, filesystem::path spanPath)
-          : m_pProvider(throwIfArgNull(move(pProvider), "ScopedSpan requires a StatsProvider"))
-          , m_span(Span{
-                .path = move(spanPath),
-                .startTime = steady_clock::now(),
-            })
+        ScopedSpan(ThreadState& rThreadState, SpanID spanID) noexcept
+          : m_rThreadState(rThreadState)
+          , m_spanID(spanID)
+          , m_startTime(steady_clock::now())
         {
         }
 
         ~ScopedSpan() override
         {
-            m_span.endTime = steady_clock::now();
-            {
-                lock_guard lk(m_pProvider->m_mutex);
-                for (auto& pReceiver : m_pProvider->m_pReceivers)
-                {
-                    pReceiver->onSpanAdded(m_span);
-                }
+            const auto endTime = steady_clock::now();
 
-                auto& rActiveSpans = m_pProvider->m_threadToActiveSpans[this_thread::get_id()];
-                throwIfFalse<logic_error>(!rActiveSpans.empty() && m_span.path == rActiveSpans.top(),
-                                          "Incorrect active span being removed");
-                rActiveSpans.pop();
+            auto& rActiveSpanIDs = m_rThreadState.activeSpanIDs;
+            throwIfFalse<logic_error>(rActiveSpanIDs.size() > 1U && rActiveSpanIDs.back() == m_spanID,
+                                      "Incorrect active span being removed");
+            rActiveSpanIDs.pop_back();
+
+            // Spans that do not fit in a full ring are dropped rather than blocking the recording thread:
+            m_rThreadState.ring.push(SpanRecord{.spanID = m_spanID, .startTime = m_startTime, .endTime = endTime});
+        }
+
+        /// @brief Allocate the span in the slot of its depth, once its ID was added to the active spans.
+        static auto operator new(size_t size, ThreadState& rThreadState) -> void*
+        {
+            static_assert(sizeof(ScopedSpan) <= ThreadState::SpanSlotSize);
+            const auto depth = rThreadState.activeSpanIDs.size() - 2U;
+            return (depth < ThreadState::SpanSlotCount) ? rThreadState.spanSlots[depth].data : ::operator new(size);
+        }
+        static void operator delete(ScopedSpan* pSpan, destroying_delete_t)
+        {
+            const auto depth = pSpan->m_rThreadState.activeSpanIDs.size() - 2U;
+            pSpan->~ScopedSpan();
+            if (depth >= ThreadState::SpanSlotCount)
+            {
+                ::operator delete(pSpan);
             }
         }
 
     private:
-        shared_ptr<StatsProvider> m_pProvider;
-        Span m_span;
+        ThreadState& m_rThreadState;
+        const SpanID m_spanID;
+        const steady_clock::time_point m_startTime;
     };
     auto startScopedSpan(string_view name) -> unique_ptr<IScopedSpan> override
     {
-        lock_guard lk(m_mutex);
-        auto& rActiveSpans = m_threadToActiveSpans[this_thread::get_id()];
-        auto spanPath = (rActiveSpans.empty() ? m_rootPath : rActiveSpans.top()) / name;
-        rActiveSpans.emplace(spanPath);
-        return make_unique<ScopedSpan>(this->shared_from_this(), move(spanPath));
+        auto& rThreadState = (t_lastThreadState.providerID == m_providerID) ? *t_lastThreadState.pThreadState
+                                                                             : this->getThreadState();
+        const auto spanID = this->internSpan(rThreadState, rThreadState.activeSpanIDs.back(), name);
+        rThreadState.activeSpanIDs.emplace_back(spanID);
+        return unique_ptr<IScopedSpan>(new (rThreadState) ScopedSpan(rThreadState, spanID));
     }
 
 private:
-    const filesystem::path m_rootPath{"/", filesystem::path::generic_format};
-    mutex m_mutex;
+    auto getThreadState() -> ThreadState&
+    {
+        // Threads may record spans for several providers:
+        auto& rpThreadState = t_threadStates.pThreadStates[m_providerID];
+        auto pThreadState = rpThreadState.lock();
+        if (!pThreadState)
+        {
+            erase_if(t_threadStates.pThreadStates, [](auto& rEntry) { return rEntry.second.expired(); });
+
+            pThreadState = make_shared<ThreadState>();
+            t_threadStates.pThreadStates[m_providerID] = pThreadState;
+
+            lock_guard lk(m_threadStatesMutex);
+            m_pThreadStates.emplace_back(pThreadState);
+        }
+        t_lastThreadState = LastThreadState{.providerID = m_providerID, .pThreadState = pThreadState.get()};
+        return *pThreadState;
+    }
+
+    auto internSpan(ThreadState& rThreadState, SpanID parentID, string_view name) -> SpanID
+    {
+        constexpr auto CacheMask = ThreadState::SpanCacheSize - 1U;
+        const auto cacheIndex = ((reinterpret_cast<uintptr_t>(name.data()) >> 3U) ^ parentID) & CacheMask;
+        auto& rCachedSpan = rThreadState.spanCache[cacheIndex];
+        if (rCachedSpan.pNameData == name.data() && rCachedSpan.pKey->parentID == parentID &&
+            rCachedSpan.pKey->name == name)
+        {
+            return rCachedSpan.spanID;
+        }
+
+        // Not in the cache: first time this thread records the span, or another span was cached at this index:
+        auto itInterned = rThreadState.internedSpanIDs.find(ThreadState::NameKey{.parentID = parentID,
+                                                                                 .name = string(name)});
+        if (itInterned == rThreadState.internedSpanIDs.end())
+        {
+            lock_guard lk(m_internMutex);
+            auto [itSpanID, inserted] = m_spanIDs.try_emplace(pair{parentID, string(name)}, RootSpanID);
+            if (inserted)
+            {
+                itSpanID->second = static_cast<SpanID>(m_spanPaths.size());
+                m_spanPaths.emplace_back(m_spanPaths[parentID] / name);
+            }
+            itInterned = rThreadState.internedSpanIDs
+                             .emplace(ThreadState::NameKey{.parentID = parentID, .name = string(name)},
+                                      itSpanID->second)
+                             .first;
+        }
+        rCachedSpan = ThreadState::CachedSpan{
+            .pNameData = name.data(),
+            .pKey = &itInterned->first,
+            .spanID = itInterned->second,
+        };
+        return rCachedSpan.spanID;
+    }
+
+    void deliverSpans()
+    {
+        lock_guard lk(m_drainMutex);
+
+        vector<shared_ptr<ThreadState>> pThreadStates;
+        {
+            lock_guard threadStatesLk(m_threadStatesMutex);
+            pThreadStates = m_pThreadStates;
+
+            // States of exited threads are drained one last time below:
+            erase_if(m_pThreadStates, [](auto& pThreadState) { return pThreadState->threadExited.load(); });
+        }
+
+        m_records.clear();
+        m_recordThreadIds.clear();
+        for (auto& pThreadState : pThreadStates)
+        {
+            pThreadState->ring.popAll(m_records);
+            m_recordThreadIds.resize(m_records.size(), pThreadState->threadId);
+        }
+        if (m_records.empty())
+        {
+            return;
+        }
+
+        vector<Span> spans;
+        spans.reserve(m_records.size());
+        {
+            lock_guard internLk(m_internMutex);
+            for (size_t recordIndex = 0U; recordIndex < m_records.size(); recordIndex++)
+            {
+                auto& rRecord = m_records[recordIndex];
+                spans.emplace_back(Span{
+                    .path = m_spanPaths[rRecord.spanID],
+                    .startTime = rRecord.startTime,
+                    .endTime = rRecord.endTime,
+                    .threadId = m_recordThreadIds[recordIndex],
+                });
+            }
+        }
+
+        lock_guard receiversLk(m_receiversMutex);
+        for (auto& rSpan : spans)
+        {
+            for (auto& pReceiver : m_pReceivers)
+            {
+                pReceiver->onSpanAdded(rSpan);
+            }
+        }
+    }
+
+    void deliverMetrics()
+    {
+        vector<Metric> metrics;
+        {
+            lock_guard lk(m_metricsMutex);
+            metrics.reserve(m_pMetrics.size());
+            for (auto& [rName, rpMetric] : m_pMetrics)
+            {
+                if (auto ppCounter = get_if<shared_ptr<Counter>>(&rpMetric))
+                {
+                    metrics.emplace_back(Metric{
+                        .name = rName,
+                        .type = MetricType::Counter,
+                        .value = (*ppCounter)->getValue(),
+                    });
+                }
+                else
+                {
+                    metrics.emplace_back(Metric{
+                        .name = rName,
+                        .type = MetricType::Gauge,
+                        .value = get<shared_ptr<Gauge>>(rpMetric)->getValue(),
+                    });
+                }
+            }
+        }
+        if (metrics.empty())
+        {
+            return;
+        }
+
+        lock_guard receiversLk(m_receiversMutex);
+        for (auto& pReceiver : m_pReceivers)
+        {
+            pReceiver->onMetricsUpdated(metrics);
+        }
+    }
+
+    template <typename T>
+    auto getMetric(string_view name) -> shared_ptr<T>
+    {
+        lock_guard lk(m_metricsMutex);
+        auto itMetric = m_pMetrics.find(name);
+        if (itMetric == m_pMetrics.end())
+        {
+            itMetric = m_pMetrics.emplace(string(name), make_shared<T>()).first;
+        }
+        auto ppMetric = get_if<shared_ptr<T>>(&itMetric->second);
+        throwIfFalse<invalid_argument>(ppMetric != nullptr,
+                                       fmt::format("Stats metric \"{}\" already exists with another type", name));
+        return *ppMetric;
+    }
+
+    void runCollector()
+    {
+        constexpr auto CollectionPeriod = 10ms;
+        constexpr auto MetricsPeriod = 100ms;
+
+        auto lastMetricsTime = steady_clock::now();
+        unique_lock lk(m_collectorMutex);
+        while (!m_collectorWakeUp.wait_for(lk, CollectionPeriod, [this] { return m_stopping; }))
+        {
+            lk.unlock();
+            this->deliverSpans();
+            if (const auto time = steady_clock::now(); time - lastMetricsTime >= MetricsPeriod)
+            {
+                this->deliverMetrics();
+                lastMetricsTime = time;
+            }
+            lk.lock();
+        }
+    }
+
+    static inline atomic_uint64_t s_nextProviderID{1U};
+    const uint64_t m_providerID;
+
+    mutex m_receiversMutex;
     set<shared_ptr<IStatsReceiver>> m_pReceivers;
-    unordered_map<thread::id, stack<filesystem::path>> m_threadToActiveSpans;
+
+    mutex m_internMutex;
+    map<pair<SpanID, string>, SpanID> m_spanIDs;
+    deque<filesystem::path> m_spanPaths{filesystem::path{"/", filesystem::path::generic_format}};
+
+    mutex m_threadStatesMutex;
+    vector<shared_ptr<ThreadState>> m_pThreadStates;
+
+    mutex m_drainMutex;
+    vector<SpanRecord> m_records;
+    vector<thread::id> m_recordThreadIds;
+
+    mutex m_metricsMutex;
+    map<string, variant<shared_ptr<Counter>, shared_ptr<Gauge>>, less<>> m_pMetrics;
+
+    mutex m_collectorMutex;
+    condition_variable m_collectorWakeUp;
+    bool m_stopping{};
+    thread m_collectorThread;
 };
 
 }  // namespace
@@ -89,4 +471,4 @@ private:
 auto im3e::createStatsProvider() -> shared_ptr<IStatsProvider>
 {
     return make_unique<StatsProvider>();
-}
\ No newline at end of file
+}
@@ -0,0 +1,82 @@
+#include "thread_pool.h"
+
+#include <im3e/utils/core/throw_utils.h>
+
+#include <algorithm>
+
+using namespace im3e;
+using namespace std;
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    throwIfFalse<invalid_argument>(threadCount > 0U, "Thread pool requires at least one thread");
+
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0U; i < threadCount; i++)
+    {
+        m_threads.emplace_back([this] { this->runWorker(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard lk(m_mutex);
+        m_stopping = true;
+    }
+    m_taskAvailable.notify_all();
+
+    for (auto& rThread : m_threads)
+    {
+        rThread.join();
+    }
+}
+
+void ThreadPool::submit(function<void()> task)
+{
+    throwIfArgNull(task, "Cannot submit an empty task to a thread pool");
+    {
+        lock_guard lk(m_mutex);
+        m_tasks.emplace_back(move(task));
+    }
+    m_taskAvailable.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+    unique_lock lk(m_mutex);
+    m_idle.wait(lk, [this] { return m_tasks.empty() && m_runningTaskCount == 0U; });
+}
+
+auto ThreadPool::getDefaultThreadCount() -> uint32_t
+{
+    return max(1U, thread::hardware_concurrency());
+}
+
+void ThreadPool::runWorker()
+{
+    unique_lock lk(m_mutex);
+    while (true)
+    {
+        m_taskAvailable.wait(lk, [this] { return m_stopping || !m_tasks.empty(); });
+        if (m_tasks.empty())
+        {
+            // Only reachable when stopping: remaining tasks are always drained before workers exit.
+            return;
+        }
+
+        auto task = move(m_tasks.front());
+        m_tasks.pop_front();
+        m_runningTaskCount++;
+
+        lk.unlock();
+        task();
+        lk.lock();
+
+        m_runningTaskCount--;
+        if (m_tasks.empty() && m_runningTaskCount == 0U)
+        {
+            m_idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,188 @@
+#include "stats.h"
+
+#include <im3e/utils/core/throw_utils.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace im3e;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+auto escapeJson(string_view text) -> string
+{
+    string escapedText;
+    escapedText.reserve(text.size());
+    for (auto c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escapedText += '\\';
+            escapedText += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20U)
+        {
+            escapedText += fmt::format("\\u{:04x}", static_cast<uint32_t>(c));
+        }
+        else
+        {
+            escapedText += c;
+        }
+    }
+    return escapedText;
+}
+
+/// @brief Receiver writing spans as complete events ("ph": "X") of the Chrome trace event format, and metrics as
+/// counter events ("ph": "C"). Spans of a thread are nested by the viewers from their times, threads are numbered in
+/// the order they are first seen.
+class TraceFileStatsReceiver : public IStatsReceiver
+{
+public:
+    explicit TraceFileStatsReceiver(const filesystem::path& rFilePath)
+      : m_file(rFilePath, ios::trunc)
+    {
+        throwIfFalse<runtime_error>(m_file.is_open(),
+                                    fmt::format("Failed to create trace file \"{}\"", rFilePath.generic_string()));
+        m_file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+        m_writerThread = thread([this] { this->runWriter(); });
+    }
+
+    ~TraceFileStatsReceiver() override
+    {
+        {
+            lock_guard lk(m_mutex);
+            m_stopping = true;
+        }
+        m_eventsAvailable.notify_one();
+        m_writerThread.join();
+
+        m_file << "\n]}\n";
+    }
+
+    void onSpanAdded(Span span) override
+    {
+        lock_guard lk(m_mutex);
+        m_pendingSpans.emplace_back(move(span));
+    }
+
+    void onMetricsUpdated(vector<Metric> metrics) override
+    {
+        const auto time = steady_clock::now();
+
+        lock_guard lk(m_mutex);
+        m_pendingMetrics.emplace_back(time, move(metrics));
+    }
+
+private:
+    using MetricsSnapshot = pair<steady_clock::time_point, vector<Metric>>;
+
+    void runWriter()
+    {
+        constexpr auto WritePeriod = 100ms;
+
+        vector<Span> spans;
+        vector<MetricsSnapshot> metricsSnapshots;
+        unique_lock lk(m_mutex);
+        while (true)
+        {
+            const auto stopping = m_eventsAvailable.wait_for(lk, WritePeriod, [this] { return m_stopping; });
+            swap(spans, m_pendingSpans);
+            swap(metricsSnapshots, m_pendingMetrics);
+
+            lk.unlock();
+            for (auto& rSpan : spans)
+            {
+                this->writeSpan(rSpan);
+            }
+            for (auto& [rTime, rMetrics] : metricsSnapshots)
+            {
+                this->writeMetrics(rTime, rMetrics);
+            }
+            spans.clear();
+            metricsSnapshots.clear();
+            m_file.flush();
+            lk.lock();
+
+            if (stopping)
+            {
+                return;
+            }
+        }
+    }
+
+    void writeSpan(const Span& rSpan)
+    {
+        auto [itTid, inserted] = m_tids.try_emplace(rSpan.threadId, static_cast<uint32_t>(m_tids.size()) + 1U);
+        if (inserted)
+        {
+            m_file << fmt::format("{}\n{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": {}, "
+                                  "\"args\": {{\"name\": \"Thread {}\"}}}}",
+                                  m_firstEvent ? "" : ",", itTid->second, itTid->second);
+            m_firstEvent = false;
+        }
+
+        // Times are written in microseconds, the unit of the trace event format:
+        const auto startTime = duration<double, micro>(rSpan.startTime.time_since_epoch());
+        const auto spanDuration = duration<double, micro>(rSpan.endTime - rSpan.startTime);
+        m_file << fmt::format("{}\n{{\"name\": \"{}\", \"cat\": \"im3e\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, "
+                              "\"ts\": {:.3f}, \"dur\": {:.3f}, \"args\": {{\"path\": \"{}\"}}}}",
+                              m_firstEvent ? "" : ",", escapeJson(rSpan.path.filename().generic_string()),
+                              itTid->second, startTime.count(), spanDuration.count(),
+                              escapeJson(rSpan.path.generic_string()));
+        m_firstEvent = false;
+    }
+
+    void writeMetrics(steady_clock::time_point time, const vector<Metric>& rMetrics)
+    {
+        const auto timestamp = duration<double, micro>(time.time_since_epoch());
+        for (auto& rMetric : rMetrics)
+        {
+            m_file << fmt::format("{}\n{{\"name\": \"{}\", \"cat\": \"im3e\", \"ph\": \"C\", \"pid\": 1, "
+                                  "\"ts\": {:.3f}, \"args\": {{\"value\": {}}}}}",
+                                  m_firstEvent ? "" : ",", escapeJson(rMetric.name), timestamp.count(), rMetric.value);
+            m_firstEvent = false;
+        }
+    }
+
+    ofstream m_file;
+    map<thread::id, uint32_t> m_tids;
+    bool m_firstEvent = true;
+
+    mutex m_mutex;
+    condition_variable m_eventsAvailable;
+    vector<Span> m_pendingSpans;
+    vector<MetricsSnapshot> m_pendingMetrics;
+    bool m_stopping{};
+    thread m_writerThread;
+};
+
+}  // namespace
+
+auto im3e::createTraceFileStatsReceiver(const filesystem::path& rFilePath) -> shared_ptr<IStatsReceiver>
+{
+    return make_shared<TraceFileStatsReceiver>(rFilePath);
+}
+
+auto im3e::extractTraceFilePath(vector<string_view>& rArgs) -> optional<filesystem::path>
+{
+    auto itTraceArg = ranges::find(rArgs, "--trace");
+    if (itTraceArg == rArgs.end())
+    {
+        return nullopt;
+    }
+    throwIfFalse<invalid_argument>(next(itTraceArg) != rArgs.end(), "Missing trace file path after --trace");
+    filesystem::path traceFilePath{*next(itTraceArg)};
+    rArgs.erase(itTraceArg, next(itTraceArg, 2));
+    return traceFilePath;
+}
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 namespace im3e {
 
@@ -12,16 +18,60 @@ struct Span
     std::filesystem::path path;
     std::chrono::steady_clock::time_point startTime;
     std::chrono::steady_clock::time_point endTime;
+    std::thread::id threadId;  ///< thread that recorded the span
 };
 
+enum class MetricType
+{
+    Counter,  ///< number of events since the metric was created, e.g. tiles read
+    Gauge,    ///< current level of a quantity, e.g. bytes in use
+};
+
+struct Metric
+{
+    std::string name;
+    MetricType type;
+    int64_t value;
+};
+
+/// @brief Receiver of the spans of a stats provider, which calls it from one thread at a time.
 class IStatsReceiver
 {
 public:
     virtual ~IStatsReceiver() = default;
 
     virtual void onSpanAdded(Span span) = 0;
+
+    /// @brief Receive the current values of all the metrics of the provider, sorted by name.
+    virtual void onMetricsUpdated(std::vector<Metric> metrics) = 0;
 };
 
+/// @brief Number of events published by a stats provider, cheap to increment from any thread.
+class Counter
+{
+public:
+    void add(int64_t count = 1) { m_value.fetch_add(count, std::memory_order_relaxed); }
+    auto getValue() const -> int64_t { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value{};
+};
+
+/// @brief Level of a quantity published by a stats provider, cheap to update from any thread.
+class Gauge
+{
+public:
+    void set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) { m_value.fetch_add(delta, std::memory_order_relaxed); }
+    auto getValue() const -> int64_t { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value{};
+};
+
+/// @brief Records spans from any thread and delivers them to its receivers.
+/// Spans are delivered asynchronously, from a collector thread, in the order they completed on each thread. Spans
+/// recorded by different threads are not ordered.
 class IStatsProvider
 {
 public:
@@ -30,14 +80,35 @@ public:
     virtual void addReceiver(std::shared_ptr<IStatsReceiver> pReceiver) = 0;
     virtual void removeReceiver(std::shared_ptr<IStatsReceiver> pReceiver) = 0;
 
+    /// @brief Deliver the spans completed so far and the current metrics to the receivers, blocking until they are
+    /// delivered.
+    virtual void flush() = 0;
+
+    /// @brief Counter or gauge published under the given name, created on first use.
+    /// The values of all metrics are delivered to the receivers periodically, from the collector thread. Names are
+    /// shared by counters and gauges: getting a metric that exists with the other type throws.
+    virtual auto getCounter(std::string_view name) -> std::shared_ptr<Counter> = 0;
+    virtual auto getGauge(std::string_view name) -> std::shared_ptr<Gauge> = 0;
+
     class IScopedSpan
     {
     public:
         virtual ~IScopedSpan() = default;
     };
+    /// @brief Start a span nested in the span being recorded by the calling thread, which ends when destroyed.
+    /// Spans must be destroyed by the thread that started them, in the reverse order, before the provider.
     virtual auto startScopedSpan(std::string_view name) -> std::unique_ptr<IScopedSpan> = 0;
 };
 
 auto createStatsProvider() -> std::shared_ptr<IStatsProvider>;
 
+/// @brief Create a receiver streaming spans to a Chrome trace event JSON file, which can be opened in Perfetto or
+/// chrome://tracing. Spans are written by a background thread, the file is completed when the receiver is destroyed.
+auto createTraceFileStatsReceiver(const std::filesystem::path& rFilePath) -> std::shared_ptr<IStatsReceiver>;
+
+/// @brief Extract the trace file path given as "--trace traceFilePath" from command line arguments, if any.
+/// The option and its path are removed from the arguments so that the remaining ones can be parsed by position.
+/// @throw std::invalid_argument if the option is not followed by a path.
+auto extractTraceFilePath(std::vector<std::string_view>& rArgs) -> std::optional<std::filesystem::path>;
+
 }  // namespace im3e
\ No newline at end of file
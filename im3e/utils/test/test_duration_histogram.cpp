@@ -0,0 +1,111 @@
+#include "duration_histogram.h"
+
+#include <im3e/test_utils/test_utils.h>
+
+using namespace im3e;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+const steady_clock::time_point TestStartTime{1h};
+
+}  // namespace
+
+TEST(DurationHistogramTest, constructorThrowsWithEmptyWindow)
+{
+    EXPECT_THROW(DurationHistogram(0ms), invalid_argument);
+}
+
+TEST(DurationHistogramTest, bucketsCoverDurationsContiguously)
+{
+    EXPECT_THAT(DurationHistogram::getBucketIndex(0ns), Eq(0U));
+    EXPECT_THAT(DurationHistogram::getBucketIndex(-5ns), Eq(0U));
+    EXPECT_THAT(DurationHistogram::getBucketIndex(hours(24)), Eq(DurationHistogram::BucketCount - 1U));
+    for (uint32_t bucketIndex = 0U; bucketIndex < DurationHistogram::BucketCount; bucketIndex++)
+    {
+        const auto lowerBound = DurationHistogram::getBucketLowerBound(bucketIndex);
+        EXPECT_THAT(DurationHistogram::getBucketIndex(lowerBound), Eq(bucketIndex));
+        if (bucketIndex > 0U)
+        {
+            EXPECT_THAT(DurationHistogram::getBucketIndex(lowerBound - 1ns), Eq(bucketIndex - 1U));
+        }
+    }
+}
+
+TEST(DurationHistogramTest, bucketsArePreciseToSixPercent)
+{
+    for (uint32_t bucketIndex = DurationHistogram::SubBucketCount; bucketIndex + 1U < DurationHistogram::BucketCount;
+         bucketIndex++)
+    {
+        const auto lowerBound = DurationHistogram::getBucketLowerBound(bucketIndex);
+        const auto upperBound = DurationHistogram::getBucketLowerBound(bucketIndex + 1U);
+        EXPECT_THAT(static_cast<double>((upperBound - lowerBound).count()) / lowerBound.count(), Le(1.0 / 16.0));
+    }
+}
+
+TEST(DurationHistogramTest, emptySummary)
+{
+    DurationHistogram histogram;
+    const auto summary = histogram.summarize(TestStartTime);
+    EXPECT_THAT(summary.count, Eq(0U));
+    EXPECT_THAT(summary.frequency, FloatEq(0.0F));
+    EXPECT_THAT(summary.max, Eq(0ns));
+}
+
+TEST(DurationHistogramTest, summarize)
+{
+    DurationHistogram histogram(1s);
+
+    // 1000 durations from 1ms to 1000ms, recorded over half a second:
+    for (uint32_t i = 1U; i <= 1000U; i++)
+    {
+        histogram.record(TestStartTime + i * 500us, milliseconds(i));
+    }
+
+    const auto summary = histogram.summarize(TestStartTime + 500ms);
+    EXPECT_THAT(summary.count, Eq(1000U));
+    EXPECT_THAT(summary.frequency, FloatEq(1000.0F / 0.9F));  // current slice has just started
+    EXPECT_THAT(summary.average, Eq(500500us));
+    EXPECT_THAT(summary.max, Eq(1000ms));
+
+    const auto expectPercentile = [](nanoseconds percentile, milliseconds expected) {
+        EXPECT_THAT(percentile.count(), Ge(expected.count() * 1'000'000 * 15 / 16)) << expected.count();
+        EXPECT_THAT(percentile.count(), Le(expected.count() * 1'000'000 * 17 / 16)) << expected.count();
+    };
+    expectPercentile(summary.p50, 500ms);
+    expectPercentile(summary.p95, 950ms);
+    expectPercentile(summary.p99, 990ms);
+}
+
+TEST(DurationHistogramTest, durationsLeaveTheWindow)
+{
+    DurationHistogram histogram(1s);
+    histogram.record(TestStartTime, 10ms);
+    histogram.record(TestStartTime + 600ms, 2ms);
+
+    EXPECT_THAT(histogram.summarize(TestStartTime + 900ms).count, Eq(2U));
+    EXPECT_THAT(histogram.summarize(TestStartTime + 900ms).max, Eq(10ms));
+
+    const auto summary = histogram.summarize(TestStartTime + 1100ms);
+    EXPECT_THAT(summary.count, Eq(1U));
+    EXPECT_THAT(summary.max, Eq(2ms));
+
+    // Recording reuses the slice of the first duration:
+    histogram.record(TestStartTime + 1050ms, 3ms);
+    EXPECT_THAT(histogram.summarize(TestStartTime + 1100ms).count, Eq(2U));
+    EXPECT_THAT(histogram.summarize(TestStartTime + 1100ms).max, Eq(3ms));
+
+    EXPECT_THAT(histogram.summarize(TestStartTime + 10s).count, Eq(0U));
+}
+
+TEST(DurationHistogramTest, durationsOlderThanTheWindowAreIgnored)
+{
+    DurationHistogram histogram(1s);
+    histogram.record(TestStartTime + 2s, 1ms);
+    histogram.record(TestStartTime, 5ms);
+
+    const auto summary = histogram.summarize(TestStartTime + 2s);
+    EXPECT_THAT(summary.count, Eq(1U));
+    EXPECT_THAT(summary.max, Eq(1ms));
+}
@@ -0,0 +1,351 @@
+#include "stats.h"
+
+#include <im3e/test_utils/test_utils.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace im3e;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+/// @brief Receiver recording the spans and metrics it receives, which are received from the collector thread.
+class StatsRecorder : public IStatsReceiver
+{
+public:
+    void onSpanAdded(Span span) override
+    {
+        lock_guard lk(m_mutex);
+        m_spans.emplace_back(move(span));
+    }
+
+    void onMetricsUpdated(vector<Metric> metrics) override
+    {
+        lock_guard lk(m_mutex);
+        m_metrics = move(metrics);
+    }
+
+    auto getMetrics() const -> vector<Metric>
+    {
+        lock_guard lk(m_mutex);
+        return m_metrics;
+    }
+
+    auto getSpans() const -> vector<Span>
+    {
+        lock_guard lk(m_mutex);
+        return m_spans;
+    }
+
+    auto getPathCounts() const -> map<string, uint32_t>
+    {
+        lock_guard lk(m_mutex);
+        map<string, uint32_t> pathCounts;
+        for (auto& rSpan : m_spans)
+        {
+            pathCounts[rSpan.path.generic_string()]++;
+        }
+        return pathCounts;
+    }
+
+private:
+    mutable mutex m_mutex;
+    vector<Span> m_spans;
+    vector<Metric> m_metrics;
+};
+
+auto isMetric(string_view name, MetricType type, int64_t value)
+{
+    return AllOf(Field(&Metric::name, Eq(name)), Field(&Metric::type, Eq(type)), Field(&Metric::value, Eq(value)));
+}
+
+}  // namespace
+
+TEST(StatsProviderTest, addReceiverThrowsWithNullReceiver)
+{
+    auto pStatsProvider = createStatsProvider();
+    EXPECT_THROW(pStatsProvider->addReceiver(nullptr), invalid_argument);
+}
+
+TEST(StatsProviderTest, flushDeliversNestedSpans)
+{
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pStatsRecorder);
+    {
+        auto pParentSpan = pStatsProvider->startScopedSpan("parent");
+        auto pChildSpan = pStatsProvider->startScopedSpan("child");
+    }
+    {
+        auto pSiblingSpan = pStatsProvider->startScopedSpan("sibling");
+    }
+    pStatsProvider->flush();
+
+    const auto spans = pStatsRecorder->getSpans();
+    ASSERT_THAT(spans.size(), Eq(3U));
+    EXPECT_THAT(spans[0].path, Eq("/parent/child"));
+    EXPECT_THAT(spans[1].path, Eq("/parent"));
+    EXPECT_THAT(spans[2].path, Eq("/sibling"));
+    for (auto& rSpan : spans)
+    {
+        EXPECT_THAT(rSpan.startTime, Le(rSpan.endTime));
+        EXPECT_THAT(rSpan.threadId, Eq(this_thread::get_id()));
+    }
+    EXPECT_THAT(spans[1].startTime, Le(spans[0].startTime));
+    EXPECT_THAT(spans[1].endTime, Ge(spans[0].endTime));
+}
+
+TEST(StatsProviderTest, spansWithDifferentNamesAtSameAddressHaveDifferentPaths)
+{
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pStatsRecorder);
+
+    string name = "first";
+    {
+        auto pSpan = pStatsProvider->startScopedSpan(name);
+    }
+    name = "other";
+    {
+        auto pSpan = pStatsProvider->startScopedSpan(name);
+    }
+    pStatsProvider->flush();
+
+    EXPECT_THAT(pStatsRecorder->getPathCounts(), ContainerEq(map<string, uint32_t>{{"/first", 1U}, {"/other", 1U}}));
+}
+
+TEST(StatsProviderTest, deeplyNestedSpansAreDelivered)
+{
+    // Deeper than the spans stored per thread without allocation:
+    constexpr uint32_t Depth = 100U;
+
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pStatsRecorder);
+    {
+        vector<unique_ptr<IStatsProvider::IScopedSpan>> pSpans;
+        for (uint32_t depth = 0U; depth < Depth; depth++)
+        {
+            pSpans.emplace_back(pStatsProvider->startScopedSpan("span"));
+        }
+        while (!pSpans.empty())
+        {
+            pSpans.pop_back();
+        }
+    }
+    pStatsProvider->flush();
+
+    const auto spans = pStatsRecorder->getSpans();
+    ASSERT_THAT(spans.size(), Eq(Depth));
+    EXPECT_THAT(distance(spans.front().path.begin(), spans.front().path.end()), Eq(Depth + 1U));
+    EXPECT_THAT(spans.back().path, Eq("/span"));
+}
+
+TEST(StatsProviderTest, spansAreRecordedForSeveralProvidersFromSameThread)
+{
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pStatsRecorder);
+    for (uint32_t i = 0U; i < 3U; i++)
+    {
+        // Thread states of destroyed providers are freed, the thread records spans for new providers:
+        auto pOtherStatsRecorder = make_shared<StatsRecorder>();
+        auto pOtherStatsProvider = createStatsProvider();
+        pOtherStatsProvider->addReceiver(pOtherStatsRecorder);
+        {
+            auto pSpan = pStatsProvider->startScopedSpan("span");
+            auto pOtherSpan = pOtherStatsProvider->startScopedSpan("other");
+        }
+        pOtherStatsProvider->flush();
+        EXPECT_THAT(pOtherStatsRecorder->getPathCounts(), ContainerEq(map<string, uint32_t>{{"/other", 1U}}));
+    }
+    pStatsProvider->flush();
+
+    EXPECT_THAT(pStatsRecorder->getPathCounts(), ContainerEq(map<string, uint32_t>{{"/span", 3U}}));
+}
+
+TEST(StatsProviderTest, spansAreDeliveredWithoutFlush)
+{
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pStatsRecorder);
+    {
+        auto pSpan = pStatsProvider->startScopedSpan("span");
+    }
+
+    const auto timeoutTime = steady_clock::now() + 5s;
+    while (pStatsRecorder->getSpans().empty() && steady_clock::now() < timeoutTime)
+    {
+        this_thread::sleep_for(1ms);
+    }
+    EXPECT_THAT(pStatsRecorder->getPathCounts(), ContainerEq(map<string, uint32_t>{{"/span", 1U}}));
+}
+
+TEST(StatsProviderTest, spansAreDeliveredWhenProviderIsDestroyed)
+{
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    {
+        auto pStatsProvider = createStatsProvider();
+        pStatsProvider->addReceiver(pStatsRecorder);
+        auto pSpan = pStatsProvider->startScopedSpan("span");
+    }
+    EXPECT_THAT(pStatsRecorder->getPathCounts(), ContainerEq(map<string, uint32_t>{{"/span", 1U}}));
+}
+
+TEST(StatsProviderTest, removedReceiverDoesNotReceiveSpans)
+{
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pStatsRecorder);
+    pStatsProvider->removeReceiver(pStatsRecorder);
+    {
+        auto pSpan = pStatsProvider->startScopedSpan("span");
+    }
+    pStatsProvider->flush();
+
+    EXPECT_THAT(pStatsRecorder->getSpans(), IsEmpty());
+}
+
+TEST(StatsProviderTest, spansFromSeveralThreadsAreDelivered)
+{
+    constexpr uint32_t ThreadCount = 4U;
+    constexpr uint32_t SpanCountPerThread = 1000U;
+
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pStatsRecorder);
+    {
+        vector<jthread> threads;
+        for (uint32_t threadIndex = 0U; threadIndex < ThreadCount; threadIndex++)
+        {
+            threads.emplace_back([&] {
+                for (uint32_t spanIndex = 0U; spanIndex < SpanCountPerThread; spanIndex++)
+                {
+                    auto pSpan = pStatsProvider->startScopedSpan("worker");
+                    auto pChildSpan = pStatsProvider->startScopedSpan("task");
+                }
+            });
+        }
+    }
+    pStatsProvider->flush();
+
+    EXPECT_THAT(pStatsRecorder->getPathCounts(),
+                ContainerEq(map<string, uint32_t>{
+                    {"/worker", ThreadCount * SpanCountPerThread},
+                    {"/worker/task", ThreadCount * SpanCountPerThread},
+                }));
+}
+
+TEST(StatsProviderTest, flushDeliversMetricsSortedByName)
+{
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pStatsRecorder);
+
+    auto pCounter = pStatsProvider->getCounter("tileReads");
+    pCounter->add();
+    pCounter->add(2);
+    auto pGauge = pStatsProvider->getGauge("residentTiles");
+    pGauge->set(10);
+    pGauge->add(-3);
+    pStatsProvider->flush();
+
+    EXPECT_THAT(pStatsRecorder->getMetrics(), ElementsAre(isMetric("residentTiles", MetricType::Gauge, 7),
+                                                          isMetric("tileReads", MetricType::Counter, 3)));
+}
+
+TEST(StatsProviderTest, metricsWithSameNameAreShared)
+{
+    auto pStatsProvider = createStatsProvider();
+    EXPECT_THAT(pStatsProvider->getCounter("counter"), Eq(pStatsProvider->getCounter("counter")));
+    EXPECT_THAT(pStatsProvider->getGauge("gauge"), Eq(pStatsProvider->getGauge("gauge")));
+}
+
+TEST(StatsProviderTest, getMetricThrowsWithNameOfOtherType)
+{
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->getCounter("counter");
+    pStatsProvider->getGauge("gauge");
+    EXPECT_THROW(pStatsProvider->getGauge("counter"), invalid_argument);
+    EXPECT_THROW(pStatsProvider->getCounter("gauge"), invalid_argument);
+}
+
+TEST(StatsProviderTest, countersAreIncrementedFromSeveralThreads)
+{
+    constexpr uint32_t ThreadCount = 4U;
+    constexpr uint32_t IncrementCountPerThread = 10'000U;
+
+    auto pStatsRecorder = make_shared<StatsRecorder>();
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(pStatsRecorder);
+    {
+        vector<jthread> threads;
+        for (uint32_t threadIndex = 0U; threadIndex < ThreadCount; threadIndex++)
+        {
+            threads.emplace_back([&] {
+                auto pCounter = pStatsProvider->getCounter("counter");
+                for (uint32_t i = 0U; i < IncrementCountPerThread; i++)
+                {
+                    pCounter->add();
+                }
+            });
+        }
+    }
+    pStatsProvider->flush();
+
+    EXPECT_THAT(pStatsRecorder->getMetrics(),
+                ElementsAre(isMetric("counter", MetricType::Counter, ThreadCount * IncrementCountPerThread)));
+}
+
+/// Benchmark measuring the total cost of a scoped span on the calling thread, clock reads included, against a budget of
+/// 50 ns per span. Disabled by default, run with --gtest_also_run_disabled_tests --gtest_filter=*benchmarkScopedSpan on
+/// an optimized build.
+/// The budget is currently missed where reading the steady clock is slow: on a virtual machine measuring 30 ns per
+/// clock read, a span costs about 80 ns, its two clock reads taking 60 ns and its recording 20 ns. The clock and
+/// recording costs are printed apart to tell which one misses the budget.
+TEST(StatsProviderTest, DISABLED_benchmarkScopedSpan)
+{
+    constexpr uint32_t SpanCount = 1'000'000U;
+    constexpr uint32_t SpanCountPerFlush = 10'000U;
+
+    auto pStatsProvider = createStatsProvider();
+    pStatsProvider->addReceiver(make_shared<StatsRecorder>());
+
+    // Spans are flushed regularly so that the ring buffer never fills up, flushing is not measured. Clock reads are
+    // measured in between and the fastest batches are kept to filter out the noise of other processes:
+    auto spanBatchDuration = duration<double, nano>::max();
+    auto clockBatchDuration = duration<double, nano>::max();
+    steady_clock::time_point lastTime{};
+    for (uint32_t spanIndex = 0U; spanIndex < SpanCount; spanIndex += SpanCountPerFlush)
+    {
+        const auto spanStart = steady_clock::now();
+        for (uint32_t i = 0U; i < SpanCountPerFlush; i++)
+        {
+            auto pSpan = pStatsProvider->startScopedSpan("benchmark");
+        }
+        spanBatchDuration = min<duration<double, nano>>(spanBatchDuration, steady_clock::now() - spanStart);
+        pStatsProvider->flush();
+
+        const auto clockStart = steady_clock::now();
+        for (uint32_t i = 0U; i < SpanCountPerFlush; i++)
+        {
+            lastTime = max(lastTime, steady_clock::now());
+        }
+        clockBatchDuration = min<duration<double, nano>>(clockBatchDuration, steady_clock::now() - clockStart);
+    }
+
+    const auto spanCost = spanBatchDuration.count() / SpanCountPerFlush;
+    const auto clockCost = clockBatchDuration.count() / SpanCountPerFlush;
+    const auto recordingCost = spanCost - 2.0 * clockCost;
+    cout << fmt::format("Recorded {} spans: {:.1f} ns per span, {:.1f} ns per clock read, {:.1f} ns recording\n",
+                        SpanCount, spanCost, clockCost, recordingCost);
+    EXPECT_THAT(spanCost, Lt(50.0));
+}
@@ -0,0 +1,75 @@
+#include "thread_pool.h"
+
+#include <im3e/test_utils/test_utils.h>
+
+#include <atomic>
+#include <set>
+
+using namespace im3e;
+using namespace std;
+
+TEST(ThreadPoolTest, constructorThrowsWithoutThreads)
+{
+    EXPECT_THROW(ThreadPool(0U), invalid_argument);
+}
+
+TEST(ThreadPoolTest, constructorCreatesRequestedThreadCount)
+{
+    ThreadPool threadPool(3U);
+    EXPECT_THAT(threadPool.getThreadCount(), Eq(3U));
+}
+
+TEST(ThreadPoolTest, submitThrowsWithEmptyTask)
+{
+    ThreadPool threadPool(1U);
+    EXPECT_THROW(threadPool.submit(nullptr), invalid_argument);
+}
+
+TEST(ThreadPoolTest, waitIdleWaitsForAllTasks)
+{
+    constexpr uint32_t TaskCount = 1000U;
+
+    ThreadPool threadPool(4U);
+    atomic_uint32_t completedCount{};
+    for (uint32_t i = 0U; i < TaskCount; i++)
+    {
+        threadPool.submit([&completedCount] { completedCount++; });
+    }
+    threadPool.waitIdle();
+
+    EXPECT_THAT(completedCount.load(), Eq(TaskCount));
+}
+
+TEST(ThreadPoolTest, tasksRunOnWorkerThreads)
+{
+    ThreadPool threadPool(2U);
+
+    mutex threadIdsMutex;
+    set<thread::id> threadIds;
+    for (uint32_t i = 0U; i < 100U; i++)
+    {
+        threadPool.submit([&] {
+            lock_guard lk(threadIdsMutex);
+            threadIds.emplace(this_thread::get_id());
+        });
+    }
+    threadPool.waitIdle();
+
+    EXPECT_THAT(threadIds.contains(this_thread::get_id()), IsFalse());
+    EXPECT_THAT(threadIds.size(), AllOf(Ge(1U), Le(2U)));
+}
+
+TEST(ThreadPoolTest, destructorRunsQueuedTasks)
+{
+    constexpr uint32_t TaskCount = 100U;
+
+    atomic_uint32_t completedCount{};
+    {
+        ThreadPool threadPool(1U);
+        for (uint32_t i = 0U; i < TaskCount; i++)
+        {
+            threadPool.submit([&completedCount] { completedCount++; });
+        }
+    }
+    EXPECT_THAT(completedCount.load(), Eq(TaskCount));
+}
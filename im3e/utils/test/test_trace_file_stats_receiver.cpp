@@ -0,0 +1,121 @@
+#include "stats.h"
+
+#include <im3e/test_utils/test_utils.h>
+
+#include <fmt/format.h>
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace im3e;
+using namespace std;
+using namespace std::chrono;
+
+struct TraceFileStatsReceiverTest : public Test
+{
+    ~TraceFileStatsReceiverTest() override { filesystem::remove(m_path); }
+
+    auto readTraceFile() const -> string
+    {
+        ifstream file(m_path);
+        stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    const filesystem::path m_path = filesystem::temp_directory_path() /
+                                    fmt::format("test_trace_file_stats_receiver_{}.json", getpid());
+};
+
+TEST_F(TraceFileStatsReceiverTest, constructorThrowsWithInvalidPath)
+{
+    EXPECT_THROW(createTraceFileStatsReceiver(m_path / "invalid" / "trace.json"), runtime_error);
+}
+
+TEST_F(TraceFileStatsReceiverTest, emptyTraceIsValid)
+{
+    createTraceFileStatsReceiver(m_path);
+    EXPECT_THAT(this->readTraceFile(), StrEq("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n]}\n"));
+}
+
+TEST_F(TraceFileStatsReceiverTest, spansAreWrittenAsCompleteEventsPerThread)
+{
+    const steady_clock::time_point startTime{1500us};
+    const auto otherThreadId = jthread([] {}).get_id();
+    {
+        auto pReceiver = createTraceFileStatsReceiver(m_path);
+        pReceiver->onSpanAdded(Span{
+            .path = "/frame/render",
+            .startTime = startTime,
+            .endTime = startTime + 250us,
+            .threadId = this_thread::get_id(),
+        });
+        pReceiver->onSpanAdded(Span{
+            .path = "/\"load\"",
+            .startTime = startTime + 1ms,
+            .endTime = startTime + 3ms,
+            .threadId = otherThreadId,
+        });
+        pReceiver->onSpanAdded(Span{
+            .path = "/frame",
+            .startTime = startTime,
+            .endTime = startTime + 500us,
+            .threadId = this_thread::get_id(),
+        });
+    }
+
+    EXPECT_THAT(this->readTraceFile(),
+                StrEq("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+                      "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, "
+                      "\"args\": {\"name\": \"Thread 1\"}},\n"
+                      "{\"name\": \"render\", \"cat\": \"im3e\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, "
+                      "\"ts\": 1500.000, \"dur\": 250.000, \"args\": {\"path\": \"/frame/render\"}},\n"
+                      "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, "
+                      "\"args\": {\"name\": \"Thread 2\"}},\n"
+                      "{\"name\": \"\\\"load\\\"\", \"cat\": \"im3e\", \"ph\": \"X\", \"pid\": 1, \"tid\": 2, "
+                      "\"ts\": 2500.000, \"dur\": 2000.000, \"args\": {\"path\": \"/\\\"load\\\"\"}},\n"
+                      "{\"name\": \"frame\", \"cat\": \"im3e\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, "
+                      "\"ts\": 1500.000, \"dur\": 500.000, \"args\": {\"path\": \"/frame\"}}\n"
+                      "]}\n"));
+}
+
+TEST_F(TraceFileStatsReceiverTest, metricsAreWrittenAsCounterEvents)
+{
+    {
+        auto pReceiver = createTraceFileStatsReceiver(m_path);
+        pReceiver->onMetricsUpdated({
+            Metric{.name = "tileReads", .type = MetricType::Counter, .value = 12},
+            Metric{.name = "residentTiles", .type = MetricType::Gauge, .value = -3},
+        });
+    }
+
+    const auto trace = this->readTraceFile();
+    EXPECT_THAT(trace, HasSubstr("{\"name\": \"tileReads\", \"cat\": \"im3e\", \"ph\": \"C\", \"pid\": 1, \"ts\": "));
+    EXPECT_THAT(trace, HasSubstr("\"args\": {\"value\": 12}}"));
+    EXPECT_THAT(trace, HasSubstr("{\"name\": \"residentTiles\", \"cat\": \"im3e\", \"ph\": \"C\""));
+    EXPECT_THAT(trace, HasSubstr("\"args\": {\"value\": -3}}"));
+}
+
+TEST(ExtractTraceFilePathTest, removesTraceOptionFromArgs)
+{
+    vector<string_view> args{"app", "info", "--trace", "trace.json", "file.tif"};
+    EXPECT_THAT(extractTraceFilePath(args), Optional(Eq(filesystem::path("trace.json"))));
+    EXPECT_THAT(args, ElementsAre("app", "info", "file.tif"));
+}
+
+TEST(ExtractTraceFilePathTest, returnsNothingWithoutTraceOption)
+{
+    vector<string_view> args{"app", "info", "file.tif"};
+    EXPECT_THAT(extractTraceFilePath(args), Eq(nullopt));
+    EXPECT_THAT(args.size(), Eq(3U));
+}
+
+TEST(ExtractTraceFilePathTest, throwsWithoutTraceFilePath)
+{
+    vector<string_view> args{"app", "--trace"};
+    EXPECT_THROW(extractTraceFilePath(args), invalid_argument);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace im3e {
+
+/// @brief Fixed-size pool of worker threads executing submitted tasks in submission order.
+/// Tasks still queued when the pool is destroyed are executed before the worker threads are joined.
+class ThreadPool
+{
+public:
+    ThreadPool(uint32_t threadCount = getDefaultThreadCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// @brief Queue a task for execution on one of the worker threads.
+    /// Tasks are expected to handle their own errors: an exception escaping a task terminates the application.
+    void submit(std::function<void()> task);
+
+    /// @brief Block until every task submitted so far has completed.
+    void waitIdle();
+
+    auto getThreadCount() const -> uint32_t { return static_cast<uint32_t>(m_threads.size()); }
+
+    static auto getDefaultThreadCount() -> uint32_t;
+
+private:
+    void runWorker();
+
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailable;
+    std::condition_variable m_idle;
+    std::deque<std::function<void()>> m_tasks;
+    uint32_t m_runningTaskCount{};
+    bool m_stopping{};
+
+    std::vector<std::thread> m_threads;
+};
+
+}  // namespace im3e